@@ -162,7 +162,11 @@ void Action::commit(DirtyList* dirty_list) {
 					}
 				}
 
+				// The tile that is replaced has to be kept for undo
+				editor.map.loadArea(pos);
 				Tile* oldtile = editor.map.swapTile(pos, newtile);
+				editor.map.area_cache.markDirty(pos);
+				editor.map.item_index.markDirty(pos);
 				TileLocation* location = newtile->getLocation();
 
 				// Update other nodes in the network
@@ -310,6 +314,8 @@ void Action::undo(DirtyList* dirty_list) {
 				}
 
 				Tile* newtile = editor.map.swapTile(pos, oldtile);
+				editor.map.area_cache.markDirty(pos);
+				editor.map.item_index.markDirty(pos);
 
 				// Update server side change list (for broadcast)
 				if (editor.IsLiveServer() && dirty_list) {
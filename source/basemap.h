@@ -22,6 +22,7 @@
 #include "position.h"
 #include "filehandle.h"
 #include "map_allocator.h"
+#include "map_leaf_table.h"
 #include "tile.h"
 
 // Class declarations
@@ -112,11 +113,9 @@ public:
 
 	// Get a Quad Tree Leaf from the map
 	QTreeNode* getLeaf(int x, int y) {
-		return root.getLeaf(x, y);
-	}
-	QTreeNode* createLeaf(int x, int y) {
-		return root.getLeafForce(x, y);
+		return leaves.get(x, y);
 	}
+	QTreeNode* createLeaf(int x, int y);
 
 	// Assigns a tile, it might seem pointless to provide position, but it is not, as the passed tile may be nullptr
 	void setTile(int _x, int _y, int _z, Tile* newtile, bool remove = false);
@@ -135,6 +134,15 @@ public:
 	// Clears the visiblity according to the mask passed
 	void clearVisible(uint32_t mask);
 
+	// Edits that change tiles in place without going through setTile or
+	// touching their locations bump this, views then redraw everything
+	void invalidateTiles() {
+		++tile_generation;
+	}
+	uint32_t getTileGeneration() const {
+		return tile_generation;
+	}
+
 	uint64_t getTileCount() const {
 		return tilecount;
 	}
@@ -144,8 +152,10 @@ public:
 
 protected:
 	uint64_t tilecount;
+	uint32_t tile_generation;
 
 	QTreeNode root; // The Quad Tree root
+	QTreeLeafTable leaves; // Direct index into the leaves of the tree
 
 	friend class QTreeNode;
 };
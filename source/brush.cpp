@@ -53,6 +53,7 @@ Brushes::~Brushes() {
 }
 
 void Brushes::clear() {
+	GroundBrush::clearBorderTable();
 	for (auto brushEntry : brushes) {
 		delete brushEntry.second;
 	}
@@ -89,6 +90,22 @@ void Brushes::init() {
 	WallBrush::init();
 	TableBrush::init();
 	CarpetBrush::init();
+
+	// All brushes are loaded by now, resolve what terrain brushes look up
+	// about each other while drawing
+	std::vector<TerrainBrush*> terrainBrushes;
+	std::vector<GroundBrush*> groundBrushes;
+	for (const auto& brushEntry : brushes) {
+		Brush* brush = brushEntry.second;
+		if (brush->isTerrain()) {
+			terrainBrushes.push_back(brush->asTerrain());
+		}
+		if (brush->isGround()) {
+			groundBrushes.push_back(brush->asGround());
+		}
+	}
+	TerrainBrush::buildFriendTable(terrainBrushes);
+	GroundBrush::buildBorderTable(groundBrushes);
 }
 
 bool Brushes::unserializeBrush(pugi::xml_node node, wxArrayString& warnings) {
@@ -210,7 +227,7 @@ Brush::~Brush() {
 
 // TerrainBrush
 TerrainBrush::TerrainBrush() :
-	look_id(0), hate_friends(false) {
+	look_id(0), hate_friends(false), terrain_index(0xFFFFFFFF) {
 	////
 }
 
@@ -219,6 +236,25 @@ TerrainBrush::~TerrainBrush() {
 }
 
 bool TerrainBrush::friendOf(TerrainBrush* other) {
+	if (other->terrain_index < friend_table.size()) {
+		return friend_table[other->terrain_index];
+	}
+	return checkFriends(other);
+}
+
+void TerrainBrush::buildFriendTable(const std::vector<TerrainBrush*>& terrain_brushes) {
+	for (uint32_t index = 0; index < terrain_brushes.size(); ++index) {
+		terrain_brushes[index]->terrain_index = index;
+	}
+	for (TerrainBrush* brush : terrain_brushes) {
+		brush->friend_table.assign(terrain_brushes.size(), false);
+		for (TerrainBrush* other : terrain_brushes) {
+			brush->friend_table[other->terrain_index] = brush->checkFriends(other);
+		}
+	}
+}
+
+bool TerrainBrush::checkFriends(TerrainBrush* other) const {
 	uint32_t borderID = other->getID();
 	for (uint32_t friendId : friends) {
 		if (friendId == borderID) {
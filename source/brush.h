@@ -305,12 +305,21 @@ public:
 	}
 
 	bool friendOf(TerrainBrush* other);
+	// Resolves friendOf between all of the given brushes up front, brushes
+	// added later fall back to checking the friend list
+	static void buildFriendTable(const std::vector<TerrainBrush*>& terrain_brushes);
 
 protected:
+	bool checkFriends(TerrainBrush* other) const;
+
 	std::vector<uint32_t> friends;
 	std::string name;
 	uint16_t look_id;
 	bool hate_friends;
+
+	// friendOf for each brush in the friend table, by terrain_index
+	std::vector<bool> friend_table;
+	uint32_t terrain_index;
 };
 
 //=============================================================================
@@ -224,6 +224,7 @@ void CopyBuffer::paste(Editor& editor, const Position& toPosition) {
 			continue;
 		}
 
+		editor.map.loadArea(pos);
 		TileLocation* location = editor.map.createTileL(pos);
 		Tile* copy_tile = buffer_tile->deepCopy(editor.map);
 		Tile* old_dest_tile = location->get();
@@ -488,6 +488,9 @@ bool Editor::exportSelectionAsMiniMap(FileName directory, wxString fileName) {
 bool Editor::importMap(FileName filename, int import_x_offset, int import_y_offset, ImportType house_import_type, ImportType spawn_import_type) {
 	selection.clear();
 	actionQueue->clear();
+	map.area_cache.clear();
+	map.item_index.clear();
+	map.invalidateTiles();
 
 	Map imported_map;
 	bool loaded = imported_map.open(nstr(filename.GetFullPath()));
@@ -498,6 +501,10 @@ bool Editor::importMap(FileName filename, int import_x_offset, int import_y_offs
 	}
 	g_gui.ListDialog("Warning", imported_map.getWarnings());
 
+	// Tiles are merged across the entire map
+	imported_map.loadAllAreas(true);
+	map.loadAllAreas(true);
+
 	Position offset(import_x_offset, import_y_offset, 0);
 
 	bool resizemap = false;
@@ -821,6 +828,16 @@ bool Editor::importMap(FileName filename, int import_x_offset, int import_y_offs
 	return true;
 }
 
+namespace {
+	uint32_t getTileSeed(uint32_t seed, const Position& position) {
+		uint64_t value = (uint64_t(seed) << 32) ^ (uint64_t(position.x) << 20) ^ (uint64_t(position.y) << 4) ^ position.z;
+		// splitmix64 finalizer
+		value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+		return static_cast<uint32_t>(value ^ (value >> 31));
+	}
+}
+
 void Editor::borderizeSelection() {
 	if (selection.size() == 0) {
 		g_gui.SetStatusText("No items selected. Can't borderize.");
@@ -837,22 +854,19 @@ void Editor::borderizeSelection() {
 }
 
 void Editor::borderizeMap(bool showdialog) {
+	map.loadAllAreas(showdialog);
 	if (showdialog) {
 		g_gui.CreateLoadBar("Borderizing map...");
 	}
+	map.area_cache.clear();
+	map.item_index.clear();
+	map.invalidateTiles();
 
-	uint64_t tiles_done = 0;
-	for (TileLocation* tileLocation : map) {
-		if (showdialog && tiles_done % 4096 == 0) {
-			g_gui.SetLoadDone(static_cast<int32_t>(tiles_done / double(map.tilecount) * 100.0));
-		}
-
-		Tile* tile = tileLocation->get();
-		ASSERT(tile);
-
+	// Borderizing a tile only reads the grounds around it, which stay as they
+	// are, so tiles can be borderized in any order
+	foreach_TileBatchOnMap(map, false, showdialog, [this](size_t, Tile* tile, long long) {
 		tile->borderize(&map);
-		++tiles_done;
-	}
+	}, nullptr);
 
 	if (showdialog) {
 		g_gui.DestroyLoadBar();
@@ -886,19 +900,18 @@ void Editor::randomizeSelection() {
 }
 
 void Editor::randomizeMap(bool showdialog) {
+	map.loadAllAreas(showdialog);
 	if (showdialog) {
 		g_gui.CreateLoadBar("Randomizing map...");
 	}
-
-	uint64_t tiles_done = 0;
-	for (TileLocation* tileLocation : map) {
-		if (showdialog && tiles_done % 4096 == 0) {
-			g_gui.SetLoadDone(static_cast<int32_t>(tiles_done / double(map.tilecount) * 100.0));
-		}
-
-		Tile* tile = tileLocation->get();
-		ASSERT(tile);
-
+	map.area_cache.clear();
+	map.item_index.clear();
+	map.invalidateTiles();
+
+	// Each tile gets its own random value from the seed and its position, so
+	// the result doesn't depend on which thread randomizes it
+	const uint32_t seed = mt_randi();
+	foreach_TileBatchOnMap(map, false, showdialog, [seed](size_t, Tile* tile, long long) {
 		GroundBrush* groundBrush = tile->getGroundBrush();
 		if (groundBrush) {
 			Item* oldGround = tile->ground;
@@ -911,7 +924,7 @@ void Editor::randomizeMap(bool showdialog) {
 				actionId = 0;
 				uniqueId = 0;
 			}
-			groundBrush->draw(&map, tile, nullptr);
+			groundBrush->redraw(tile, getTileSeed(seed, tile->getPosition()));
 
 			Item* newGround = tile->ground;
 			if (newGround) {
@@ -920,8 +933,7 @@ void Editor::randomizeMap(bool showdialog) {
 			}
 			tile->update();
 		}
-		++tiles_done;
-	}
+	}, nullptr);
 
 	if (showdialog) {
 		g_gui.DestroyLoadBar();
@@ -929,6 +941,7 @@ void Editor::randomizeMap(bool showdialog) {
 }
 
 void Editor::clearInvalidHouseTiles(bool showdialog) {
+	map.loadAllAreas(showdialog);
 	if (showdialog) {
 		g_gui.CreateLoadBar("Clearing invalid house tiles...");
 	}
@@ -971,6 +984,8 @@ void Editor::clearInvalidHouseTiles(bool showdialog) {
 		if (tile->isHouseTile()) {
 			if (houses.getHouse(tile->getHouseID()) == nullptr) {
 				tile->setHouse(nullptr);
+				tile->getLocation()->touch();
+				map.area_cache.markDirty(tile->getPosition());
 			}
 		}
 		++tiles_done;
@@ -1932,6 +1947,8 @@ LiveSocket& Editor::GetLive() const {
 
 LiveServer* Editor::StartLiveServer() {
 	ASSERT(IsLocal());
+	// Clients are sent complete nodes of the map
+	map.loadAllAreas(true);
 	live_server = newd LiveServer(*this);
 
 	delete actionQueue;
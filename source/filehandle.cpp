@@ -22,6 +22,27 @@
 #include <stdio.h>
 #include <assert.h>
 
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+#ifdef OTGZ_SUPPORT
+	#include <zlib.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+	#include <emmintrin.h>
+	#define RME_FILEHANDLE_SSE2
+	#ifdef _MSC_VER
+		#include <intrin.h>
+	#endif
+#endif
+
 uint8_t NodeFileWriteHandle::NODE_START = ::NODE_START;
 uint8_t NodeFileWriteHandle::NODE_END = ::NODE_END;
 uint8_t NodeFileWriteHandle::ESCAPE_CHAR = ::ESCAPE_CHAR;
@@ -61,6 +82,107 @@ std::string FileHandle::getErrorMessage() {
 	return "No error";
 }
 
+//=============================================================================
+// Memory mapped file
+
+MemoryMappedFile::MemoryMappedFile() :
+	data(nullptr),
+	size(0) {
+#ifdef _WIN32
+	file_handle = INVALID_HANDLE_VALUE;
+	mapping_handle = nullptr;
+#endif
+}
+
+MemoryMappedFile::MemoryMappedFile(const std::string& name) :
+	MemoryMappedFile() {
+	open(name);
+}
+
+MemoryMappedFile::~MemoryMappedFile() {
+	close();
+}
+
+bool MemoryMappedFile::open(const std::string& name, bool sequential) {
+	close();
+#ifdef _WIN32
+	#if defined __VISUALC__ && defined _UNICODE
+	file_handle = CreateFileW(string2wstring(name).c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | (sequential ? FILE_FLAG_SEQUENTIAL_SCAN : 0), nullptr);
+	#else
+	file_handle = CreateFileA(name.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | (sequential ? FILE_FLAG_SEQUENTIAL_SCAN : 0), nullptr);
+	#endif
+	if (file_handle == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file_handle, &file_size) || file_size.QuadPart == 0) {
+		close();
+		return false;
+	}
+
+	mapping_handle = CreateFileMappingW(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping_handle) {
+		close();
+		return false;
+	}
+
+	data = reinterpret_cast<const uint8_t*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+	if (!data) {
+		close();
+		return false;
+	}
+	size = size_t(file_size.QuadPart);
+#else
+	int fd = ::open(name.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+		::close(fd);
+		return false;
+	}
+
+	void* mem = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping stays valid after the descriptor is closed
+	::close(fd);
+	if (mem == MAP_FAILED) {
+		return false;
+	}
+	if (sequential) {
+		madvise(mem, size_t(st.st_size), MADV_SEQUENTIAL);
+	}
+
+	data = reinterpret_cast<const uint8_t*>(mem);
+	size = size_t(st.st_size);
+#endif
+	return true;
+}
+
+void MemoryMappedFile::close() {
+#ifdef _WIN32
+	if (data) {
+		UnmapViewOfFile(data);
+	}
+	if (mapping_handle) {
+		CloseHandle(mapping_handle);
+		mapping_handle = nullptr;
+	}
+	if (file_handle != INVALID_HANDLE_VALUE) {
+		CloseHandle(file_handle);
+		file_handle = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (data) {
+		munmap(const_cast<uint8_t*>(data), size);
+	}
+#endif
+	data = nullptr;
+	size = 0;
+}
+
 //=============================================================================
 // File read handle
 
@@ -143,6 +265,7 @@ NodeFileReadHandle::NodeFileReadHandle() :
 	cache_size(32768),
 	cache_length(0),
 	local_read_index(0),
+	cache_is_stable(false),
 	root_node(nullptr) {
 	////
 }
@@ -186,6 +309,7 @@ void MemoryNodeFileReadHandle::assign(const uint8_t* data, size_t size) {
 	cache = const_cast<uint8_t*>(data);
 	cache_size = cache_length = size;
 	local_read_index = 0;
+	cache_is_stable = true;
 }
 
 MemoryNodeFileReadHandle::~MemoryNodeFileReadHandle() {
@@ -251,6 +375,17 @@ DiskNodeFileReadHandle::DiskNodeFileReadHandle(const std::string& name, const st
 		fseek(file, 0, SEEK_END);
 		file_size = ftell(file);
 		fseek(file, 4, SEEK_SET);
+
+		// Read straight from a mapping of the file if we can get one,
+		// otherwise fall back to reading it in chunks.
+		if (mapping.open(name) && mapping.getSize() == file_size) {
+			cache = const_cast<uint8_t*>(mapping.getData());
+			cache_size = cache_length = mapping.getSize();
+			local_read_index = 4;
+			cache_is_stable = true;
+		} else {
+			mapping.close();
+		}
 	}
 }
 
@@ -260,12 +395,25 @@ DiskNodeFileReadHandle::~DiskNodeFileReadHandle() {
 
 void DiskNodeFileReadHandle::close() {
 	freeNode(root_node);
+	root_node = nullptr;
 	file_size = 0;
 	FileHandle::close();
-	free(cache);
+	if (mapping.isOpen()) {
+		mapping.close();
+	} else {
+		free(cache);
+	}
+	cache = nullptr;
+	cache_length = 0;
+	local_read_index = 0;
+	cache_is_stable = false;
 }
 
 bool DiskNodeFileReadHandle::renewCache() {
+	if (mapping.isOpen()) {
+		// Everything is in the cache already
+		return false;
+	}
 	if (!cache) {
 		cache = (uint8_t*)malloc(cache_size);
 	}
@@ -280,8 +428,14 @@ bool DiskNodeFileReadHandle::renewCache() {
 
 BinaryNode* DiskNodeFileReadHandle::getRootNode() {
 	assert(root_node == nullptr); // You should never do this twice
-	uint8_t first;
-	fread(&first, 1, 1, file);
+	uint8_t first = 0;
+	if (mapping.isOpen()) {
+		if (local_read_index < cache_length) {
+			first = cache[local_read_index++];
+		}
+	} else {
+		fread(&first, 1, 1, file);
+	}
 	if (first == NODE_START) {
 		root_node = getNode(nullptr);
 		root_node->load();
@@ -292,11 +446,86 @@ BinaryNode* DiskNodeFileReadHandle::getRootNode() {
 	}
 }
 
+#ifdef OTGZ_SUPPORT
+//=============================================================================
+// Archive entry based node file read handle
+
+ArchiveNodeFileReadHandle::ArchiveNodeFileReadHandle(struct archive* archive, size_t entry_size) :
+	archive(archive),
+	entry_size(entry_size),
+	read_size(0) {
+	// Skip the identifier
+	size_t skipped = 0;
+	while (skipped < 4) {
+		if (local_read_index >= cache_length && !renewCache()) {
+			error_code = FILE_SYNTAX_ERROR;
+			return;
+		}
+		size_t step = std::min(4 - skipped, cache_length - local_read_index);
+		local_read_index += step;
+		skipped += step;
+	}
+}
+
+ArchiveNodeFileReadHandle::~ArchiveNodeFileReadHandle() {
+	close();
+}
+
+void ArchiveNodeFileReadHandle::close() {
+	freeNode(root_node);
+	root_node = nullptr;
+	archive = nullptr;
+	free(cache);
+	cache = nullptr;
+	cache_length = 0;
+	local_read_index = 0;
+}
+
+bool ArchiveNodeFileReadHandle::renewCache() {
+	if (!archive) {
+		return false;
+	}
+	if (!cache) {
+		cache = (uint8_t*)malloc(cache_size);
+	}
+
+	la_ssize_t length = archive_read_data(archive, cache, cache_size);
+	if (length <= 0) {
+		if (length < 0) {
+			error_code = FILE_READ_ERROR;
+		}
+		return false;
+	}
+	cache_length = size_t(length);
+	read_size += cache_length;
+	local_read_index = 0;
+	return true;
+}
+
+BinaryNode* ArchiveNodeFileReadHandle::getRootNode() {
+	assert(root_node == nullptr); // You should never do this twice
+	if (local_read_index >= cache_length && !renewCache()) {
+		error_code = FILE_SYNTAX_ERROR;
+		return nullptr;
+	}
+	if (cache[local_read_index++] != NODE_START) {
+		error_code = FILE_SYNTAX_ERROR;
+		return nullptr;
+	}
+	root_node = getNode(nullptr);
+	root_node->load();
+	return root_node;
+}
+#endif
+
 //=============================================================================
 // Binary file node
 
 BinaryNode::BinaryNode(NodeFileReadHandle* file, BinaryNode* parent) :
+	data(nullptr),
+	data_size(0),
 	read_offset(0),
+	start_index(0),
 	file(file),
 	parent(parent),
 	child(nullptr) {
@@ -320,21 +549,21 @@ BinaryNode* BinaryNode::getChild() {
 }
 
 bool BinaryNode::getRAW(uint8_t* ptr, size_t sz) {
-	if (read_offset + sz > data.size()) {
-		read_offset = data.size();
+	if (read_offset + sz > data_size) {
+		read_offset = data_size;
 		return false;
 	}
-	memcpy(ptr, data.data() + read_offset, sz);
+	memcpy(ptr, data + read_offset, sz);
 	read_offset += sz;
 	return true;
 }
 
 bool BinaryNode::getRAW(std::string& str, size_t sz) {
-	if (read_offset + sz > data.size()) {
-		read_offset = data.size();
+	if (read_offset + sz > data_size) {
+		read_offset = data_size;
 		return false;
 	}
-	str.assign(data.data() + read_offset, sz);
+	str.assign(reinterpret_cast<const char*>(data) + read_offset, sz);
 	read_offset += sz;
 	return true;
 }
@@ -399,7 +628,6 @@ BinaryNode* BinaryNode::advance() {
 			// Another node follows this.
 			// Load this node as the next one
 			read_offset = 0;
-			data.clear();
 			load();
 			return this;
 		} else if (op == NODE_END) {
@@ -415,54 +643,231 @@ BinaryNode* BinaryNode::advance() {
 	}
 }
 
+// Returns the first NODE_START, NODE_END or ESCAPE_CHAR in the range, or end.
+// Those are the only byte values >= ESCAPE_CHAR, so one comparison does it.
+static const uint8_t* findControlByte(const uint8_t* begin, const uint8_t* end) {
+#ifdef RME_FILEHANDLE_SSE2
+	const __m128i threshold = _mm_set1_epi8(char(ESCAPE_CHAR));
+	while (end - begin >= 16) {
+		__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+		int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(chunk, threshold), chunk));
+		if (mask != 0) {
+	#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanForward(&index, mask);
+			return begin + index;
+	#else
+			return begin + __builtin_ctz(mask);
+	#endif
+		}
+		begin += 16;
+	}
+#endif
+	while (begin != end && *begin < ESCAPE_CHAR) {
+		++begin;
+	}
+	return begin;
+}
+
+bool BinaryNode::skipChildren(const uint8_t*& node, size_t& size) {
+	ASSERT(file);
+	ASSERT(child == nullptr);
+
+	if (!file->cache_is_stable || file->error_code != FILE_NO_ERROR) {
+		return false;
+	}
+
+	const uint8_t* cache = file->cache;
+	size_t& local_read_index = file->local_read_index;
+
+	if (file->last_was_start) {
+		// Our first child is open, find the NODE_END that closes ourselves
+		const uint8_t* end = cache + file->cache_length;
+		const uint8_t* pos = cache + local_read_index;
+		int depth = 1;
+		while (depth >= 0) {
+			pos = findControlByte(pos, end);
+			if (pos == end) {
+				// Truncated, leave it to the regular parser to report
+				return false;
+			}
+			uint8_t op = *pos++;
+			if (op == NODE_START) {
+				++depth;
+			} else if (op == NODE_END) {
+				--depth;
+			} else if (pos != end) {
+				// ESCAPE_CHAR, skip the escaped byte
+				++pos;
+			}
+		}
+		local_read_index = pos - cache;
+		file->last_was_start = false;
+	}
+
+	node = cache + start_index;
+	size = local_read_index - start_index;
+	return true;
+}
+
+bool BinaryNode::copyChildren(std::string& raw) {
+	ASSERT(file);
+	ASSERT(child == nullptr);
+
+	if (file->error_code != FILE_NO_ERROR) {
+		return false;
+	}
+
+	// The payload has been unescaped already, so escape it again
+	raw.clear();
+	raw.push_back(char(NODE_START));
+	for (size_t i = 0; i < data_size; ++i) {
+		const uint8_t byte = data[i];
+		if (byte == NODE_START || byte == NODE_END || byte == ESCAPE_CHAR) {
+			raw.push_back(char(ESCAPE_CHAR));
+		}
+		raw.push_back(char(byte));
+	}
+
+	if (!file->last_was_start) {
+		// No children, load() has consumed our NODE_END
+		raw.push_back(char(NODE_END));
+		return true;
+	}
+
+	uint8_t*& cache = file->cache;
+	size_t& cache_length = file->cache_length;
+	size_t& local_read_index = file->local_read_index;
+
+	// Our first child is open, copy up to the NODE_END that closes ourselves
+	raw.push_back(char(NODE_START));
+	int depth = 1;
+	while (depth >= 0) {
+		if (local_read_index >= cache_length && !file->renewCache()) {
+			file->error_code = FILE_PREMATURE_END;
+			return false;
+		}
+
+		const uint8_t* begin = cache + local_read_index;
+		const uint8_t* stop = findControlByte(begin, cache + cache_length);
+		raw.append(reinterpret_cast<const char*>(begin), stop - begin);
+		local_read_index += stop - begin;
+		if (local_read_index >= cache_length) {
+			continue;
+		}
+
+		uint8_t op = cache[local_read_index++];
+		raw.push_back(char(op));
+		if (op == NODE_START) {
+			++depth;
+		} else if (op == NODE_END) {
+			--depth;
+		} else {
+			// ESCAPE_CHAR, copy the escaped byte
+			if (local_read_index >= cache_length && !file->renewCache()) {
+				file->error_code = FILE_PREMATURE_END;
+				return false;
+			}
+			raw.push_back(char(cache[local_read_index++]));
+		}
+	}
+	file->last_was_start = false;
+	return true;
+}
+
+bool BinaryNode::skipTo(size_t offset) {
+	ASSERT(file);
+	ASSERT(child == nullptr);
+
+	if (!file->cache_is_stable || file->error_code != FILE_NO_ERROR) {
+		return false;
+	}
+	if (offset <= start_index || offset > file->cache_length || file->cache[offset - 1] != NODE_END) {
+		return false;
+	}
+
+	file->local_read_index = offset;
+	file->last_was_start = false;
+	return true;
+}
+
 void BinaryNode::load() {
 	ASSERT(file);
 	// Read until next node starts
+	// Plain runs between control bytes are found in bulk, the payload is only
+	// copied if it contains escaped bytes or the cache is about to be reused.
 	uint8_t*& cache = file->cache;
 	size_t& cache_length = file->cache_length;
 	size_t& local_read_index = file->local_read_index;
+
+	start_index = local_read_index - 1;
+	buffer.clear();
+	bool copied = false;
+	const uint8_t* run = nullptr;
+	size_t run_size = 0;
+
+	auto flushRun = [&]() {
+		if (run_size != 0) {
+			buffer.append(reinterpret_cast<const char*>(run), run_size);
+			run_size = 0;
+		}
+		copied = true;
+	};
+
 	while (true) {
 		if (local_read_index >= cache_length) {
+			if (!file->cache_is_stable) {
+				flushRun();
+			}
 			if (!file->renewCache()) {
 				// Failed to renew, exit
 				file->error_code = FILE_PREMATURE_END;
-				return;
+				break;
 			}
 		}
 
+		const uint8_t* begin = cache + local_read_index;
+		const uint8_t* stop = findControlByte(begin, cache + cache_length);
+		if (run_size == 0) {
+			run = begin;
+		}
+		run_size += stop - begin;
+		local_read_index += stop - begin;
+		if (local_read_index >= cache_length) {
+			continue;
+		}
+
 		uint8_t op = cache[local_read_index];
 		++local_read_index;
 
-		switch (op) {
-			case NODE_START: {
-				file->last_was_start = true;
-				return;
-			}
-
-			case NODE_END: {
-				file->last_was_start = false;
-				return;
-			}
-
-			case ESCAPE_CHAR: {
-				if (local_read_index >= cache_length) {
-					if (!file->renewCache()) {
-						// Failed to renew, exit
-						file->error_code = FILE_PREMATURE_END;
-						return;
-					}
-				}
+		if (op == NODE_START) {
+			file->last_was_start = true;
+			break;
+		} else if (op == NODE_END) {
+			file->last_was_start = false;
+			break;
+		}
 
-				op = cache[local_read_index];
-				++local_read_index;
+		// ESCAPE_CHAR, the next byte is data
+		flushRun();
+		if (local_read_index >= cache_length) {
+			if (!file->renewCache()) {
+				// Failed to renew, exit
+				file->error_code = FILE_PREMATURE_END;
 				break;
 			}
-
-			default:
-				break;
 		}
-		// std::cout << "Appending..." << std::endl;
-		data.append(1, op);
+		buffer.push_back(char(cache[local_read_index]));
+		++local_read_index;
+	}
+
+	if (copied || !file->cache_is_stable) {
+		flushRun();
+		data = reinterpret_cast<const uint8_t*>(buffer.data());
+		data_size = buffer.size();
+	} else {
+		data = run;
+		data_size = run_size;
 	}
 }
 
@@ -702,3 +1107,260 @@ bool NodeFileWriteHandle::addRAW(const uint8_t* ptr, size_t sz) {
 	writeBytes(ptr, sz);
 	return error_code == FILE_NO_ERROR;
 }
+
+bool NodeFileWriteHandle::addEncodedRAW(const uint8_t* ptr, size_t sz) {
+	while (sz != 0) {
+		size_t chunk = std::min(sz, cache_size - local_write_index);
+		memcpy(cache + local_write_index, ptr, chunk);
+		local_write_index += chunk;
+		if (local_write_index >= cache_size) {
+			renewCache();
+		}
+		ptr += chunk;
+		sz -= chunk;
+	}
+	return error_code == FILE_NO_ERROR;
+}
+
+#ifdef OTGZ_SUPPORT
+//=============================================================================
+// Gzip file write handle
+
+namespace {
+	// long is only 32 bits on Windows, archives can be larger than that
+	int64_t tellFile(FILE* file) {
+	#ifdef _WIN32
+		return _ftelli64(file);
+	#else
+		return ftello(file);
+	#endif
+	}
+
+	bool seekFile(FILE* file, int64_t offset, int origin) {
+	#ifdef _WIN32
+		return _fseeki64(file, offset, origin) == 0;
+	#else
+		return fseeko(file, off_t(offset), origin) == 0;
+	#endif
+	}
+
+	// Uncompressed size of a gzip member, large enough that the header and
+	// the reset of the dictionary at its start don't hurt the ratio
+	const size_t GZIP_MEMBER_SIZE = 1 << 20;
+
+	// A member holding the data as a stored deflate block, its size only
+	// depends on the size of the data
+	void makeStoredGzipMember(const uint8_t* ptr, size_t sz, std::string& member) {
+		ASSERT(sz <= 0xFFFF);
+		const uint32_t crc = crc32(crc32(0, nullptr, 0), ptr, uInt(sz));
+		const uint8_t header[] = {
+			0x1F, 0x8B, Z_DEFLATED, 0, 0, 0, 0, 0, 0, 0xFF, // gzip header, no name or time
+			0x01, // Final block, stored
+			uint8_t(sz), uint8_t(sz >> 8), uint8_t(~sz), uint8_t(~sz >> 8)
+		};
+		const uint8_t trailer[] = {
+			uint8_t(crc), uint8_t(crc >> 8), uint8_t(crc >> 16), uint8_t(crc >> 24),
+			uint8_t(sz), uint8_t(sz >> 8), uint8_t(sz >> 16), uint8_t(sz >> 24)
+		};
+
+		member.assign(reinterpret_cast<const char*>(header), sizeof(header));
+		member.append(reinterpret_cast<const char*>(ptr), sz);
+		member.append(reinterpret_cast<const char*>(trailer), sizeof(trailer));
+	}
+}
+
+GzipFileWriteHandle::GzipFileWriteHandle(const std::string& name, int thread_count) :
+	current(nullptr),
+	total_size(0) {
+#if defined __VISUALC__ && defined _UNICODE
+	file = _wfopen(string2wstring(name).c_str(), L"wb");
+#else
+	file = fopen(name.c_str(), "wb");
+#endif
+	if (file == nullptr || ferror(file)) {
+		error_code = FILE_COULD_NOT_OPEN;
+		return;
+	}
+
+	// Two members per thread, one being compressed and one waiting
+	thread_count = std::max(thread_count, 1);
+	members.resize(thread_count * 2);
+	pipeline.reset(newd OrderedJobPipeline(
+		thread_count, members.size(),
+		[this](size_t slot) { compress(members[slot]); },
+		[this](size_t slot) { write(members[slot]); }
+	));
+	current = &members[pipeline->acquire()];
+}
+
+GzipFileWriteHandle::~GzipFileWriteHandle() {
+	close();
+}
+
+void GzipFileWriteHandle::close() {
+	if (file) {
+		submit();
+		// Writes out the remaining members
+		pipeline.reset();
+		current = nullptr;
+	}
+	FileHandle::close();
+}
+
+bool GzipFileWriteHandle::addRAW(const uint8_t* ptr, size_t sz) {
+	if (!current) {
+		return false;
+	}
+
+	total_size += sz;
+	while (sz != 0) {
+		size_t chunk = std::min(sz, GZIP_MEMBER_SIZE - current->input.size());
+		current->input.append(reinterpret_cast<const char*>(ptr), chunk);
+		if (current->input.size() >= GZIP_MEMBER_SIZE) {
+			submit();
+		}
+		ptr += chunk;
+		sz -= chunk;
+	}
+	return error_code == FILE_NO_ERROR;
+}
+
+bool GzipFileWriteHandle::addPlaceholder(const uint8_t* ptr, size_t sz, size_t& offset) {
+	if (!current) {
+		return false;
+	}
+
+	// Everything before it has to be in the file to know where it ends up
+	submit();
+	pipeline->flush();
+	const int64_t position = tellFile(file);
+	if (position < 0) {
+		error_code = FILE_WRITE_ERROR;
+		return false;
+	}
+	offset = size_t(position);
+
+	std::string member;
+	makeStoredGzipMember(ptr, sz, member);
+	fwrite(member.data(), 1, member.size(), file);
+	total_size += sz;
+	if (ferror(file) != 0) {
+		error_code = FILE_WRITE_ERROR;
+	}
+	return error_code == FILE_NO_ERROR;
+}
+
+bool GzipFileWriteHandle::replacePlaceholder(size_t offset, const uint8_t* ptr, size_t sz) {
+	if (!current) {
+		return false;
+	}
+
+	submit();
+	pipeline->flush();
+
+	std::string member;
+	makeStoredGzipMember(ptr, sz, member);
+	if (!seekFile(file, int64_t(offset), SEEK_SET)) {
+		error_code = FILE_WRITE_ERROR;
+		return false;
+	}
+	fwrite(member.data(), 1, member.size(), file);
+	if (!seekFile(file, 0, SEEK_END) || ferror(file) != 0) {
+		error_code = FILE_WRITE_ERROR;
+	}
+	return error_code == FILE_NO_ERROR;
+}
+
+bool GzipFileWriteHandle::flush() {
+	if (!current) {
+		return false;
+	}
+
+	submit();
+	pipeline->flush();
+	if (fflush(file) != 0) {
+		error_code = FILE_WRITE_ERROR;
+	}
+	return isOk();
+}
+
+void GzipFileWriteHandle::submit() {
+	if (current->input.empty()) {
+		return;
+	}
+	pipeline->submit();
+	current = &members[pipeline->acquire()];
+}
+
+void GzipFileWriteHandle::compress(Member& member) {
+	z_stream stream;
+	memset(&stream, 0, sizeof(stream));
+	if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+		member.output.clear();
+		return;
+	}
+
+	member.output.resize(deflateBound(&stream, uLong(member.input.size())));
+	stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(member.input.data()));
+	stream.avail_in = uInt(member.input.size());
+	stream.next_out = reinterpret_cast<Bytef*>(&member.output[0]);
+	stream.avail_out = uInt(member.output.size());
+
+	if (deflate(&stream, Z_FINISH) == Z_STREAM_END) {
+		member.output.resize(stream.total_out);
+	} else {
+		member.output.clear();
+	}
+	deflateEnd(&stream);
+}
+
+void GzipFileWriteHandle::write(Member& member) {
+	if (member.output.empty()) {
+		// Compression failed
+		error_code = FILE_WRITE_ERROR;
+	} else if (error_code == FILE_NO_ERROR) {
+		fwrite(member.output.data(), 1, member.output.size(), file);
+		if (ferror(file) != 0) {
+			error_code = FILE_WRITE_ERROR;
+		}
+	}
+	member.input.clear();
+	member.output.clear();
+}
+
+//=============================================================================
+// Gzip node file write handle
+
+GzipNodeFileWriteHandle::GzipNodeFileWriteHandle(GzipFileWriteHandle& target, const std::string& identifier) :
+	target(&target),
+	written_size(0) {
+	cache = (uint8_t*)malloc(cache_size + 1);
+	local_write_index = 0;
+	if (identifier.length() != 4) {
+		error_code = FILE_INVALID_IDENTIFIER;
+		return;
+	}
+	addEncodedRAW(reinterpret_cast<const uint8_t*>(identifier.data()), 4);
+}
+
+GzipNodeFileWriteHandle::~GzipNodeFileWriteHandle() {
+	close();
+}
+
+void GzipNodeFileWriteHandle::close() {
+	if (target) {
+		renewCache();
+		target = nullptr;
+	}
+}
+
+void GzipNodeFileWriteHandle::renewCache() {
+	if (target && local_write_index != 0) {
+		if (!target->addRAW(cache, local_write_index)) {
+			error_code = FILE_WRITE_ERROR;
+		}
+		written_size += local_write_index;
+	}
+	local_write_index = 0;
+}
+#endif
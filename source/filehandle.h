@@ -23,7 +23,10 @@
 #include <stdexcept>
 #include <string>
 #include <stack>
+#include <vector>
+#include <memory>
 #include <stdio.h>
+#include <string.h>
 
 #ifndef FORCEINLINE
 	#ifdef _MSV_VER
@@ -50,6 +53,36 @@ enum NodeType {
 	ESCAPE_CHAR = 0xfd,
 };
 
+// Read-only mapping of a whole file into memory, the OS pages it in on demand
+class MemoryMappedFile : boost::noncopyable {
+public:
+	MemoryMappedFile();
+	explicit MemoryMappedFile(const std::string& name);
+	~MemoryMappedFile();
+
+	// Files that are read front to back are prefetched more aggressively
+	bool open(const std::string& name, bool sequential = true);
+	void close();
+
+	bool isOpen() const {
+		return data != nullptr;
+	}
+	const uint8_t* getData() const {
+		return data;
+	}
+	size_t getSize() const {
+		return size;
+	}
+
+private:
+	const uint8_t* data;
+	size_t size;
+#ifdef _WIN32
+	void* file_handle;
+	void* mapping_handle;
+#endif
+};
+
 class FileHandle : boost::noncopyable {
 public:
 	FileHandle() :
@@ -95,6 +128,9 @@ public:
 	FORCEINLINE bool get32(int32_t& i32) {
 		return getType(i32);
 	}
+	FORCEINLINE bool getU64(uint64_t& u64) {
+		return getType(u64);
+	}
 	bool getRAW(uint8_t* ptr, size_t sz);
 	bool getRAW(std::string& str, size_t sz);
 	bool getString(std::string& str);
@@ -151,8 +187,8 @@ public:
 		return getType(u64);
 	}
 	FORCEINLINE bool skip(size_t sz) {
-		if (read_offset + sz > data.size()) {
-			read_offset = data.size();
+		if (read_offset + sz > data_size) {
+			read_offset = data_size;
 			return false;
 		}
 		read_offset += sz;
@@ -166,29 +202,51 @@ public:
 	BinaryNode* getChild();
 	// Returns this on success, nullptr on failure
 	BinaryNode* advance();
+	// Steps over all children of this node without parsing them, only works
+	// when the file is held in memory. On success node/size cover the raw
+	// bytes of this whole node, so it can be parsed again later on.
+	bool skipChildren(const uint8_t*& node, size_t& size);
+	// Same as skipChildren for files that are streamed, the raw bytes of this
+	// whole node are copied into raw instead
+	bool copyChildren(std::string& raw);
+	// Offset of this node in the file, only meaningful when it is held in memory
+	size_t getFileOffset() const {
+		return start_index;
+	}
+	// Moves the cursor right behind the node that ends just before offset,
+	// which may be this node or one of its later siblings. Only works when
+	// the file is held in memory.
+	bool skipTo(size_t offset);
 
 protected:
 	template <class T>
 	bool getType(T& ref) {
-		if (read_offset + sizeof(ref) > data.size()) {
-			read_offset = data.size();
+		if (read_offset + sizeof(ref) > data_size) {
+			read_offset = data_size;
 			return false;
 		}
-		ref = *(T*)(data.data() + read_offset);
+		memcpy(&ref, data + read_offset, sizeof(ref));
 
 		read_offset += sizeof(ref);
 		return true;
 	}
 
 	void load();
-	std::string data;
+	// Points straight into the file cache when the node has no escaped bytes
+	// and the cache outlives the node, otherwise into buffer
+	const uint8_t* data;
+	size_t data_size;
+	std::string buffer;
 	size_t read_offset;
+	// Offset of the NODE_START of this node in the file cache
+	size_t start_index;
 	NodeFileReadHandle* file;
 	BinaryNode* parent;
 	BinaryNode* child;
 
 	friend class DiskNodeFileReadHandle;
 	friend class MemoryNodeFileReadHandle;
+	friend class ArchiveNodeFileReadHandle;
 };
 
 class NodeFileReadHandle : public FileHandle {
@@ -201,6 +259,10 @@ public:
 	virtual size_t size() = 0;
 	virtual size_t tell() = 0;
 
+	bool isInMemory() const {
+		return cache_is_stable;
+	}
+
 protected:
 	BinaryNode* getNode(BinaryNode* parent);
 	void freeNode(BinaryNode* node);
@@ -212,6 +274,8 @@ protected:
 	size_t cache_size;
 	size_t cache_length;
 	size_t local_read_index;
+	// True if the cache holds the whole file, nodes may then point into it
+	bool cache_is_stable;
 
 	BinaryNode* root_node;
 
@@ -232,6 +296,9 @@ public:
 		return file_size;
 	}
 	virtual size_t tell() {
+		if (mapping.isOpen()) {
+			return local_read_index;
+		}
 		if (file) {
 			return ftell(file);
 		}
@@ -242,6 +309,8 @@ protected:
 	virtual bool renewCache();
 
 	size_t file_size;
+	// The whole file is mapped when possible, the cache then points into it
+	MemoryMappedFile mapping;
 };
 
 class MemoryNodeFileReadHandle : public NodeFileReadHandle {
@@ -271,6 +340,37 @@ protected:
 	uint8_t* index;
 };
 
+#ifdef OTGZ_SUPPORT
+// Reads a node file straight out of the current entry of an archive, without
+// holding all of it in memory
+class ArchiveNodeFileReadHandle : public NodeFileReadHandle {
+public:
+	// Does NOT claim ownership of the archive, the entry starts with the 4 byte identifier
+	ArchiveNodeFileReadHandle(struct archive* archive, size_t entry_size);
+	virtual ~ArchiveNodeFileReadHandle();
+
+	virtual void close();
+	virtual BinaryNode* getRootNode();
+
+	virtual size_t size() {
+		return entry_size;
+	}
+	virtual size_t tell() {
+		return read_size - (cache_length - local_read_index);
+	}
+	virtual bool isOk() {
+		return archive && error_code == FILE_NO_ERROR;
+	}
+
+protected:
+	virtual bool renewCache();
+
+	struct archive* archive;
+	size_t entry_size;
+	size_t read_size;
+};
+#endif
+
 class FileWriteHandle : public FileHandle {
 public:
 	explicit FileWriteHandle(const std::string& name);
@@ -299,6 +399,8 @@ public:
 	bool addRAW(const char* c) {
 		return addRAW(reinterpret_cast<const uint8_t*>(c), strlen(c));
 	}
+	// Appends output of another node writer as is, it is already escaped
+	bool addEncodedRAW(const uint8_t* ptr, size_t sz);
 
 protected:
 	template <class T>
@@ -328,6 +430,11 @@ public:
 	bool addRAW(const char* c) {
 		return addRAW(reinterpret_cast<const uint8_t*>(c), strlen(c));
 	}
+	// Appends output of another node writer as is, it is already escaped
+	bool addEncodedRAW(const uint8_t* ptr, size_t sz);
+
+	// Number of bytes written so far
+	virtual size_t tell() = 0;
 
 protected:
 	virtual void renewCache() = 0;
@@ -366,6 +473,12 @@ public:
 	virtual ~DiskNodeFileWriteHandle();
 
 	virtual void close();
+	virtual size_t tell() {
+		if (file) {
+			return ftell(file) + local_write_index;
+		}
+		return 0;
+	}
 
 protected:
 	virtual void renewCache();
@@ -381,9 +494,83 @@ public:
 
 	uint8_t* getMemory();
 	size_t getSize();
+	virtual size_t tell() {
+		return local_write_index;
+	}
 
 protected:
 	virtual void renewCache();
 };
 
+#ifdef OTGZ_SUPPORT
+class OrderedJobPipeline;
+
+// Writes a gzip file as a series of independent members, which gzip readers
+// decompress as one stream. The members are compressed on worker threads
+// while the next ones are filled, so only a few of them are held in memory.
+class GzipFileWriteHandle : public FileHandle {
+public:
+	GzipFileWriteHandle(const std::string& name, int thread_count);
+	virtual ~GzipFileWriteHandle();
+
+	bool addRAW(const uint8_t* ptr, size_t sz);
+	// Writes the bytes as an uncompressed member of their own, so they can be
+	// overwritten in place once the rest is written. offset is set to where
+	// the member starts in the file.
+	bool addPlaceholder(const uint8_t* ptr, size_t sz, size_t& offset);
+	bool replacePlaceholder(size_t offset, const uint8_t* ptr, size_t sz);
+	// Compresses and writes out everything added so far, call this before
+	// close() to know whether all of it made it into the file
+	bool flush();
+
+	// Number of bytes written so far, before compression
+	size_t tell() const {
+		return total_size;
+	}
+
+	virtual void close();
+
+protected:
+	struct Member {
+		std::string input;
+		std::string output;
+	};
+
+	// Hands the member being filled to the workers
+	void submit();
+	void compress(Member& member);
+	void write(Member& member);
+
+	std::vector<Member> members;
+	std::unique_ptr<OrderedJobPipeline> pipeline;
+	Member* current;
+	size_t total_size;
+};
+
+// Writes a node file into a gzip file, as part of whatever else is in there
+class GzipNodeFileWriteHandle : public NodeFileWriteHandle {
+public:
+	// Does NOT claim ownership of the target
+	GzipNodeFileWriteHandle(GzipFileWriteHandle& target, const std::string& identifier);
+	virtual ~GzipNodeFileWriteHandle();
+
+	virtual void close();
+	virtual size_t tell() {
+		return written_size + local_write_index;
+	}
+	virtual bool isOpen() {
+		return target != nullptr;
+	}
+	virtual bool isOk() {
+		return target && error_code == FILE_NO_ERROR;
+	}
+
+protected:
+	virtual void renewCache();
+
+	GzipFileWriteHandle* target;
+	size_t written_size;
+};
+#endif
+
 #endif
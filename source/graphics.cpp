@@ -19,6 +19,7 @@
 
 #include "sprites.h"
 #include "graphics.h"
+#include "sprite_pixels.h"
 #include "filehandle.h"
 #include "settings.h"
 #include "gui.h"
@@ -182,6 +183,7 @@ static uint32_t TemplateOutfitLookupTable[] = {
 GraphicManager::GraphicManager() :
 	client_version(nullptr),
 	unloaded(true),
+	decoder([this](uint32_t id) { return decodeSprite(id); }),
 	dat_format(DAT_FORMAT_UNKNOWN),
 	otfi_found(false),
 	is_extended(false),
@@ -189,18 +191,30 @@ GraphicManager::GraphicManager() :
 	has_frame_durations(false),
 	has_frame_groups(false),
 	loaded_textures(0),
-	lastclean(0) {
+	dump_bytes(0),
+	collection_pass(0),
+	stats_time(0),
+	stats_hits(0),
+	stats_misses(0),
+	stats_evictions(0) {
 	animation_timer = newd wxStopWatch();
 	animation_timer->Start();
 }
 
 GraphicManager::~GraphicManager() {
-	for (SpriteMap::iterator iter = sprite_space.begin(); iter != sprite_space.end(); ++iter) {
-		delete iter->second;
+	// The decoder threads read the images
+	decoder.stop();
+
+	for (GameSprite* sprite : sprite_space) {
+		delete sprite;
+	}
+
+	for (Sprite* sprite : editor_sprite_space) {
+		delete sprite;
 	}
 
-	for (ImageMap::iterator iter = image_space.begin(); iter != image_space.end(); ++iter) {
-		delete iter->second;
+	for (GameSprite::NormalImage* image : image_space) {
+		delete image;
 	}
 
 	delete animation_timer;
@@ -214,50 +228,58 @@ bool GraphicManager::isUnloaded() const {
 	return unloaded;
 }
 
-GLuint GraphicManager::getFreeTextureID() {
-	static GLuint id_counter = 0x10000000;
-	return id_counter++; // This should (hopefully) never run out
-}
 
 void GraphicManager::clear() {
-	SpriteMap new_sprite_space;
-	for (SpriteMap::iterator iter = sprite_space.begin(); iter != sprite_space.end(); ++iter) {
-		if (iter->first >= 0) { // Don't clean internal sprites
-			delete iter->second;
-		} else {
-			new_sprite_space.insert(std::make_pair(iter->first, iter->second));
-		}
+	// The decoder threads read the sprite file
+	decoder.stop();
+
+	// Editor sprites are internal and stay loaded
+	for (GameSprite* sprite : sprite_space) {
+		delete sprite;
 	}
 
-	for (ImageMap::iterator iter = image_space.begin(); iter != image_space.end(); ++iter) {
-		delete iter->second;
+	for (GameSprite::NormalImage* image : image_space) {
+		delete image;
 	}
 
-	sprite_space.swap(new_sprite_space);
+	sprite_space.clear();
 	image_space.clear();
-	cleanup_list.clear();
+	resident_images.reset();
+	resident_sprites.reset();
+	atlas.clear();
 
 	item_count = 0;
 	creature_count = 0;
 	loaded_textures = 0;
-	lastclean = time(nullptr);
+	dump_bytes = 0;
+	texture_stats.texture_bytes = 0;
+	texture_stats.software_bytes = 0;
 	spritefile = "";
+	sprite_mapping.close();
 
 	unloaded = true;
 }
 
 void GraphicManager::cleanSoftwareSprites() {
-	for (SpriteMap::iterator iter = sprite_space.begin(); iter != sprite_space.end(); ++iter) {
-		if (iter->first >= 0) { // Don't clean internal sprites
-			iter->second->unloadDC();
+	for (GameSprite* sprite : sprite_space) {
+		if (sprite) {
+			sprite->unloadDC();
+			updateResidentSprite(sprite);
 		}
 	}
 }
 
 Sprite* GraphicManager::getSprite(int id) {
-	SpriteMap::iterator it = sprite_space.find(id);
-	if (it != sprite_space.end()) {
-		return it->second;
+	if (id < 0) {
+		size_t index = size_t(id - EDITOR_SPRITE_SELECTION_MARKER);
+		if (id >= EDITOR_SPRITE_SELECTION_MARKER && index < editor_sprite_space.size()) {
+			return editor_sprite_space[index];
+		}
+		return nullptr;
+	}
+
+	if (size_t(id) < sprite_space.size()) {
+		return sprite_space[id];
 	}
 	return nullptr;
 }
@@ -267,13 +289,53 @@ GameSprite* GraphicManager::getCreatureSprite(int id) {
 		return nullptr;
 	}
 
-	SpriteMap::iterator it = sprite_space.find(id + item_count);
-	if (it != sprite_space.end()) {
-		return static_cast<GameSprite*>(it->second);
+	size_t index = size_t(id) + item_count;
+	if (index < sprite_space.size()) {
+		return sprite_space[index];
 	}
 	return nullptr;
 }
 
+Sprite*& GraphicManager::editorSprite(int id) {
+	return editor_sprite_space[id - EDITOR_SPRITE_SELECTION_MARKER];
+}
+
+void GraphicManager::updateResidentImage(GameSprite::Image* image) {
+	size_t bytes = image->getResidentBytes();
+	dump_bytes = dump_bytes - image->resident_bytes + bytes;
+	image->resident_bytes = bytes;
+	texture_stats.texture_bytes = atlas.getPageBytes() + dump_bytes;
+	if (bytes == 0 && !image->isGLLoaded) {
+		resident_images.remove(image);
+	} else {
+		resident_images.touch(image);
+	}
+}
+
+void GraphicManager::updateResidentSprite(GameSprite* sprite) {
+	size_t bytes = sprite->getDCBytes();
+	texture_stats.software_bytes = texture_stats.software_bytes - sprite->dc_bytes + bytes;
+	sprite->dc_bytes = bytes;
+	if (bytes == 0) {
+		resident_sprites.remove(sprite);
+		return;
+	}
+	resident_sprites.touch(sprite);
+
+	size_t budget = size_t(g_settings.getInteger(Config::SOFTWARE_MEMORY_BUDGET)) * 1024 * 1024;
+	while (texture_stats.software_bytes > budget) {
+		GameSprite* oldest = resident_sprites.back();
+		if (oldest == sprite) {
+			break;
+		}
+
+		oldest->unloadDC();
+		texture_stats.software_bytes -= oldest->dc_bytes;
+		oldest->dc_bytes = 0;
+		resident_sprites.remove(oldest);
+	}
+}
+
 uint16_t GraphicManager::getItemSpriteMaxID() const {
 	return item_count;
 }
@@ -293,131 +355,133 @@ inline wxBitmap* _wxGetBitmapFromMemory(const unsigned char* data, int length) {
 }
 
 bool GraphicManager::loadEditorSprites() {
+	editor_sprite_space.resize(EDITOR_SPRITE_LAST - EDITOR_SPRITE_SELECTION_MARKER, nullptr);
+
 	// Unused graphics MIGHT be loaded here, but it's a neglectable loss
-	sprite_space[EDITOR_SPRITE_SELECTION_MARKER] = newd EditorSprite(
+	editorSprite(EDITOR_SPRITE_SELECTION_MARKER) = newd EditorSprite(
 		newd wxBitmap(selection_marker_xpm16x16),
 		newd wxBitmap(selection_marker_xpm32x32)
 	);
-	sprite_space[EDITOR_SPRITE_BRUSH_CD_1x1] = newd EditorSprite(
+	editorSprite(EDITOR_SPRITE_BRUSH_CD_1x1) = newd EditorSprite(
 		loadPNGFile(circular_1_small_png),
 		loadPNGFile(circular_1_png)
 	);
-	sprite_space[EDITOR_SPRITE_BRUSH_CD_3x3] = newd EditorSprite(
+	editorSprite(EDITOR_SPRITE_BRUSH_CD_3x3) = newd EditorSprite(
 		loadPNGFile(circular_2_small_png),
 		loadPNGFile(circular_2_png)
 	);
-	sprite_space[EDITOR_SPRITE_BRUSH_CD_5x5] = newd EditorSprite(
+	editorSprite(EDITOR_SPRITE_BRUSH_CD_5x5) = newd EditorSprite(
 		loadPNGFile(circular_3_small_png),
 		loadPNGFile(circular_3_png)
 	);
-	sprite_space[EDITOR_SPRITE_BRUSH_CD_7x7] = newd EditorSprite(
+	editorSprite(EDITOR_SPRITE_BRUSH_CD_7x7) = newd EditorSprite(
 		loadPNGFile(circular_4_small_png),
 		loadPNGFile(circular_4_png)
 	);
-	sprite_space[EDITOR_SPRITE_BRUSH_CD_9x9] = newd EditorSprite(
+	editorSprite(EDITOR_SPRITE_BRUSH_CD_9x9) = newd EditorSprite(
 		loadPNGFile(circular_5_small_png),
 		loadPNGFile(circular_5_png)
 	);
-	sprite_space[EDITOR_SPRITE_BRUSH_CD_15x15] = newd EditorSprite(
+	editorSprite(EDITOR_SPRITE_BRUSH_CD_15x15) = newd EditorSprite(
 		loadPNGFile(circular_6_small_png),
 		loadPNGFile(circular_6_png)
 	);
-	sprite_space[EDITOR_SPRITE_BRUSH_CD_19x19] = newd EditorSprite(
+	editorSprite(EDITOR_SPRITE_BRUSH_CD_19x19) = newd EditorSprite(
 		loadPNGFile(circular_7_small_png),
 		loadPNGFile(circular_7_png)
 	);
-	sprite_space[EDITOR_SPRITE_BRUSH_SD_1x1] = newd EditorSprite(
+	editorSprite(EDITOR_SPRITE_BRUSH_SD_1x1) = newd EditorSprite(
 		loadPNGFile(rectangular_1_small_png),
 		loadPNGFile(rectangular_1_png)
 	);
-	sprite_space[EDITOR_SPRITE_BRUSH_SD_3x3] = newd EditorSprite(
+	editorSprite(EDITOR_SPRITE_BRUSH_SD_3x3) = newd EditorSprite(
 		loadPNGFile(rectangular_2_small_png),
 		loadPNGFile(rectangular_2_png)
 	);
-	sprite_space[EDITOR_SPRITE_BRUSH_SD_5x5] = newd EditorSprite(
+	editorSprite(EDITOR_SPRITE_BRUSH_SD_5x5) = newd EditorSprite(
 		loadPNGFile(rectangular_3_small_png),
 		loadPNGFile(rectangular_3_png)
 	);
-	sprite_space[EDITOR_SPRITE_BRUSH_SD_7x7] = newd EditorSprite(
+	editorSprite(EDITOR_SPRITE_BRUSH_SD_7x7) = newd EditorSprite(
 		loadPNGFile(rectangular_4_small_png),
 		loadPNGFile(rectangular_4_png)
 	);
-	sprite_space[EDITOR_SPRITE_BRUSH_SD_9x9] = newd EditorSprite(
+	editorSprite(EDITOR_SPRITE_BRUSH_SD_9x9) = newd EditorSprite(
 		loadPNGFile(rectangular_5_small_png),
 		loadPNGFile(rectangular_5_png)
 	);
-	sprite_space[EDITOR_SPRITE_BRUSH_SD_15x15] = newd EditorSprite(
+	editorSprite(EDITOR_SPRITE_BRUSH_SD_15x15) = newd EditorSprite(
 		loadPNGFile(rectangular_6_small_png),
 		loadPNGFile(rectangular_6_png)
 	);
-	sprite_space[EDITOR_SPRITE_BRUSH_SD_19x19] = newd EditorSprite(
+	editorSprite(EDITOR_SPRITE_BRUSH_SD_19x19) = newd EditorSprite(
 		loadPNGFile(rectangular_7_small_png),
 		loadPNGFile(rectangular_7_png)
 	);
 
-	sprite_space[EDITOR_SPRITE_OPTIONAL_BORDER_TOOL] = newd EditorSprite(
+	editorSprite(EDITOR_SPRITE_OPTIONAL_BORDER_TOOL) = newd EditorSprite(
 		loadPNGFile(optional_border_small_png),
 		loadPNGFile(optional_border_png)
 	);
-	sprite_space[EDITOR_SPRITE_ERASER] = newd EditorSprite(
+	editorSprite(EDITOR_SPRITE_ERASER) = newd EditorSprite(
 		loadPNGFile(eraser_small_png),
 		loadPNGFile(eraser_png)
 	);
-	sprite_space[EDITOR_SPRITE_PZ_TOOL] = newd EditorSprite(
+	editorSprite(EDITOR_SPRITE_PZ_TOOL) = newd EditorSprite(
 		loadPNGFile(protection_zone_small_png),
 		loadPNGFile(protection_zone_png)
 	);
-	sprite_space[EDITOR_SPRITE_PVPZ_TOOL] = newd EditorSprite(
+	editorSprite(EDITOR_SPRITE_PVPZ_TOOL) = newd EditorSprite(
 		loadPNGFile(pvp_zone_small_png),
 		loadPNGFile(pvp_zone_png)
 	);
-	sprite_space[EDITOR_SPRITE_NOLOG_TOOL] = newd EditorSprite(
+	editorSprite(EDITOR_SPRITE_NOLOG_TOOL) = newd EditorSprite(
 		loadPNGFile(no_logout_small_png),
 		loadPNGFile(no_logout_png)
 	);
-	sprite_space[EDITOR_SPRITE_NOPVP_TOOL] = newd EditorSprite(
+	editorSprite(EDITOR_SPRITE_NOPVP_TOOL) = newd EditorSprite(
 		loadPNGFile(no_pvp_small_png),
 		loadPNGFile(no_pvp_png)
 	);
 
-	sprite_space[EDITOR_SPRITE_DOOR_NORMAL] = newd EditorSprite(
+	editorSprite(EDITOR_SPRITE_DOOR_NORMAL) = newd EditorSprite(
 		newd wxBitmap(door_normal_small_xpm),
 		newd wxBitmap(door_normal_xpm)
 	);
-	sprite_space[EDITOR_SPRITE_DOOR_LOCKED] = newd EditorSprite(
+	editorSprite(EDITOR_SPRITE_DOOR_LOCKED) = newd EditorSprite(
 		newd wxBitmap(door_locked_small_xpm),
 		newd wxBitmap(door_locked_xpm)
 	);
-	sprite_space[EDITOR_SPRITE_DOOR_MAGIC] = newd EditorSprite(
+	editorSprite(EDITOR_SPRITE_DOOR_MAGIC) = newd EditorSprite(
 		newd wxBitmap(door_magic_small_xpm),
 		newd wxBitmap(door_magic_xpm)
 	);
-	sprite_space[EDITOR_SPRITE_DOOR_QUEST] = newd EditorSprite(
+	editorSprite(EDITOR_SPRITE_DOOR_QUEST) = newd EditorSprite(
 		newd wxBitmap(door_quest_small_xpm),
 		newd wxBitmap(door_quest_xpm)
 	);
-	sprite_space[EDITOR_SPRITE_DOOR_NORMAL_ALT] = newd EditorSprite(
+	editorSprite(EDITOR_SPRITE_DOOR_NORMAL_ALT) = newd EditorSprite(
 		newd wxBitmap(door_normal_alt_small_xpm),
 		newd wxBitmap(door_normal_alt_xpm)
 	);
-	sprite_space[EDITOR_SPRITE_DOOR_ARCHWAY] = newd EditorSprite(
+	editorSprite(EDITOR_SPRITE_DOOR_ARCHWAY) = newd EditorSprite(
 		newd wxBitmap(door_archway_small_xpm),
 		newd wxBitmap(door_archway_xpm)
 	);
-	sprite_space[EDITOR_SPRITE_WINDOW_NORMAL] = newd EditorSprite(
+	editorSprite(EDITOR_SPRITE_WINDOW_NORMAL) = newd EditorSprite(
 		loadPNGFile(window_normal_small_png),
 		loadPNGFile(window_normal_png)
 	);
-	sprite_space[EDITOR_SPRITE_WINDOW_HATCH] = newd EditorSprite(
+	editorSprite(EDITOR_SPRITE_WINDOW_HATCH) = newd EditorSprite(
 		loadPNGFile(window_hatch_small_png),
 		loadPNGFile(window_hatch_png)
 	);
 
-	sprite_space[EDITOR_SPRITE_SELECTION_GEM] = newd EditorSprite(
+	editorSprite(EDITOR_SPRITE_SELECTION_GEM) = newd EditorSprite(
 		loadPNGFile(gem_edit_png),
 		nullptr
 	);
-	sprite_space[EDITOR_SPRITE_DRAWING_GEM] = newd EditorSprite(
+	editorSprite(EDITOR_SPRITE_DRAWING_GEM) = newd EditorSprite(
 		loadPNGFile(gem_move_png),
 		nullptr
 	);
@@ -494,6 +558,8 @@ bool GraphicManager::loadSpriteMetadata(const FileName& datafile, wxString& erro
 		has_frame_groups = dat_format >= DAT_FORMAT_1057;
 	}
 
+	sprite_space.resize(maxID + 1, nullptr);
+
 	uint16_t id = minID;
 	// loop through all ItemDatabase until we reach the end of file
 	while (id <= maxID) {
@@ -576,12 +642,16 @@ bool GraphicManager::loadSpriteMetadata(const FileName& datafile, wxString& erro
 					sprite_id = u16;
 				}
 
-				if (image_space[sprite_id] == nullptr) {
-					GameSprite::NormalImage* img = newd GameSprite::NormalImage();
+				if (sprite_id >= image_space.size()) {
+					image_space.resize(sprite_id + 1, nullptr);
+				}
+
+				GameSprite::NormalImage*& img = image_space[sprite_id];
+				if (img == nullptr) {
+					img = newd GameSprite::NormalImage();
 					img->id = sprite_id;
-					image_space[sprite_id] = img;
 				}
-				sType->spriteList.push_back(static_cast<GameSprite::NormalImage*>(image_space[sprite_id]));
+				sType->spriteList.push_back(img);
 			}
 		}
 		++id;
@@ -805,6 +875,11 @@ bool GraphicManager::loadSpriteData(const FileName& datafile, wxString& error, w
 
 	if (!g_settings.getInteger(Config::USE_MEMCACHED_SPRITES)) {
 		spritefile = nstr(datafile.GetFullPath());
+		// Sprites are looked up in place if the file can be mapped,
+		// otherwise they are read from it one at a time
+		if (g_settings.getInteger(Config::USE_MAPPED_SPRITES)) {
+			sprite_mapping.open(spritefile, false);
+		}
 		unloaded = false;
 		return true;
 	}
@@ -824,20 +899,20 @@ bool GraphicManager::loadSpriteData(const FileName& datafile, wxString& error, w
 		uint16_t size;
 		safe_get(U16, size);
 
-		ImageMap::iterator it = image_space.find(id);
-		if (it != image_space.end()) {
-			GameSprite::NormalImage* spr = dynamic_cast<GameSprite::NormalImage*>(it->second);
-			if (spr && size > 0) {
+		if (size_t(id) < image_space.size() && image_space[id]) {
+			GameSprite::NormalImage* spr = image_space[id];
+			if (size > 0) {
 				if (spr->size > 0) {
 					wxString ss;
 					ss << "items.spr: Duplicate GameSprite id " << id;
 					warnings.push_back(ss);
 					fh.seekRelative(size);
 				} else {
+					uint8_t* dump = newd uint8_t[size];
 					spr->id = id;
 					spr->size = size;
-					spr->dump = newd uint8_t[size];
-					if (!fh.getRAW(spr->dump, size)) {
+					spr->dump = dump;
+					if (!fh.getRAW(dump, size)) {
 						error = wxstr(fh.getErrorMessage());
 						return false;
 					}
@@ -852,11 +927,12 @@ bool GraphicManager::loadSpriteData(const FileName& datafile, wxString& error, w
 	return true;
 }
 
-bool GraphicManager::loadSpriteDump(uint8_t*& target, uint16_t& size, int sprite_id) {
+bool GraphicManager::loadSpriteDump(const uint8_t*& target, uint16_t& size, bool& mapped, int sprite_id) {
 	if (g_settings.getInteger(Config::USE_MEMCACHED_SPRITES)) {
 		return false;
 	}
 
+	mapped = false;
 	if (sprite_id == 0) {
 		// Empty GameSprite
 		size = 0;
@@ -864,11 +940,45 @@ bool GraphicManager::loadSpriteDump(uint8_t*& target, uint16_t& size, int sprite
 		return true;
 	}
 
+	if (sprite_mapping.isOpen()) {
+		const uint8_t* data = sprite_mapping.getData();
+		const size_t file_size = sprite_mapping.getSize();
+
+		const size_t index = (is_extended ? 4 : 2) + sprite_id * sizeof(uint32_t);
+		if (index + sizeof(uint32_t) > file_size) {
+			return false;
+		}
+		uint32_t offset;
+		memcpy(&offset, data + index, sizeof(offset));
+		if (offset == 0) {
+			// Empty GameSprite
+			size = 0;
+			target = nullptr;
+			return true;
+		}
+
+		// Skip the color key
+		const size_t position = size_t(offset) + 3;
+		uint16_t sprite_size;
+		if (position + sizeof(sprite_size) > file_size) {
+			return false;
+		}
+		memcpy(&sprite_size, data + position, sizeof(sprite_size));
+		if (position + sizeof(sprite_size) + sprite_size > file_size) {
+			return false;
+		}
+
+		target = data + position + sizeof(sprite_size);
+		size = sprite_size;
+		mapped = true;
+		return true;
+	}
+
+	// This also runs on the decoder threads and must not change any state
 	FileReadHandle fh(spritefile);
 	if (!fh.isOk()) {
 		return false;
 	}
-	unloaded = false;
 
 	if (!fh.seek((is_extended ? 4 : 2) + sprite_id * sizeof(uint32_t))) {
 		return false;
@@ -879,47 +989,140 @@ bool GraphicManager::loadSpriteDump(uint8_t*& target, uint16_t& size, int sprite
 		fh.seek(to_seek + 3);
 		uint16_t sprite_size;
 		if (fh.getU16(sprite_size)) {
-			target = newd uint8_t[sprite_size];
-			if (fh.getRAW(target, sprite_size)) {
+			uint8_t* dump = newd uint8_t[sprite_size];
+			if (fh.getRAW(dump, sprite_size)) {
+				target = dump;
 				size = sprite_size;
 				return true;
 			}
-			delete[] target;
-			target = nullptr;
+			delete[] dump;
 		}
 	}
 	return false;
 }
 
-void GraphicManager::addSpriteToCleanup(GameSprite* spr) {
-	cleanup_list.push_back(spr);
-	// Clean if needed
-	if (cleanup_list.size() > std::max<uint32_t>(100, g_settings.getInteger(Config::SOFTWARE_CLEAN_THRESHOLD))) {
-		for (int i = 0; i < g_settings.getInteger(Config::SOFTWARE_CLEAN_SIZE) && static_cast<uint32_t>(i) < cleanup_list.size(); ++i) {
-			cleanup_list.front()->unloadDC();
-			cleanup_list.pop_front();
+uint8_t* GraphicManager::decodeSprite(uint32_t id) {
+	const uint8_t* dump = nullptr;
+	uint16_t size = 0;
+	bool mapped = false;
+	bool owned = false;
+	if (g_settings.getInteger(Config::USE_MEMCACHED_SPRITES)) {
+		// Memcached dumps are never freed while the sprites are loaded
+		GameSprite::NormalImage* image = image_space[id];
+		dump = image->dump;
+		size = image->size;
+	} else if (loadSpriteDump(dump, size, mapped, id)) {
+		owned = !mapped;
+	} else {
+		return nullptr;
+	}
+
+	uint8_t* rgba = newd uint8_t[SPRITE_PIXELS_SIZE * 4];
+	decodeSpriteRGBA(dump, size, has_transparency, rgba);
+	if (owned) {
+		delete[] dump;
+	}
+	return rgba;
+}
+
+bool GraphicManager::prefetchSprite(GameSprite* sprite) {
+	for (GameSprite::NormalImage* image : sprite->spriteList) {
+		if (image->isGLLoaded || image->decode_pending) {
+			continue;
+		}
+
+		if (!decoder.request(image->id)) {
+			return false;
 		}
+		image->decode_pending = true;
+	}
+	return true;
+}
+
+void GraphicManager::uploadPrefetchedSprites(int budget_ms) {
+	wxStopWatch watch;
+	uint32_t id;
+	uint8_t* rgba;
+	while (watch.Time() < budget_ms && decoder.takeResult(id, rgba)) {
+		GameSprite::NormalImage* image = image_space[id];
+		image->decode_pending = false;
+		// It may have been drawn and loaded in the meantime
+		if (rgba && !image->isGLLoaded) {
+			image->createGLTexture(rgba);
+		}
+		delete[] rgba;
 	}
 }
 
 void GraphicManager::garbageCollection() {
 	if (g_settings.getInteger(Config::TEXTURE_MANAGEMENT)) {
-		int t = time(nullptr);
-		if (loaded_textures > g_settings.getInteger(Config::TEXTURE_CLEAN_THRESHOLD) && t - lastclean > g_settings.getInteger(Config::TEXTURE_CLEAN_PULSE)) {
-			ImageMap::iterator iit = image_space.begin();
-			while (iit != image_space.end()) {
-				iit->second->clean(t);
-				++iit;
-			}
-			SpriteMap::iterator sit = sprite_space.begin();
-			while (sit != sprite_space.end()) {
-				GameSprite* gs = dynamic_cast<GameSprite*>(sit->second);
-				if (gs) {
-					gs->clean(t);
+		size_t budget = size_t(g_settings.getInteger(Config::TEXTURE_MEMORY_BUDGET)) * 1024 * 1024;
+		if (texture_stats.texture_bytes > budget) {
+			// Go a bit below the budget so that it is not exceeded again right away,
+			// but keep whatever was drawn since the last pass
+			size_t target = budget / 10 * 9;
+			evictAtlasPages(target);
+			// Then the sprite dumps and the textures on pages that are still in use
+			while (texture_stats.texture_bytes > target) {
+				GameSprite::Image* oldest = resident_images.back();
+				if (!oldest || oldest->last_use == collection_pass) {
+					break;
 				}
-				++sit;
+
+				oldest->evict();
+				updateResidentImage(oldest);
+				++texture_stats.evictions;
 			}
-			lastclean = t;
+		}
+	}
+	++collection_pass;
+
+	int t = time(nullptr);
+	if (t != stats_time) {
+		uint64_t hits = texture_stats.hits - stats_hits;
+		uint64_t lookups = hits + texture_stats.misses - stats_misses;
+		texture_stats.hit_rate = lookups > 0 ? float(hits) / lookups : 0.f;
+		texture_stats.evictions_per_second = float(texture_stats.evictions - stats_evictions) / (t - stats_time);
+
+		stats_time = t;
+		stats_hits = texture_stats.hits;
+		stats_misses = texture_stats.misses;
+		stats_evictions = texture_stats.evictions;
+	}
+}
+
+void GraphicManager::evictAtlasPages(size_t target) {
+	// A page is only freed once all of its slots are, so evicting single
+	// images would rarely free any. Pages go as a whole instead, the one
+	// drawn from least recently first, skipping those drawn from since the
+	// last pass.
+	const std::vector<std::vector<AtlasRegionOwner*>> pages = atlas.getPageOwners();
+	std::vector<std::pair<uint32_t, size_t>> order;
+	for (size_t index = 0; index < pages.size(); ++index) {
+		if (pages[index].empty()) {
+			continue;
+		}
+
+		uint32_t newest = 0;
+		for (AtlasRegionOwner* owner : pages[index]) {
+			// Only images own regions
+			newest = std::max(newest, static_cast<GameSprite::Image*>(owner)->last_use);
+		}
+		if (newest != collection_pass) {
+			order.emplace_back(newest, index);
+		}
+	}
+	std::sort(order.begin(), order.end());
+
+	for (const auto& entry : order) {
+		if (texture_stats.texture_bytes <= target) {
+			break;
+		}
+		for (AtlasRegionOwner* owner : pages[entry.second]) {
+			GameSprite::Image* image = static_cast<GameSprite::Image*>(owner);
+			image->evict();
+			updateResidentImage(image);
+			++texture_stats.evictions;
 		}
 	}
 }
@@ -961,7 +1164,11 @@ GameSprite::GameSprite() :
 	draw_height(0),
 	drawoffset_x(0),
 	drawoffset_y(0),
-	minimap_color(0) {
+	minimap_color(0),
+	has_average_color(false),
+	lru_prev(nullptr),
+	lru_next(nullptr),
+	dc_bytes(0) {
 	dc[SPRITE_SIZE_16x16] = nullptr;
 	dc[SPRITE_SIZE_32x32] = nullptr;
 }
@@ -975,14 +1182,6 @@ GameSprite::~GameSprite() {
 	delete animator;
 }
 
-void GameSprite::clean(int time) {
-	for (std::list<TemplateImage*>::iterator iter = instanced_templates.begin();
-		 iter != instanced_templates.end();
-		 ++iter) {
-		(*iter)->clean(time);
-	}
-}
-
 void GameSprite::unloadDC() {
 	delete dc[SPRITE_SIZE_16x16];
 	delete dc[SPRITE_SIZE_32x32];
@@ -1002,11 +1201,44 @@ uint8_t GameSprite::getMiniMapColor() const {
 	return minimap_color;
 }
 
+const wxColor& GameSprite::getAverageColor() {
+	if (has_average_color) {
+		return average_color;
+	}
+	has_average_color = true;
+
+	// The first width * height images are the first frame of the first layer and pattern
+	uint64_t red = 0, green = 0, blue = 0, alpha = 0;
+	size_t parts = std::min<size_t>(size_t(width) * height, spriteList.size());
+	for (size_t i = 0; i < parts; ++i) {
+		uint8_t* rgba = spriteList[i]->getRGBAData();
+		if (!rgba) {
+			continue;
+		}
+
+		for (int p = 0; p < SPRITE_PIXELS_SIZE; ++p) {
+			const uint8_t* pixel = rgba + p * 4;
+			red += pixel[0] * pixel[3];
+			green += pixel[1] * pixel[3];
+			blue += pixel[2] * pixel[3];
+			alpha += pixel[3];
+		}
+		delete[] rgba;
+	}
+
+	if (alpha == 0) {
+		average_color = wxColor(0, 0, 0, 0);
+	} else {
+		average_color = wxColor(uint8_t(red / alpha), uint8_t(green / alpha), uint8_t(blue / alpha), uint8_t(std::min<uint64_t>(alpha / SPRITE_PIXELS_SIZE, 255)));
+	}
+	return average_color;
+}
+
 int GameSprite::getIndex(int width, int height, int layer, int pattern_x, int pattern_y, int pattern_z, int frame) const {
 	return ((((((frame % this->frames) * this->pattern_z + pattern_z) * this->pattern_y + pattern_y) * this->pattern_x + pattern_x) * this->layers + layer) * this->height + height) * this->width + width;
 }
 
-GLuint GameSprite::getHardwareID(int _x, int _y, int _layer, int _count, int _pattern_x, int _pattern_y, int _pattern_z, int _frame) {
+const AtlasRegion* GameSprite::getAtlasRegion(int _x, int _y, int _layer, int _count, int _pattern_x, int _pattern_y, int _pattern_z, int _frame) {
 	uint32_t v;
 	if (_count >= 0 && height <= 1 && width <= 1) {
 		v = _count;
@@ -1020,7 +1252,7 @@ GLuint GameSprite::getHardwareID(int _x, int _y, int _layer, int _count, int _pa
 			v %= numsprites;
 		}
 	}
-	return spriteList[v]->getHardwareID();
+	return spriteList[v]->getAtlasRegion();
 }
 
 GameSprite::TemplateImage* GameSprite::getTemplateImage(int sprite_index, const Outfit& outfit) {
@@ -1044,7 +1276,7 @@ GameSprite::TemplateImage* GameSprite::getTemplateImage(int sprite_index, const
 	return img;
 }
 
-GLuint GameSprite::getHardwareID(int _x, int _y, int _dir, int _addon, int _pattern_z, const Outfit& _outfit, int _frame) {
+const AtlasRegion* GameSprite::getAtlasRegion(int _x, int _y, int _dir, int _addon, int _pattern_z, const Outfit& _outfit, int _frame) {
 	uint32_t v = getIndex(_x, _y, 0, _dir, _addon, _pattern_z, _frame);
 	if (v >= numsprites) {
 		if (numsprites == 1) {
@@ -1055,9 +1287,9 @@ GLuint GameSprite::getHardwareID(int _x, int _y, int _dir, int _addon, int _patt
 	}
 	if (layers > 1) { // Template
 		TemplateImage* img = getTemplateImage(v, _outfit);
-		return img->getHardwareID();
+		return img->getAtlasRegion();
 	}
-	return spriteList[v]->getHardwareID();
+	return spriteList[v]->getAtlasRegion();
 }
 
 wxMemoryDC* GameSprite::getDC(SpriteSize size) {
@@ -1095,12 +1327,23 @@ wxMemoryDC* GameSprite::getDC(SpriteSize size) {
 
 		wxBitmap bmp(image);
 		dc[size] = newd wxMemoryDC(bmp);
-		g_gui.gfx.addSpriteToCleanup(this);
 		image.Destroy();
 	}
+	g_gui.gfx.updateResidentSprite(this);
 	return dc[size];
 }
 
+size_t GameSprite::getDCBytes() const {
+	size_t bytes = 0;
+	if (dc[SPRITE_SIZE_16x16]) {
+		bytes += 16 * 16 * 4;
+	}
+	if (dc[SPRITE_SIZE_32x32]) {
+		bytes += SPRITE_PIXELS_SIZE * 4;
+	}
+	return bytes;
+}
+
 void GameSprite::DrawTo(wxDC* dc, SpriteSize sz, int start_x, int start_y, int width, int height) {
 	if (width == -1) {
 		width = sz == SPRITE_SIZE_32x32 ? 32 : 16;
@@ -1121,15 +1364,34 @@ void GameSprite::DrawTo(wxDC* dc, SpriteSize sz, int start_x, int start_y, int w
 
 GameSprite::Image::Image() :
 	isGLLoaded(false),
-	lastaccess(0) {
-	////
+	last_use(0),
+	lru_prev(nullptr),
+	lru_next(nullptr),
+	resident_bytes(0) {
+	region.owner = this;
 }
 
 GameSprite::Image::~Image() {
-	unloadGLTexture(0);
+	if (isGLLoaded) {
+		unloadGLTexture();
+	}
 }
 
-void GameSprite::Image::createGLTexture(GLuint whatid) {
+const AtlasRegion* GameSprite::Image::getAtlasRegion() {
+	if (isGLLoaded) {
+		++g_gui.gfx.texture_stats.hits;
+	} else {
+		++g_gui.gfx.texture_stats.misses;
+		createGLTexture();
+		if (!isGLLoaded) {
+			return nullptr;
+		}
+	}
+	visit();
+	return &region;
+}
+
+void GameSprite::Image::createGLTexture() {
 	ASSERT(!isGLLoaded);
 
 	uint8_t* rgba = getRGBAData();
@@ -1137,178 +1399,110 @@ void GameSprite::Image::createGLTexture(GLuint whatid) {
 		return;
 	}
 
-	isGLLoaded = true;
-	g_gui.gfx.loaded_textures += 1;
-
-	glBindTexture(GL_TEXTURE_2D, whatid);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST); // Nearest-neighbor
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST); // Nearest-neighbor
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, 0x812F); // GL_CLAMP_TO_EDGE
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, 0x812F); // GL_CLAMP_TO_EDGE
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, SPRITE_PIXELS, SPRITE_PIXELS, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
-
+	createGLTexture(rgba);
 	delete[] rgba;
-#undef SPRITE_SIZE
 }
 
-void GameSprite::Image::unloadGLTexture(GLuint whatid) {
+void GameSprite::Image::createGLTexture(const uint8_t* rgba) {
+	if (g_gui.gfx.atlas.add(rgba, region)) {
+		isGLLoaded = true;
+		g_gui.gfx.loaded_textures += 1;
+		g_gui.gfx.updateResidentImage(this);
+	}
+}
+
+void GameSprite::Image::unloadGLTexture() {
 	isGLLoaded = false;
 	g_gui.gfx.loaded_textures -= 1;
-	glDeleteTextures(1, &whatid);
+	g_gui.gfx.atlas.remove(region);
 }
 
 void GameSprite::Image::visit() {
-	lastaccess = time(nullptr);
+	last_use = g_gui.gfx.collection_pass;
+	g_gui.gfx.resident_images.touch(this);
 }
 
-void GameSprite::Image::clean(int time) {
-	if (isGLLoaded && time - lastaccess > g_settings.getInteger(Config::TEXTURE_LONGEVITY)) {
-		unloadGLTexture(0);
+void GameSprite::Image::evict() {
+	if (isGLLoaded) {
+		unloadGLTexture();
 	}
 }
 
+size_t GameSprite::Image::getResidentBytes() const {
+	return 0;
+}
+
 GameSprite::NormalImage::NormalImage() :
 	id(0),
 	size(0),
-	dump(nullptr) {
+	dump(nullptr),
+	dump_mapped(false),
+	decode_pending(false) {
 	////
 }
 
 GameSprite::NormalImage::~NormalImage() {
-	delete[] dump;
+	if (!dump_mapped) {
+		delete[] dump;
+	}
 }
 
-void GameSprite::NormalImage::clean(int time) {
-	Image::clean(time);
-	if (time - lastaccess > 5 && !g_settings.getInteger(Config::USE_MEMCACHED_SPRITES)) { // We keep dumps around for 5 seconds.
+void GameSprite::NormalImage::evict() {
+	Image::evict();
+	// Mapped dumps cost nothing to keep, the system pages them out
+	if (!dump_mapped && !g_settings.getInteger(Config::USE_MEMCACHED_SPRITES)) {
 		delete[] dump;
 		dump = nullptr;
 	}
 }
 
-uint8_t* GameSprite::NormalImage::getRGBData() {
-	if (!dump) {
-		if (g_settings.getInteger(Config::USE_MEMCACHED_SPRITES)) {
-			return nullptr;
-		}
-
-		if (!g_gui.gfx.loadSpriteDump(dump, size, id)) {
-			return nullptr;
-		}
+size_t GameSprite::NormalImage::getResidentBytes() const {
+	size_t bytes = Image::getResidentBytes();
+	if (dump && !dump_mapped && !g_settings.getInteger(Config::USE_MEMCACHED_SPRITES)) {
+		bytes += size;
 	}
-
-	const int pixels_data_size = SPRITE_PIXELS * SPRITE_PIXELS * 3;
-	uint8_t* data = newd uint8_t[pixels_data_size];
-	uint8_t bpp = g_gui.gfx.hasTransparency() ? 4 : 3;
-	int write = 0;
-	int read = 0;
-
-	// decompress pixels
-	while (read < size && write < pixels_data_size) {
-		int transparent = dump[read] | dump[read + 1] << 8;
-		read += 2;
-		for (int i = 0; i < transparent && write < pixels_data_size; i++) {
-			data[write + 0] = 0xFF; // red
-			data[write + 1] = 0x00; // green
-			data[write + 2] = 0xFF; // blue
-			write += 3;
-		}
-
-		int colored = dump[read] | dump[read + 1] << 8;
-		read += 2;
-		for (int i = 0; i < colored && write < pixels_data_size; i++) {
-			data[write + 0] = dump[read + 0]; // red
-			data[write + 1] = dump[read + 1]; // green
-			data[write + 2] = dump[read + 2]; // blue
-			write += 3;
-			read += bpp;
-		}
-	}
-
-	// fill remaining pixels
-	while (write < pixels_data_size) {
-		data[write + 0] = 0xFF; // red
-		data[write + 1] = 0x00; // green
-		data[write + 2] = 0xFF; // blue
-		write += 3;
-	}
-	return data;
+	return bytes;
 }
 
-uint8_t* GameSprite::NormalImage::getRGBAData() {
-	if (!dump) {
-		if (g_settings.getInteger(Config::USE_MEMCACHED_SPRITES)) {
-			return nullptr;
-		}
-
-		if (!g_gui.gfx.loadSpriteDump(dump, size, id)) {
-			return nullptr;
-		}
+bool GameSprite::NormalImage::loadDump() {
+	if (dump) {
+		return true;
 	}
 
-	const int pixels_data_size = SPRITE_PIXELS_SIZE * 4;
-	uint8_t* data = newd uint8_t[pixels_data_size];
-	bool use_alpha = g_gui.gfx.hasTransparency();
-	uint8_t bpp = use_alpha ? 4 : 3;
-	int write = 0;
-	int read = 0;
-
-	// decompress pixels
-	while (read < size && write < pixels_data_size) {
-		int transparent = dump[read] | dump[read + 1] << 8;
-		if (use_alpha && transparent >= SPRITE_PIXELS_SIZE) { // Corrupted sprite?
-			break;
-		}
-		read += 2;
-		for (int i = 0; i < transparent && write < pixels_data_size; i++) {
-			data[write + 0] = 0x00; // red
-			data[write + 1] = 0x00; // green
-			data[write + 2] = 0x00; // blue
-			data[write + 3] = 0x00; // alpha
-			write += 4;
-		}
+	if (g_settings.getInteger(Config::USE_MEMCACHED_SPRITES)) {
+		return false;
+	}
 
-		int colored = dump[read] | dump[read + 1] << 8;
-		read += 2;
-		for (int i = 0; i < colored && write < pixels_data_size; i++) {
-			data[write + 0] = dump[read + 0]; // red
-			data[write + 1] = dump[read + 1]; // green
-			data[write + 2] = dump[read + 2]; // blue
-			data[write + 3] = use_alpha ? dump[read + 3] : 0xFF; // alpha
-			write += 4;
-			read += bpp;
-		}
+	if (!g_gui.gfx.loadSpriteDump(dump, size, dump_mapped, id)) {
+		return false;
 	}
 
-	// fill remaining pixels
-	while (write < pixels_data_size) {
-		data[write + 0] = 0x00; // red
-		data[write + 1] = 0x00; // green
-		data[write + 2] = 0x00; // blue
-		data[write + 3] = 0x00; // alpha
-		write += 4;
+	if (!dump_mapped) {
+		g_gui.gfx.updateResidentImage(this);
 	}
-	return data;
+	return true;
 }
 
-GLuint GameSprite::NormalImage::getHardwareID() {
-	if (!isGLLoaded) {
-		createGLTexture(id);
+uint8_t* GameSprite::NormalImage::getRGBData() {
+	if (!loadDump()) {
+		return nullptr;
 	}
-	visit();
-	return id;
-}
 
-void GameSprite::NormalImage::createGLTexture(GLuint ignored) {
-	Image::createGLTexture(id);
+	uint8_t* data = newd uint8_t[SPRITE_PIXELS_SIZE * 3];
+	decodeSpriteRGB(dump, size, g_gui.gfx.hasTransparency(), data);
+	return data;
 }
 
-void GameSprite::NormalImage::unloadGLTexture(GLuint ignored) {
-	Image::unloadGLTexture(id);
+uint8_t* GameSprite::NormalImage::getRGBAData() {
+	if (!loadDump()) {
+		return nullptr;
+	}
+	uint8_t* data = newd uint8_t[SPRITE_PIXELS_SIZE * 4];
+	decodeSpriteRGBA(dump, size, g_gui.gfx.hasTransparency(), data);
+	return data;
 }
 
 GameSprite::TemplateImage::TemplateImage(GameSprite* parent, int v, const Outfit& outfit) :
-	gl_tid(0),
 	parent(parent),
 	sprite_index(v),
 	lookHead(outfit.lookHead),
@@ -1322,16 +1516,6 @@ GameSprite::TemplateImage::~TemplateImage() {
 	////
 }
 
-void GameSprite::TemplateImage::colorizePixel(uint8_t color, uint8_t& red, uint8_t& green, uint8_t& blue) {
-	// Thanks! Khaos, or was it mips? Hmmm... =)
-	uint8_t ro = (TemplateOutfitLookupTable[color] & 0xFF0000) >> 16; // rgb outfit
-	uint8_t go = (TemplateOutfitLookupTable[color] & 0xFF00) >> 8;
-	uint8_t bo = (TemplateOutfitLookupTable[color] & 0xFF);
-	red = (uint8_t)(red * (ro / 255.f));
-	green = (uint8_t)(green * (go / 255.f));
-	blue = (uint8_t)(blue * (bo / 255.f));
-}
-
 uint8_t* GameSprite::TemplateImage::getRGBData() {
 	uint8_t* rgbdata = parent->spriteList[sprite_index]->getRGBData();
 	uint8_t* template_rgbdata = parent->spriteList[sprite_index + parent->height * parent->width]->getRGBData();
@@ -1345,40 +1529,20 @@ uint8_t* GameSprite::TemplateImage::getRGBData() {
 		return nullptr;
 	}
 
-	if (lookHead > (sizeof(TemplateOutfitLookupTable) / sizeof(TemplateOutfitLookupTable[0]))) {
+	if (lookHead >= (sizeof(TemplateOutfitLookupTable) / sizeof(TemplateOutfitLookupTable[0]))) {
 		lookHead = 0;
 	}
-	if (lookBody > (sizeof(TemplateOutfitLookupTable) / sizeof(TemplateOutfitLookupTable[0]))) {
+	if (lookBody >= (sizeof(TemplateOutfitLookupTable) / sizeof(TemplateOutfitLookupTable[0]))) {
 		lookBody = 0;
 	}
-	if (lookLegs > (sizeof(TemplateOutfitLookupTable) / sizeof(TemplateOutfitLookupTable[0]))) {
+	if (lookLegs >= (sizeof(TemplateOutfitLookupTable) / sizeof(TemplateOutfitLookupTable[0]))) {
 		lookLegs = 0;
 	}
-	if (lookFeet > (sizeof(TemplateOutfitLookupTable) / sizeof(TemplateOutfitLookupTable[0]))) {
+	if (lookFeet >= (sizeof(TemplateOutfitLookupTable) / sizeof(TemplateOutfitLookupTable[0]))) {
 		lookFeet = 0;
 	}
 
-	for (int y = 0; y < SPRITE_PIXELS; ++y) {
-		for (int x = 0; x < SPRITE_PIXELS; ++x) {
-			uint8_t& red = rgbdata[y * SPRITE_PIXELS * 3 + x * 3 + 0];
-			uint8_t& green = rgbdata[y * SPRITE_PIXELS * 3 + x * 3 + 1];
-			uint8_t& blue = rgbdata[y * SPRITE_PIXELS * 3 + x * 3 + 2];
-
-			uint8_t& tred = template_rgbdata[y * SPRITE_PIXELS * 3 + x * 3 + 0];
-			uint8_t& tgreen = template_rgbdata[y * SPRITE_PIXELS * 3 + x * 3 + 1];
-			uint8_t& tblue = template_rgbdata[y * SPRITE_PIXELS * 3 + x * 3 + 2];
-
-			if (tred && tgreen && !tblue) { // yellow => head
-				colorizePixel(lookHead, red, green, blue);
-			} else if (tred && !tgreen && !tblue) { // red => body
-				colorizePixel(lookBody, red, green, blue);
-			} else if (!tred && tgreen && !tblue) { // green => legs
-				colorizePixel(lookLegs, red, green, blue);
-			} else if (!tred && !tgreen && tblue) { // blue => feet
-				colorizePixel(lookFeet, red, green, blue);
-			}
-		}
-	}
+	colorizeTemplate(rgbdata, 3, template_rgbdata, TemplateOutfitLookupTable[lookHead], TemplateOutfitLookupTable[lookBody], TemplateOutfitLookupTable[lookLegs], TemplateOutfitLookupTable[lookFeet]);
 	delete[] template_rgbdata;
 	return rgbdata;
 }
@@ -1396,66 +1560,24 @@ uint8_t* GameSprite::TemplateImage::getRGBAData() {
 		return nullptr;
 	}
 
-	if (lookHead > (sizeof(TemplateOutfitLookupTable) / sizeof(TemplateOutfitLookupTable[0]))) {
+	if (lookHead >= (sizeof(TemplateOutfitLookupTable) / sizeof(TemplateOutfitLookupTable[0]))) {
 		lookHead = 0;
 	}
-	if (lookBody > (sizeof(TemplateOutfitLookupTable) / sizeof(TemplateOutfitLookupTable[0]))) {
+	if (lookBody >= (sizeof(TemplateOutfitLookupTable) / sizeof(TemplateOutfitLookupTable[0]))) {
 		lookBody = 0;
 	}
-	if (lookLegs > (sizeof(TemplateOutfitLookupTable) / sizeof(TemplateOutfitLookupTable[0]))) {
+	if (lookLegs >= (sizeof(TemplateOutfitLookupTable) / sizeof(TemplateOutfitLookupTable[0]))) {
 		lookLegs = 0;
 	}
-	if (lookFeet > (sizeof(TemplateOutfitLookupTable) / sizeof(TemplateOutfitLookupTable[0]))) {
+	if (lookFeet >= (sizeof(TemplateOutfitLookupTable) / sizeof(TemplateOutfitLookupTable[0]))) {
 		lookFeet = 0;
 	}
 
-	for (int y = 0; y < SPRITE_PIXELS; ++y) {
-		for (int x = 0; x < SPRITE_PIXELS; ++x) {
-			uint8_t& red = rgbadata[y * SPRITE_PIXELS * 4 + x * 4 + 0];
-			uint8_t& green = rgbadata[y * SPRITE_PIXELS * 4 + x * 4 + 1];
-			uint8_t& blue = rgbadata[y * SPRITE_PIXELS * 4 + x * 4 + 2];
-
-			uint8_t& tred = template_rgbdata[y * SPRITE_PIXELS * 3 + x * 3 + 0];
-			uint8_t& tgreen = template_rgbdata[y * SPRITE_PIXELS * 3 + x * 3 + 1];
-			uint8_t& tblue = template_rgbdata[y * SPRITE_PIXELS * 3 + x * 3 + 2];
-
-			if (tred && tgreen && !tblue) { // yellow => head
-				colorizePixel(lookHead, red, green, blue);
-			} else if (tred && !tgreen && !tblue) { // red => body
-				colorizePixel(lookBody, red, green, blue);
-			} else if (!tred && tgreen && !tblue) { // green => legs
-				colorizePixel(lookLegs, red, green, blue);
-			} else if (!tred && !tgreen && tblue) { // blue => feet
-				colorizePixel(lookFeet, red, green, blue);
-			}
-		}
-	}
+	colorizeTemplate(rgbadata, 4, template_rgbdata, TemplateOutfitLookupTable[lookHead], TemplateOutfitLookupTable[lookBody], TemplateOutfitLookupTable[lookLegs], TemplateOutfitLookupTable[lookFeet]);
 	delete[] template_rgbdata;
 	return rgbadata;
 }
 
-GLuint GameSprite::TemplateImage::getHardwareID() {
-	if (!isGLLoaded) {
-		if (gl_tid == 0) {
-			gl_tid = g_gui.gfx.getFreeTextureID();
-		}
-		createGLTexture(gl_tid);
-		if (!isGLLoaded) {
-			return 0;
-		}
-	}
-	visit();
-	return gl_tid;
-}
-
-void GameSprite::TemplateImage::createGLTexture(GLuint unused) {
-	Image::createGLTexture(gl_tid);
-}
-
-void GameSprite::TemplateImage::unloadGLTexture(GLuint unused) {
-	Image::unloadGLTexture(gl_tid);
-}
-
 // ============================================================================
 // Animator
 
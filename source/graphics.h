@@ -23,6 +23,9 @@
 #include <deque>
 
 #include "client_version.h"
+#include "filehandle.h"
+#include "texture_atlas.h"
+#include "sprite_decoder.h"
 
 enum SpriteSize {
 	SPRITE_SIZE_16x16,
@@ -45,6 +48,89 @@ class GraphicManager;
 class FileReadHandle;
 class Animator;
 
+// Intrusive list of resident objects, most recently used first. T provides
+// lru_prev and lru_next pointers that are null while it is not listed.
+template <typename T>
+class LRUList {
+public:
+	LRUList() :
+		head(nullptr), tail(nullptr) {
+		////
+	}
+
+	bool contains(const T* item) const {
+		return item->lru_prev || head == item;
+	}
+
+	// The least recently used item
+	T* back() const {
+		return tail;
+	}
+
+	// Moves the item to the front, adding it if it was not listed
+	void touch(T* item) {
+		if (head == item) {
+			return;
+		}
+
+		remove(item);
+		item->lru_next = head;
+		if (head) {
+			head->lru_prev = item;
+		} else {
+			tail = item;
+		}
+		head = item;
+	}
+
+	void remove(T* item) {
+		if (!contains(item)) {
+			return;
+		}
+
+		if (item->lru_prev) {
+			item->lru_prev->lru_next = item->lru_next;
+		} else {
+			head = item->lru_next;
+		}
+		if (item->lru_next) {
+			item->lru_next->lru_prev = item->lru_prev;
+		} else {
+			tail = item->lru_prev;
+		}
+		item->lru_prev = nullptr;
+		item->lru_next = nullptr;
+	}
+
+	// Forgets all items without unlinking them, for when they are all deleted
+	void reset() {
+		head = nullptr;
+		tail = nullptr;
+	}
+
+private:
+	T* head;
+	T* tail;
+};
+
+struct TextureStats {
+	TextureStats() :
+		texture_bytes(0), software_bytes(0), hits(0), misses(0), evictions(0), hit_rate(0.f), evictions_per_second(0.f) {
+		////
+	}
+
+	// Bytes held by the atlas pages and sprite dumps, and by the wx bitmaps of
+	// the palettes
+	size_t texture_bytes;
+	size_t software_bytes;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	// Over the last second
+	float hit_rate;
+	float evictions_per_second;
+};
+
 struct SpriteLight {
 	uint8_t intensity = 0;
 	uint8_t color = 0;
@@ -81,17 +167,19 @@ public:
 	~GameSprite();
 
 	int getIndex(int width, int height, int layer, int pattern_x, int pattern_y, int pattern_z, int frame) const;
-	GLuint getHardwareID(int _x, int _y, int _layer, int _subtype, int _pattern_x, int _pattern_y, int _pattern_z, int _frame);
-	GLuint getHardwareID(int _x, int _y, int _dir, int _addon, int _pattern_z, const Outfit& _outfit, int _frame); // CreatureDatabase
+	// Where the image is in the texture atlas, nullptr if it could not be loaded
+	const AtlasRegion* getAtlasRegion(int _x, int _y, int _layer, int _subtype, int _pattern_x, int _pattern_y, int _pattern_z, int _frame);
+	const AtlasRegion* getAtlasRegion(int _x, int _y, int _dir, int _addon, int _pattern_z, const Outfit& _outfit, int _frame); // CreatureDatabase
 	virtual void DrawTo(wxDC* dc, SpriteSize sz, int start_x, int start_y, int width = -1, int height = -1);
 
 	virtual void unloadDC();
 
-	void clean(int time);
-
 	int getDrawHeight() const;
 	std::pair<int, int> getDrawOffset() const;
 	uint8_t getMiniMapColor() const;
+	// Alpha weighted mean colour of the first frame, its alpha is how much of
+	// a tile the sprite covers. Drawn instead of the sprite when zoomed far out.
+	const wxColor& getAverageColor();
 
 	bool hasLight() const noexcept {
 		return has_light;
@@ -106,26 +194,40 @@ protected:
 	class TemplateImage;
 
 	wxMemoryDC* getDC(SpriteSize size);
+	size_t getDCBytes() const;
 	TemplateImage* getTemplateImage(int sprite_index, const Outfit& outfit);
 
-	class Image {
+	class Image : public AtlasRegionOwner {
 	public:
 		Image();
 		virtual ~Image();
 
 		bool isGLLoaded;
-		int lastaccess;
-
-		void visit();
-		virtual void clean(int time);
-
-		virtual GLuint getHardwareID() = 0;
+		// Garbage collection pass the image was last drawn in
+		uint32_t last_use;
+		AtlasRegion region;
+
+		// Links in the least recently used list of the graphic manager, and
+		// the bytes the image was last accounted with there
+		Image* lru_prev;
+		Image* lru_next;
+		size_t resident_bytes;
+
+		virtual void visit();
+		// Frees everything that can be loaded again
+		virtual void evict();
+		// What the image holds besides its atlas slot, which is accounted
+		// for with the whole page
+		virtual size_t getResidentBytes() const;
+
+		const AtlasRegion* getAtlasRegion();
 		virtual uint8_t* getRGBData() = 0;
 		virtual uint8_t* getRGBAData() = 0;
 
 	protected:
-		virtual void createGLTexture(GLuint whatid);
-		virtual void unloadGLTexture(GLuint whatid);
+		void createGLTexture();
+		void createGLTexture(const uint8_t* rgba);
+		void unloadGLTexture();
 	};
 
 	class NormalImage : public Image {
@@ -136,19 +238,22 @@ protected:
 		// We use the sprite id as GL texture id
 		uint32_t id;
 
-		// This contains the pixel data
+		// This contains the pixel data, it points into the sprite file if
+		// that is mapped into memory and is owned by the image otherwise
 		uint16_t size;
-		uint8_t* dump;
+		const uint8_t* dump;
+		bool dump_mapped;
+		// Queued for decoding on a worker thread
+		bool decode_pending;
 
-		virtual void clean(int time);
+		virtual void evict();
+		virtual size_t getResidentBytes() const;
 
-		virtual GLuint getHardwareID();
 		virtual uint8_t* getRGBData();
 		virtual uint8_t* getRGBAData();
 
 	protected:
-		virtual void createGLTexture(GLuint ignored = 0);
-		virtual void unloadGLTexture(GLuint ignored = 0);
+		bool loadDump();
 	};
 
 	class TemplateImage : public Image {
@@ -156,23 +261,15 @@ protected:
 		TemplateImage(GameSprite* parent, int v, const Outfit& outfit);
 		virtual ~TemplateImage();
 
-		virtual GLuint getHardwareID();
 		virtual uint8_t* getRGBData();
 		virtual uint8_t* getRGBAData();
 
-		GLuint gl_tid;
 		GameSprite* parent;
 		int sprite_index;
 		uint8_t lookHead;
 		uint8_t lookBody;
 		uint8_t lookLegs;
 		uint8_t lookFeet;
-
-	protected:
-		void colorizePixel(uint8_t color, uint8_t& r, uint8_t& b, uint8_t& g);
-
-		virtual void createGLTexture(GLuint ignored = 0);
-		virtual void unloadGLTexture(GLuint ignored = 0);
 	};
 
 	uint32_t id;
@@ -197,12 +294,20 @@ public:
 
 	uint16_t minimap_color;
 
+	wxColor average_color;
+	bool has_average_color;
+
 	bool has_light = false;
 	SpriteLight light;
 
 	std::vector<NormalImage*> spriteList;
 	std::list<TemplateImage*> instanced_templates; // Templates that use this sprite
 
+	// Links in the least recently used list of palette bitmaps
+	GameSprite* lru_prev;
+	GameSprite* lru_next;
+	size_t dc_bytes;
+
 	friend class GraphicManager;
 };
 
@@ -281,9 +386,6 @@ public:
 	uint16_t getItemSpriteMaxID() const;
 	uint16_t getCreatureSpriteMaxID() const;
 
-	// Get an unused texture id (this is acquired by simply increasing a value starting from 0x10000000)
-	GLuint getFreeTextureID();
-
 	// This is part of the binary
 	bool loadEditorSprites();
 	// Metadata should be loaded first
@@ -293,9 +395,24 @@ public:
 	bool loadSpriteMetadataFlags(FileReadHandle& file, GameSprite* sType, wxString& error, wxArrayString& warnings);
 	bool loadSpriteData(const FileName& datafile, wxString& error, wxArrayString& warnings);
 
-	// Cleans old & unused textures according to config settings
+	// Evicts the least recently used textures once they exceed the memory budget
 	void garbageCollection();
-	void addSpriteToCleanup(GameSprite* spr);
+	// Accounts for the bitmaps of the sprite and evicts old ones over the budget
+	void updateResidentSprite(GameSprite* sprite);
+	const TextureStats& getTextureStats() const {
+		return texture_stats;
+	}
+
+	// Decodes the images of the sprite in the background so that they are
+	// ready when it is drawn, false if the decoder can't take all of them now
+	bool prefetchSprite(GameSprite* sprite);
+	// Uploads prefetched images until the time budget is used up
+	void uploadPrefetchedSprites(int budget_ms);
+	// Changes whenever all textures are freed, so anything holding on to
+	// atlas regions knows to look them up again
+	uint32_t getTextureGeneration() const {
+		return atlas.getGeneration();
+	}
 
 	wxFileName getMetadataFileName() const {
 		return metadata_file;
@@ -313,13 +430,26 @@ private:
 	bool unloaded;
 	// This is used if memcaching is NOT on
 	std::string spritefile;
-	bool loadSpriteDump(uint8_t*& target, uint16_t& size, int sprite_id);
-
-	typedef std::map<int, Sprite*> SpriteMap;
-	SpriteMap sprite_space;
-	typedef std::map<int, GameSprite::Image*> ImageMap;
-	ImageMap image_space;
-	std::deque<GameSprite*> cleanup_list;
+	MemoryMappedFile sprite_mapping;
+	bool loadSpriteDump(const uint8_t*& target, uint16_t& size, bool& mapped, int sprite_id);
+	// Runs on the decoder threads
+	uint8_t* decodeSprite(uint32_t id);
+	SpriteDecoder decoder;
+
+	// Item and creature sprites by id, and the editor sprites by their
+	// offset from EDITOR_SPRITE_SELECTION_MARKER
+	std::vector<GameSprite*> sprite_space;
+	std::vector<Sprite*> editor_sprite_space;
+	// Images by sprite id
+	std::vector<GameSprite::NormalImage*> image_space;
+	// Images holding a texture or a sprite dump, and sprites holding palette
+	// bitmaps, evicted from the back when over budget
+	LRUList<GameSprite::Image> resident_images;
+	LRUList<GameSprite> resident_sprites;
+
+	void updateResidentImage(GameSprite::Image* image);
+	void evictAtlasPages(size_t target);
+	Sprite*& editorSprite(int id);
 
 	DatFormat dat_format;
 	uint16_t item_count;
@@ -332,8 +462,18 @@ private:
 	wxFileName metadata_file;
 	wxFileName sprites_file;
 
+	// Holds the textures of all loaded images
+	TextureAtlas atlas;
 	int loaded_textures;
-	int lastclean;
+	// Bytes of the sprite dumps held by images
+	size_t dump_bytes;
+	uint32_t collection_pass;
+	TextureStats texture_stats;
+	// Start of the current statistics window
+	int stats_time;
+	uint64_t stats_hits;
+	uint64_t stats_misses;
+	uint64_t stats_evictions;
 
 	wxStopWatch* animation_timer;
 
@@ -22,6 +22,8 @@
 #include "basemap.h"
 
 uint32_t GroundBrush::border_types[256];
+std::vector<const GroundBrush::BorderBlock*> GroundBrush::border_table;
+uint32_t GroundBrush::border_table_size = 0;
 
 int AutoBorder::edgeNameToID(const std::string& edgename) {
 	if (edgename == "n") {
@@ -122,7 +124,8 @@ GroundBrush::GroundBrush() :
 	optional_border(nullptr),
 	use_only_optional(false),
 	randomize(true),
-	total_chance(0) {
+	total_chance(0),
+	ground_index(0xFFFFFFFF) {
 	////
 }
 
@@ -556,7 +559,18 @@ void GroundBrush::draw(BaseMap* map, Tile* tile, void* parameter) {
 			return;
 		}
 	}
-	int chance = random(1, total_chance);
+	placeGround(tile, random(1, total_chance));
+}
+
+void GroundBrush::redraw(Tile* tile, uint32_t seed) {
+	ASSERT(tile);
+	if (border_items.empty()) {
+		return;
+	}
+	placeGround(tile, total_chance > 0 ? 1 + static_cast<int>(seed % total_chance) : 1);
+}
+
+void GroundBrush::placeGround(Tile* tile, int chance) {
 	uint16_t id = 0;
 	for (std::vector<ItemChanceBlock>::const_iterator it = border_items.begin(); it != border_items.end(); ++it) {
 		if (chance < it->chance) {
@@ -572,6 +586,38 @@ void GroundBrush::draw(BaseMap* map, Tile* tile, void* parameter) {
 }
 
 const GroundBrush::BorderBlock* GroundBrush::getBrushTo(GroundBrush* first, GroundBrush* second) {
+	const uint32_t none = border_table_size - 1;
+	const uint32_t row = first ? first->ground_index : none;
+	const uint32_t column = second ? second->ground_index : none;
+	if (row < border_table_size && column < border_table_size) {
+		return border_table[row * border_table_size + column];
+	}
+	return findBrushTo(first, second);
+}
+
+void GroundBrush::buildBorderTable(const std::vector<GroundBrush*>& ground_brushes) {
+	const uint32_t count = static_cast<uint32_t>(ground_brushes.size());
+	for (uint32_t index = 0; index < count; ++index) {
+		ground_brushes[index]->ground_index = index;
+	}
+
+	border_table_size = count + 1;
+	border_table.assign(border_table_size * border_table_size, nullptr);
+	for (uint32_t row = 0; row <= count; ++row) {
+		GroundBrush* first = row < count ? ground_brushes[row] : nullptr;
+		for (uint32_t column = 0; column <= count; ++column) {
+			GroundBrush* second = column < count ? ground_brushes[column] : nullptr;
+			border_table[row * border_table_size + column] = findBrushTo(first, second);
+		}
+	}
+}
+
+void GroundBrush::clearBorderTable() {
+	border_table.clear();
+	border_table_size = 0;
+}
+
+const GroundBrush::BorderBlock* GroundBrush::findBrushTo(GroundBrush* first, GroundBrush* second) {
 	// printf("Border from %s to %s : ", first->getName().c_str(), second->getName().c_str());
 	if (first) {
 		if (second) {
@@ -710,8 +756,7 @@ void GroundBrush::doBorders(BaseMap* map, Tile* tile) {
 		neighbours[7] = { false, extractGroundBrushFromTile(map, x + 1, y + 1, z) };
 	}
 
-	static std::vector<const BorderBlock*> specificList;
-	specificList.clear();
+	std::vector<const BorderBlock*> specificList;
 
 	std::vector<BorderCluster> borderList;
 	for (int32_t i = 0; i < 8; ++i) {
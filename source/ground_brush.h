@@ -43,8 +43,15 @@ public:
 
 	virtual void draw(BaseMap* map, Tile* tile, void* parameter);
 	virtual void undraw(BaseMap* map, Tile* tile);
+	// Places a random ground picked by seed instead of the shared random
+	// generator, so tiles can be redrawn from several threads at once
+	void redraw(Tile* tile, uint32_t seed);
 	static void doBorders(BaseMap* map, Tile* tile);
 	static const BorderBlock* getBrushTo(GroundBrush* first, GroundBrush* second);
+	// Resolves getBrushTo for every pair of the given brushes, and against no
+	// brush at all, so drawing only has to look it up
+	static void buildBorderTable(const std::vector<GroundBrush*>& ground_brushes);
+	static void clearBorderTable();
 
 	virtual int32_t getZ() const {
 		return z_order;
@@ -72,6 +79,10 @@ public:
 		return optional_border != nullptr;
 	}
 
+protected:
+	void placeGround(Tile* tile, int chance);
+	static const BorderBlock* findBrushTo(GroundBrush* first, GroundBrush* second);
+
 protected: // Members
 	int32_t z_order;
 	bool has_zilch_outer_border;
@@ -121,6 +132,12 @@ protected: // Members
 	std::vector<BorderBlock*> borders;
 	std::vector<ItemChanceBlock> border_items;
 	int total_chance;
+	uint32_t ground_index;
+
+	// getBrushTo by ground_index of both brushes, border_table_size brushes to
+	// a side with the last row and column standing for no brush
+	static std::vector<const BorderBlock*> border_table;
+	static uint32_t border_table_size;
 
 public: // Static global members
 	static uint32_t border_types[256];
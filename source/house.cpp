@@ -119,6 +119,8 @@ void House::clean() {
 		Tile* tile = map->getTile(*pos_iter);
 		if (tile) {
 			tile->setHouse(nullptr);
+			tile->getLocation()->touch();
+			map->area_cache.markDirty(*pos_iter);
 		}
 	}
 
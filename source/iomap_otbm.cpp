@@ -37,6 +37,8 @@
 
 #include "iomap_otbm.h"
 
+#include <ctime>
+
 typedef uint8_t attribute_t;
 typedef uint32_t flags_t;
 
@@ -622,32 +624,18 @@ bool IOMapOTBM::loadMap(Map& map, const FileName& filename) {
 			std::string entryName = archive_entry_pathname(entry);
 
 			if (entryName == "world/map.otbm") {
-				// Read the entire OTBM file into a memory region
-				size_t otbm_size = archive_entry_size(entry);
-				std::shared_ptr<uint8_t> otbm_buffer(new uint8_t[otbm_size], [](uint8_t* p) { delete[] p; });
+				g_gui.SetLoadDone(0, "Loading OTBM map...");
 
-				// Read from the archive
-				size_t read_bytes = archive_read_data(a.get(), otbm_buffer.get(), otbm_size);
+				// The map is parsed while it is decompressed
+				ArchiveNodeFileReadHandle f(a.get(), archive_entry_size(entry));
 
 				// Check so it at least contains the 4-byte file id
-				if (read_bytes < 4) {
-					return false;
-				}
-
-				if (read_bytes < otbm_size) {
-					error("Could not read file.");
+				if (!f.isOk()) {
 					return false;
 				}
 
-				g_gui.SetLoadDone(0, "Loading OTBM map...");
-
-				// Create a read handle on it
-				std::shared_ptr<NodeFileReadHandle> f(
-					new MemoryNodeFileReadHandle(otbm_buffer.get() + 4, otbm_size - 4)
-				);
-
 				// Read the version info
-				if (!loadMap(map, *f.get())) {
+				if (!loadMap(map, f)) {
 					error("Could not load OTBM file inside archive");
 					return false;
 				}
@@ -723,10 +711,29 @@ bool IOMapOTBM::loadMap(Map& map, const FileName& filename) {
 		return false;
 	}
 
-	if (!loadMap(map, f)) {
+	// With an up to date area index the tile areas can be left in the file
+	std::unique_ptr<OTBMAreaSource> source;
+	OTBMAreaIndex index;
+	if (g_settings.getBoolean(Config::LAZY_MAP_LOADING) && f.isInMemory() && loadAreaIndex(filename, f.size(), index)) {
+		source.reset(newd OTBMAreaSource());
+		if (source->open(nstr(filename.GetFullPath()), index)) {
+			area_source = source.get();
+		} else {
+			source.reset();
+		}
+	}
+
+	const bool loaded = loadMap(map, f);
+	area_source = nullptr;
+	if (!loaded) {
 		return false;
 	}
 
+	if (source && source->getPendingCount() != 0) {
+		source->setVersion(version);
+		map.area_source = std::move(source);
+	}
+
 	// Read auxilliary files
 	if (!loadHouses(map, filename)) {
 		warning("Failed to load houses.");
@@ -744,6 +751,476 @@ bool IOMapOTBM::loadMap(Map& map, const FileName& filename) {
 	return true;
 }
 
+// ============================================================================
+// Tile areas
+//
+// A tile area is decoded into a batch of tiles that are not yet part of the
+// map, which lets several areas be decoded at once. Batches are spliced into
+// the map in file order, so duplicate tiles, houses and warnings come out the
+// same as when everything is loaded on one thread.
+
+struct OTBMLoadedTile {
+	Position pos;
+	// nullptr if the tile is to be discarded
+	Tile* tile;
+	uint32_t house_id;
+	// Warnings raised while decoding this tile, only reported if it is not a duplicate
+	size_t warnings_begin;
+	size_t warnings_end;
+};
+
+struct OTBMTileAreaBatch {
+	explicit OTBMTileAreaBatch(const Position& base) :
+		base(base),
+		data(nullptr),
+		size(0),
+		file_offset(0),
+		merge(false) {
+		////
+	}
+
+	Position base;
+	// Raw area nodes, when decoding is deferred
+	const uint8_t* data;
+	size_t size;
+	// Holds the raw nodes if the file is streamed, data is set to it by
+	// loadTileAreas
+	std::string raw;
+	size_t file_offset;
+	// Set when loading areas into a lazily opened map, tiles that already
+	// exist there may only hold what other files placed on them
+	bool merge;
+
+	std::vector<OTBMLoadedTile> tiles;
+	wxArrayString warnings;
+	std::string error;
+};
+
+static void loadTileArea(const IOMap& maphandle, BinaryNode* areaNode, OTBMTileAreaBatch& batch) {
+	wxArrayString& warnings = batch.warnings;
+
+	for (BinaryNode* tileNode = areaNode->getChild(); tileNode != nullptr; tileNode = tileNode->advance()) {
+		uint8_t tile_type;
+		if (!tileNode->getByte(tile_type)) {
+			warnings.push_back("Invalid tile type");
+			continue;
+		}
+		if (tile_type != OTBM_TILE && tile_type != OTBM_HOUSETILE) {
+			warnings.push_back("Unknown type of tile node");
+			continue;
+		}
+
+		uint8_t x_offset, y_offset;
+		if (!tileNode->getU8(x_offset) || !tileNode->getU8(y_offset)) {
+			warnings.push_back("Could not read position of tile");
+			continue;
+		}
+
+		OTBMLoadedTile loaded;
+		loaded.pos = Position(batch.base.x + x_offset, batch.base.y + y_offset, batch.base.z);
+		loaded.tile = nullptr;
+		loaded.house_id = 0;
+		loaded.warnings_begin = warnings.size();
+		const Position& pos = loaded.pos;
+
+		if (tile_type == OTBM_HOUSETILE) {
+			if (!tileNode->getU32(loaded.house_id)) {
+				warnings.push_back("House tile without house data, discarding tile");
+				loaded.house_id = 0;
+				loaded.warnings_end = warnings.size();
+				batch.tiles.push_back(loaded);
+				continue;
+			}
+			if (!loaded.house_id) {
+				warnings.push_back(wxString::Format("Invalid house id from tile %d:%d:%d", pos.x, pos.y, pos.z));
+			}
+		}
+
+		// The location is assigned once the tile is spliced into the map
+		Tile* tile = new Tile(pos.x, pos.y, pos.z);
+
+		uint8_t attribute;
+		while (tileNode->getU8(attribute)) {
+			switch (attribute) {
+				case OTBM_ATTR_TILE_FLAGS: {
+					uint32_t flags = 0;
+					if (!tileNode->getU32(flags)) {
+						warnings.push_back(wxString::Format("Invalid tile flags of tile on %d:%d:%d", pos.x, pos.y, pos.z));
+					}
+					tile->setMapFlags(flags);
+					break;
+				}
+				case OTBM_ATTR_ITEM: {
+					Item* item = Item::Create_OTBM(maphandle, tileNode);
+					if (item == nullptr) {
+						warnings.push_back(wxString::Format("Invalid item at tile %d:%d:%d", pos.x, pos.y, pos.z));
+					}
+					tile->addItem(item);
+					break;
+				}
+				default: {
+					warnings.push_back(wxString::Format("Unknown tile attribute at %d:%d:%d", pos.x, pos.y, pos.z));
+					break;
+				}
+			}
+		}
+
+		for (BinaryNode* itemNode = tileNode->getChild(); itemNode != nullptr; itemNode = itemNode->advance()) {
+			uint8_t item_type;
+			if (!itemNode->getByte(item_type)) {
+				warnings.push_back(wxString::Format("Unknown item type %d:%d:%d", pos.x, pos.y, pos.z));
+				continue;
+			}
+			if (item_type == OTBM_ITEM) {
+				Item* item = Item::Create_OTBM(maphandle, itemNode);
+				if (item) {
+					if (!item->unserializeItemNode_OTBM(maphandle, itemNode)) {
+						warnings.push_back(wxString::Format("Couldn't unserialize item attributes at %d:%d:%d", pos.x, pos.y, pos.z));
+					}
+					tile->addItem(item);
+				}
+			} else {
+				warnings.push_back("Unknown type of tile child node");
+			}
+		}
+
+		tile->update();
+
+		loaded.tile = tile;
+		loaded.warnings_end = warnings.size();
+		batch.tiles.push_back(loaded);
+	}
+}
+
+// Decodes batch.data, a run of complete tile area nodes
+static void loadTileAreaRun(const IOMap& maphandle, OTBMTileAreaBatch& batch) {
+	MemoryNodeFileReadHandle handle(batch.data, batch.size);
+	size_t offset = 0;
+	while (offset < batch.size) {
+		if (batch.data[offset] != NODE_START) {
+			batch.error = "Invalid tile area node";
+			break;
+		}
+		handle.assign(batch.data + offset, batch.size - offset);
+
+		BinaryNode* areaNode = handle.getRootNode();
+		uint8_t node_type;
+		uint16_t base_x, base_y;
+		uint8_t base_z;
+		if (!areaNode->getByte(node_type) || node_type != OTBM_TILE_AREA || !areaNode->getU16(base_x) || !areaNode->getU16(base_y) || !areaNode->getU8(base_z)) {
+			batch.error = "Invalid tile area node";
+			break;
+		}
+		batch.base = Position(base_x, base_y, base_z);
+		loadTileArea(maphandle, areaNode, batch);
+
+		if (handle.error_code != FILE_NO_ERROR) {
+			batch.error = handle.getErrorMessage();
+			break;
+		}
+		offset += handle.tell();
+	}
+}
+
+void IOMapOTBM::loadTileAreas(Map& map, std::vector<OTBMTileAreaBatch>& batches, size_t progress_size) {
+	if (batches.empty()) {
+		return;
+	}
+
+	// Copied areas only point at their nodes once the list stops growing,
+	// moving a short string moves its bytes
+	for (OTBMTileAreaBatch& batch : batches) {
+		if (!batch.raw.empty()) {
+			batch.data = reinterpret_cast<const uint8_t*>(batch.raw.data());
+			batch.size = batch.raw.size();
+		}
+	}
+
+	const IOMap& self = *this;
+	auto decode = [&self, &batches](size_t index) {
+		loadTileAreaRun(self, batches[index]);
+	};
+	// Splice the areas in file order while the remaining ones are decoded
+	auto splice = [this, &map, &batches, progress_size](size_t index) {
+		OTBMTileAreaBatch& batch = batches[index];
+		spliceTileArea(map, batch);
+		if (progress_size != 0) {
+			g_gui.SetLoadDone(static_cast<int32_t>(100.0 * batch.file_offset / progress_size));
+		}
+	};
+	runOrderedJobs(batches.size(), g_settings.getInteger(Config::WORKER_THREADS), decode, splice);
+
+	batches.clear();
+}
+
+void IOMapOTBM::spliceTileArea(Map& map, OTBMTileAreaBatch& batch) {
+	size_t next_warning = 0;
+	for (OTBMLoadedTile& loaded : batch.tiles) {
+		// Warnings raised in between tiles
+		for (; next_warning < loaded.warnings_begin; ++next_warning) {
+			warnings.push_back(batch.warnings[next_warning]);
+		}
+		next_warning = loaded.warnings_end;
+
+		const Position& pos = loaded.pos;
+		Tile* existing = map.getTile(pos);
+		if (existing && (!batch.merge || !loaded.tile || existing->ground || !existing->items.empty())) {
+			warning("Duplicate tile at %d:%d:%d, discarding duplicate", pos.x, pos.y, pos.z);
+			delete loaded.tile;
+			continue;
+		}
+
+		for (size_t i = loaded.warnings_begin; i < loaded.warnings_end; ++i) {
+			warnings.push_back(batch.warnings[i]);
+		}
+
+		Tile* tile = loaded.tile;
+		if (!tile) {
+			continue;
+		}
+		if (existing) {
+			// Fill in the tile that was created for spawns, towns and such,
+			// it may be referenced already
+			existing->setMapFlags(tile->getMapFlags());
+			existing->merge(tile);
+			existing->update();
+			delete tile;
+			tile = existing;
+		} else {
+			tile->setLocation(map.createTileL(pos));
+		}
+
+		if (loaded.house_id) {
+			House* house = map.houses.getHouse(loaded.house_id);
+			if (!house) {
+				house = newd House(map);
+				house->setID(loaded.house_id);
+				map.houses.addHouse(house);
+			}
+			house->addTile(tile);
+		}
+
+		if (!existing) {
+			map.setTile(pos.x, pos.y, pos.z, tile);
+		}
+	}
+	for (; next_warning < batch.warnings.size(); ++next_warning) {
+		warnings.push_back(batch.warnings[next_warning]);
+	}
+
+	if (!batch.error.empty()) {
+		warning(wxstr(batch.error));
+	}
+
+	batch.tiles.clear();
+	batch.warnings.Clear();
+}
+
+// ============================================================================
+// Lazily opened maps
+//
+// Saving writes every 256x256 block as one run of tile area nodes and, if
+// enabled, an index of where those runs ended up. A map whose index is up to
+// date can then be opened without decoding any tiles, the blocks are loaded
+// once they are used and blocks that never were are copied over on save.
+
+static const char OTBM_AREA_INDEX_IDENTIFIER[] = "OTBI";
+static const uint32_t OTBM_AREA_INDEX_VERSION = 1;
+
+static std::string getAreaIndexFilename(const FileName& identifier) {
+	return nstr(identifier.GetFullPath()) + ".idx";
+}
+
+bool IOMapOTBM::loadAreaIndex(const FileName& identifier, uint64_t file_size, OTBMAreaIndex& index) {
+	FileReadHandle f(getAreaIndexFilename(identifier));
+	if (!f.isOk()) {
+		return false;
+	}
+
+	std::string ident;
+	uint32_t index_version;
+	uint64_t indexed_size;
+	uint32_t count;
+	if (!f.getRAW(ident, 4) || ident != OTBM_AREA_INDEX_IDENTIFIER || !f.getU32(index_version) || index_version != OTBM_AREA_INDEX_VERSION) {
+		return false;
+	}
+	// The map has been written by something else since
+	if (!f.getU64(indexed_size) || indexed_size != file_size || !f.getU32(count)) {
+		return false;
+	}
+
+	index.clear();
+	index.reserve(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		OTBMAreaIndexEntry entry;
+		if (!f.getU32(entry.key) || !f.getU64(entry.offset) || !f.getU64(entry.size)) {
+			return false;
+		}
+		index.push_back(entry);
+	}
+	return true;
+}
+
+bool IOMapOTBM::saveAreaIndex(const FileName& identifier, uint64_t file_size, const OTBMAreaIndex& index) {
+	FileWriteHandle f(getAreaIndexFilename(identifier));
+	if (!f.isOk()) {
+		return false;
+	}
+
+	f.addRAW(OTBM_AREA_INDEX_IDENTIFIER);
+	f.addU32(OTBM_AREA_INDEX_VERSION);
+	f.addU64(file_size);
+	f.addU32(index.size());
+	for (const OTBMAreaIndexEntry& entry : index) {
+		f.addU32(entry.key);
+		f.addU64(entry.offset);
+		f.addU64(entry.size);
+	}
+	return f.isOk();
+}
+
+OTBMAreaSource::OTBMAreaSource() :
+	maphandle(MapVersion()),
+	pending(0) {
+	////
+}
+
+bool OTBMAreaSource::open(const std::string& filename, const OTBMAreaIndex& index) {
+	std::unique_ptr<MemoryMappedFile> mapped(newd MemoryMappedFile());
+	if (!mapped->open(filename, false)) {
+		return false;
+	}
+
+	// Every entry has to cover complete tile area nodes, in file order
+	const uint8_t* data = mapped->getData();
+	const size_t size = mapped->getSize();
+	size_t last_end = 0;
+	blocks.clear();
+	order.clear();
+	for (const OTBMAreaIndexEntry& entry : index) {
+		if (entry.offset < last_end || entry.size < 2 || entry.offset + entry.size > size) {
+			return false;
+		}
+		if (data[entry.offset] != NODE_START || data[entry.offset + 1] != OTBM_TILE_AREA || data[entry.offset + entry.size - 1] != NODE_END) {
+			return false;
+		}
+		if (!blocks.emplace(entry.key, Block { size_t(entry.offset), size_t(entry.size), false }).second) {
+			return false;
+		}
+		order.push_back(entry.key);
+		last_end = entry.offset + entry.size;
+	}
+
+	file = std::move(mapped);
+	pending = 0;
+	return true;
+}
+
+bool OTBMAreaSource::skipBlock(BinaryNode* areaNode) {
+	const size_t offset = areaNode->getFileOffset();
+	auto it = std::lower_bound(order.begin(), order.end(), offset, [this](uint32_t key, size_t value) {
+		return blocks.at(key).offset < value;
+	});
+	if (it == order.end()) {
+		return false;
+	}
+
+	Block& block = blocks.at(*it);
+	if (block.offset != offset || block.pending || !areaNode->skipTo(block.offset + block.size)) {
+		return false;
+	}
+	block.pending = true;
+	++pending;
+	return true;
+}
+
+std::vector<uint32_t> OTBMAreaSource::getPendingBlocks() const {
+	std::vector<uint32_t> keys;
+	keys.reserve(pending);
+	for (uint32_t key : order) {
+		if (blocks.at(key).pending) {
+			keys.push_back(key);
+		}
+	}
+	return keys;
+}
+
+bool OTBMAreaSource::getBlock(uint32_t key, const uint8_t*& data, size_t& size) const {
+	auto it = blocks.find(key);
+	if (it == blocks.end() || !it->second.pending) {
+		return false;
+	}
+	data = file->getData() + it->second.offset;
+	size = it->second.size;
+	return true;
+}
+
+void OTBMAreaSource::load(Map& map, const std::vector<uint32_t>& keys, bool showdialog) {
+	const bool use_cache = g_settings.getBoolean(Config::INCREMENTAL_SAVE);
+	if (use_cache) {
+		map.area_cache.validate(maphandle.version, g_items.MajorVersion, g_items.MinorVersion);
+	}
+
+	std::vector<OTBMTileAreaBatch> batches;
+	batches.reserve(keys.size());
+	for (uint32_t key : keys) {
+		auto it = blocks.find(key);
+		if (it == blocks.end() || !it->second.pending) {
+			continue;
+		}
+		Block& block = it->second;
+		block.pending = false;
+		--pending;
+
+		OTBMTileAreaBatch batch(Position(0, 0, 0));
+		batch.data = file->getData() + block.offset;
+		batch.size = block.size;
+		batch.file_offset = block.offset;
+		batch.merge = true;
+
+		// Nothing has changed yet, so the next save can copy the block as it is
+		if (use_cache) {
+			map.area_cache.set(key, std::string(reinterpret_cast<const char*>(batch.data), batch.size));
+		}
+		batches.push_back(std::move(batch));
+	}
+
+	maphandle.loadTileAreas(map, batches, showdialog ? file->getSize() : 0);
+	// The map is open already, nobody would read these
+	maphandle.getWarnings().Clear();
+}
+
+void OTBMAreaSource::relocate(const std::string& filename, const OTBMAreaIndex& index) {
+	std::unique_ptr<MemoryMappedFile> mapped(newd MemoryMappedFile());
+	if (!mapped->open(filename, false)) {
+		// Keep reading from the old file, its mapping stays valid even if it was renamed
+		return;
+	}
+
+	std::unordered_map<uint32_t, Block> relocated;
+	std::vector<uint32_t> relocated_order;
+	size_t relocated_pending = 0;
+	for (const OTBMAreaIndexEntry& entry : index) {
+		Block block { size_t(entry.offset), size_t(entry.size), isPending(entry.key) };
+		if (block.offset + block.size > mapped->getSize()) {
+			return;
+		}
+		if (block.pending) {
+			++relocated_pending;
+		}
+		relocated.emplace(entry.key, block);
+		relocated_order.push_back(entry.key);
+	}
+	// Every pending block must have been written
+	if (relocated_pending != pending) {
+		return;
+	}
+
+	file = std::move(mapped);
+	blocks.swap(relocated);
+	order.swap(relocated_order);
+}
+
 bool IOMapOTBM::loadMap(Map& map, NodeFileReadHandle& f) {
 	BinaryNode* root = f.getRootNode();
 	if (!root) {
@@ -846,130 +1323,70 @@ bool IOMapOTBM::loadMap(Map& map, NodeFileReadHandle& f) {
 		}
 	}
 
+	// Tile areas are decoded out of order, straight from the file if it is in
+	// memory and from a copy otherwise. Copies are decoded every so often.
+	const bool parallel = g_settings.getInteger(Config::WORKER_THREADS) > 1;
+	const size_t copied_area_budget = 64 * 1024 * 1024;
+	size_t copied_area_size = 0;
+	std::vector<OTBMTileAreaBatch> pending_areas;
+
 	int nodes_loaded = 0;
 
 	for (BinaryNode* mapNode = mapHeaderNode->getChild(); mapNode != nullptr; mapNode = mapNode->advance()) {
 		++nodes_loaded;
-		if (nodes_loaded % 15 == 0) {
+		// When decoding in parallel the progress is reported as areas are spliced
+		if (!parallel && nodes_loaded % 15 == 0) {
 			g_gui.SetLoadDone(static_cast<int32_t>(100.0 * f.tell() / f.size()));
 		}
 
 		uint8_t node_type;
 		if (!mapNode->getByte(node_type)) {
+			loadTileAreas(map, pending_areas, f.size());
 			warning("Invalid map node");
 			continue;
 		}
 		if (node_type == OTBM_TILE_AREA) {
+			// A lazily opened map leaves its blocks in the file until they are used
+			if (area_source && area_source->skipBlock(mapNode)) {
+				continue;
+			}
+
 			uint16_t base_x, base_y;
 			uint8_t base_z;
 			if (!mapNode->getU16(base_x) || !mapNode->getU16(base_y) || !mapNode->getU8(base_z)) {
+				loadTileAreas(map, pending_areas, f.size());
 				warning("Invalid map node, no base coordinate");
 				continue;
 			}
 
-			for (BinaryNode* tileNode = mapNode->getChild(); tileNode != nullptr; tileNode = tileNode->advance()) {
-				Tile* tile = nullptr;
-				uint8_t tile_type;
-				if (!tileNode->getByte(tile_type)) {
-					warning("Invalid tile type");
-					continue;
+			OTBMTileAreaBatch batch(Position(base_x, base_y, base_z));
+			if (parallel && f.isInMemory() && mapNode->skipChildren(batch.data, batch.size)) {
+				// Decoded later on, together with the areas that follow it
+				batch.file_offset = f.tell();
+				pending_areas.push_back(std::move(batch));
+				continue;
+			}
+			if (parallel && !f.isInMemory() && mapNode->copyChildren(batch.raw)) {
+				batch.file_offset = f.tell();
+				copied_area_size += batch.raw.size();
+				pending_areas.push_back(std::move(batch));
+				if (copied_area_size >= copied_area_budget) {
+					loadTileAreas(map, pending_areas, f.size());
+					copied_area_size = 0;
 				}
-				if (tile_type == OTBM_TILE || tile_type == OTBM_HOUSETILE) {
-					// printf("Start\n");
-					uint8_t x_offset, y_offset;
-					if (!tileNode->getU8(x_offset) || !tileNode->getU8(y_offset)) {
-						warning("Could not read position of tile");
-						continue;
-					}
-					const Position pos(base_x + x_offset, base_y + y_offset, base_z);
-
-					if (map.getTile(pos)) {
-						warning("Duplicate tile at %d:%d:%d, discarding duplicate", pos.x, pos.y, pos.z);
-						continue;
-					}
-
-					tile = map.allocator(map.createTileL(pos));
-					House* house = nullptr;
-					if (tile_type == OTBM_HOUSETILE) {
-						uint32_t house_id;
-						if (!tileNode->getU32(house_id)) {
-							warning("House tile without house data, discarding tile");
-							continue;
-						}
-						if (house_id) {
-							house = map.houses.getHouse(house_id);
-							if (!house) {
-								house = newd House(map);
-								house->setID(house_id);
-								map.houses.addHouse(house);
-							}
-						} else {
-							warning("Invalid house id from tile %d:%d:%d", pos.x, pos.y, pos.z);
-						}
-					}
-
-					// printf("So far so good\n");
-
-					uint8_t attribute;
-					while (tileNode->getU8(attribute)) {
-						switch (attribute) {
-							case OTBM_ATTR_TILE_FLAGS: {
-								uint32_t flags = 0;
-								if (!tileNode->getU32(flags)) {
-									warning("Invalid tile flags of tile on %d:%d:%d", pos.x, pos.y, pos.z);
-								}
-								tile->setMapFlags(flags);
-								break;
-							}
-							case OTBM_ATTR_ITEM: {
-								Item* item = Item::Create_OTBM(*this, tileNode);
-								if (item == nullptr) {
-									warning("Invalid item at tile %d:%d:%d", pos.x, pos.y, pos.z);
-								}
-								tile->addItem(item);
-								break;
-							}
-							default: {
-								warning("Unknown tile attribute at %d:%d:%d", pos.x, pos.y, pos.z);
-								break;
-							}
-						}
-					}
-
-					// printf("Didn't die in loop\n");
+				continue;
+			}
 
-					for (BinaryNode* itemNode = tileNode->getChild(); itemNode != nullptr; itemNode = itemNode->advance()) {
-						Item* item = nullptr;
-						uint8_t item_type;
-						if (!itemNode->getByte(item_type)) {
-							warning("Unknown item type %d:%d:%d", pos.x, pos.y, pos.z);
-							continue;
-						}
-						if (item_type == OTBM_ITEM) {
-							item = Item::Create_OTBM(*this, itemNode);
-							if (item) {
-								if (!item->unserializeItemNode_OTBM(*this, itemNode)) {
-									warning("Couldn't unserialize item attributes at %d:%d:%d", pos.x, pos.y, pos.z);
-								}
-								// reform(&map, tile, item);
-								tile->addItem(item);
-							}
-						} else {
-							warning("Unknown type of tile child node");
-						}
-					}
+			loadTileAreas(map, pending_areas, f.size());
+			loadTileArea(*this, mapNode, batch);
+			spliceTileArea(map, batch);
+			continue;
+		}
 
-					tile->update();
-					if (house) {
-						house->addTile(tile);
-					}
+		// Towns and waypoints may create tiles, so all areas before them must be in place
+		loadTileAreas(map, pending_areas, f.size());
 
-					map.setTile(pos.x, pos.y, pos.z, tile);
-				} else {
-					warning("Unknown type of tile node");
-				}
-			}
-		} else if (node_type == OTBM_TOWNS) {
+		if (node_type == OTBM_TOWNS) {
 			for (BinaryNode* townNode = mapNode->getChild(); townNode != nullptr; townNode = townNode->advance()) {
 				Town* town = nullptr;
 				uint8_t town_type;
@@ -1051,6 +1468,7 @@ bool IOMapOTBM::loadMap(Map& map, NodeFileReadHandle& f) {
 			}
 		}
 	}
+	loadTileAreas(map, pending_areas, f.size());
 
 	if (!f.isOk()) {
 		warning(wxstr(f.getErrorMessage()).wc_str());
@@ -1245,12 +1663,17 @@ bool IOMapOTBM::loadHouses(Map& map, pugi::xml_document& doc) {
 			continue;
 		}
 
-		House* house = nullptr;
-		if ((attribute = houseNode.attribute("houseid"))) {
-			house = map.houses.getHouse(attribute.as_uint());
-			if (!house) {
-				break;
-			}
+		if (!(attribute = houseNode.attribute("houseid"))) {
+			continue;
+		}
+
+		// With lazy loading the tiles of the house may still be in the file,
+		// the house is then created here and its tiles join it once loaded
+		House* house = map.houses.getHouse(attribute.as_uint());
+		if (!house) {
+			house = newd House(map);
+			house->setID(attribute.as_uint());
+			map.houses.addHouse(house);
 		}
 
 		if ((attribute = houseNode.attribute("name"))) {
@@ -1305,39 +1728,78 @@ bool IOMapOTBM::loadWaypoints(Map& map, pugi::xml_document& doc) {
 	return true;
 };
 
+#ifdef OTGZ_SUPPORT
+// OTGZ archives are gzipped tar files. They are written by hand rather than
+// through libarchive, so the map can be streamed into its entry before the
+// size of it is known.
+static const size_t TAR_BLOCK_SIZE = 512;
+
+static bool makeTarHeader(uint8_t* header, const std::string& path, size_t size) {
+	// ustar can't store larger sizes
+	if (path.size() >= 100 || uint64_t(size) > 077777777777ULL) {
+		return false;
+	}
+
+	char* fields = reinterpret_cast<char*>(header);
+	memset(header, 0, TAR_BLOCK_SIZE);
+	memcpy(fields, path.data(), path.size());
+	snprintf(fields + 100, 8, "%07o", 0644); // mode
+	snprintf(fields + 108, 8, "%07o", 0); // uid
+	snprintf(fields + 116, 8, "%07o", 0); // gid
+	snprintf(fields + 124, 12, "%011llo", (unsigned long long)size);
+	snprintf(fields + 136, 12, "%011llo", (unsigned long long)time(nullptr));
+	fields[156] = '0'; // regular file
+	memcpy(fields + 257, "ustar", 6);
+	memcpy(fields + 263, "00", 2);
+
+	// The checksum is calculated with its own field set to spaces
+	memset(fields + 148, ' ', 8);
+	uint32_t checksum = 0;
+	for (size_t i = 0; i < TAR_BLOCK_SIZE; ++i) {
+		checksum += header[i];
+	}
+	snprintf(fields + 148, 8, "%06o", checksum);
+	fields[155] = ' ';
+	return true;
+}
+
+static bool addTarPadding(GzipFileWriteHandle& f, size_t size) {
+	static const uint8_t zeros[TAR_BLOCK_SIZE] = {};
+	if (size % TAR_BLOCK_SIZE == 0) {
+		return f.isOk();
+	}
+	return f.addRAW(zeros, TAR_BLOCK_SIZE - size % TAR_BLOCK_SIZE);
+}
+
+static bool addTarEntry(GzipFileWriteHandle& f, const std::string& path, const std::string& data) {
+	uint8_t header[TAR_BLOCK_SIZE];
+	if (!makeTarHeader(header, path, data.size())) {
+		return false;
+	}
+	f.addRAW(header, TAR_BLOCK_SIZE);
+	f.addRAW(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+	return addTarPadding(f, data.size());
+}
+#endif
+
 bool IOMapOTBM::saveMap(Map& map, const FileName& identifier) {
 #ifdef OTGZ_SUPPORT
 	if (identifier.GetExt() == "otgz") {
-		// Create the archive
-		struct archive* a = archive_write_new();
-		struct archive_entry* entry = nullptr;
+		// Compressed in blocks on the worker threads while it is written
+		GzipFileWriteHandle f(nstr(identifier.GetFullPath()), g_settings.getInteger(Config::WORKER_THREADS));
+		if (!f.isOk()) {
+			error("Can not open file %s for writing", (const char*)identifier.GetFullPath().mb_str(wxConvUTF8));
+			return false;
+		}
 		std::ostringstream streamData;
 
-		archive_write_set_compression_gzip(a);
-		archive_write_set_format_pax_restricted(a);
-		archive_write_open_filename(a, nstr(identifier.GetFullPath()).c_str());
-
 		g_gui.SetLoadDone(0, "Saving spawns...");
 
 		pugi::xml_document spawnDoc;
 		if (saveSpawns(map, spawnDoc)) {
 			// Write the data
 			spawnDoc.save(streamData, "", pugi::format_raw, pugi::encoding_utf8);
-			std::string xmlData = streamData.str();
-
-			// Write to the arhive
-			entry = archive_entry_new();
-			archive_entry_set_pathname(entry, "world/spawns.xml");
-			archive_entry_set_size(entry, xmlData.size());
-			archive_entry_set_filetype(entry, AE_IFREG);
-			archive_entry_set_perm(entry, 0644);
-
-			// Write to the archive
-			archive_write_header(a, entry);
-			archive_write_data(a, xmlData.data(), xmlData.size());
-
-			// Free the entry
-			archive_entry_free(entry);
+			addTarEntry(f, "world/spawns.xml", streamData.str());
 			streamData.str("");
 		}
 
@@ -1347,21 +1809,7 @@ bool IOMapOTBM::saveMap(Map& map, const FileName& identifier) {
 		if (saveHouses(map, houseDoc)) {
 			// Write the data
 			houseDoc.save(streamData, "", pugi::format_raw, pugi::encoding_utf8);
-			std::string xmlData = streamData.str();
-
-			// Write to the arhive
-			entry = archive_entry_new();
-			archive_entry_set_pathname(entry, "world/houses.xml");
-			archive_entry_set_size(entry, xmlData.size());
-			archive_entry_set_filetype(entry, AE_IFREG);
-			archive_entry_set_perm(entry, 0644);
-
-			// Write to the archive
-			archive_write_header(a, entry);
-			archive_write_data(a, xmlData.data(), xmlData.size());
-
-			// Free the entry
-			archive_entry_free(entry);
+			addTarEntry(f, "world/houses.xml", streamData.str());
 			streamData.str("");
 		}
 		// to do
@@ -1372,53 +1820,40 @@ bool IOMapOTBM::saveMap(Map& map, const FileName& identifier) {
 		if (saveWaypoints(map, wpDoc)) {
 			// Write the data
 			wpDoc.save(streamData, "", pugi::format_raw, pugi::encoding_utf8);
-			std::string xmlData = streamData.str();
-
-			// Write to the arhive
-			entry = archive_entry_new();
-			archive_entry_set_pathname(entry, "world/waypoints.xml");
-			archive_entry_set_size(entry, xmlData.size());
-			archive_entry_set_filetype(entry, AE_IFREG);
-			archive_entry_set_perm(entry, 0644);
-
-			// Write to the archive
-			archive_write_header(a, entry);
-			archive_write_data(a, xmlData.data(), xmlData.size());
-
-			// Free the entry
-			archive_entry_free(entry);
+			addTarEntry(f, "world/waypoints.xml", streamData.str());
 			streamData.str("");
 		}
 		*/
 		g_gui.SetLoadDone(0, "Saving OTBM map...");
 
-		MemoryNodeFileWriteHandle otbmWriter;
-		saveMap(map, otbmWriter);
-
-		g_gui.SetLoadDone(75, "Compressing...");
-
-		// Create an archive entry for the otbm file
-		entry = archive_entry_new();
-		archive_entry_set_pathname(entry, "world/map.otbm");
-		archive_entry_set_size(entry, otbmWriter.getSize() + 4); // 4 bytes extra for header
-		archive_entry_set_filetype(entry, AE_IFREG);
-		archive_entry_set_perm(entry, 0644);
-		archive_write_header(a, entry);
-
-		// Write the version header
-		char otbm_identifier[] = "OTBM";
-		archive_write_data(a, otbm_identifier, 4);
+		// The header of the map entry is filled in once its size is known
+		uint8_t header[TAR_BLOCK_SIZE];
+		size_t header_offset = 0;
+		makeTarHeader(header, "world/map.otbm", 0);
+		f.addPlaceholder(header, TAR_BLOCK_SIZE, header_offset);
+
+		const size_t otbm_start = f.tell();
+		GzipNodeFileWriteHandle otbmWriter(f, "OTBM");
+		const bool saved = saveMap(map, otbmWriter);
+		otbmWriter.close();
+		const size_t otbm_size = f.tell() - otbm_start;
+		addTarPadding(f, otbm_size);
+
+		if (!saved || !makeTarHeader(header, "world/map.otbm", otbm_size) || !f.replacePlaceholder(header_offset, header, TAR_BLOCK_SIZE)) {
+			error("Could not write the map into the archive.");
+			return false;
+		}
 
-		// Write the OTBM data
-		archive_write_data(a, otbmWriter.getMemory(), otbmWriter.getSize());
-		archive_entry_free(entry);
+		// Two empty blocks mark the end of the archive
+		const uint8_t end_blocks[TAR_BLOCK_SIZE * 2] = {};
+		f.addRAW(end_blocks, sizeof(end_blocks));
 
-		// Free / close the archive
-		archive_write_close(a);
-		archive_write_free(a);
+		// Closing writes out the last members, errors there must count too
+		const bool ok = f.flush();
+		f.close();
 
 		g_gui.DestroyLoadBar();
-		return true;
+		return ok;
 	}
 #endif
 
@@ -1435,6 +1870,18 @@ bool IOMapOTBM::saveMap(Map& map, const FileName& identifier) {
 	if (!saveMap(map, f)) {
 		return false;
 	}
+	const size_t file_size = f.tell();
+	f.close();
+
+	// The areas a lazily opened map hasn't loaded yet are in the new file now
+	if (map.area_source) {
+		map.area_source->relocate(nstr(identifier.GetFullPath()), saved_areas);
+	}
+	if (g_settings.getBoolean(Config::LAZY_MAP_LOADING)) {
+		if (!saveAreaIndex(identifier, file_size, saved_areas)) {
+			warning("Could not write the area index of the map.");
+		}
+	}
 
 	g_gui.SetLoadDone(99, "Saving spawns...");
 	saveSpawns(map, identifier);
@@ -1448,6 +1895,60 @@ bool IOMapOTBM::saveMap(Map& map, const FileName& identifier) {
 	return true;
 }
 
+// Writes the tiles of one 256x256 block, save_tiles[begin, end), as complete
+// tile area nodes so the output can be reused by later saves as it is.
+static void saveTiles(const IOMap& self, const std::vector<Tile*>& save_tiles, size_t begin, size_t end, NodeFileWriteHandle& f) {
+	writeTileAreas(f, save_tiles, begin, end, [&self, &f](Tile* save_tile) {
+		f.addNode(save_tile->isHouseTile() ? OTBM_HOUSETILE : OTBM_TILE);
+
+		f.addU8(save_tile->getX() & 0xFF);
+		f.addU8(save_tile->getY() & 0xFF);
+
+		if (save_tile->isHouseTile()) {
+			f.addU32(save_tile->getHouseID());
+		}
+
+		if (save_tile->getMapFlags()) {
+			f.addByte(OTBM_ATTR_TILE_FLAGS);
+			f.addU32(save_tile->getMapFlags());
+		}
+
+		if (save_tile->ground) {
+			Item* ground = save_tile->ground;
+			if (ground->isMetaItem()) {
+				// Do nothing, we don't save metaitems...
+			} else if (ground->hasBorderEquivalent()) {
+				bool found = false;
+				for (Item* item : save_tile->items) {
+					if (item->getGroundEquivalent() == ground->getID()) {
+						// Do nothing
+						// Found equivalent
+						found = true;
+						break;
+					}
+				}
+
+				if (!found) {
+					ground->serializeItemNode_OTBM(self, f);
+				}
+			} else if (ground->isComplex()) {
+				ground->serializeItemNode_OTBM(self, f);
+			} else {
+				f.addByte(OTBM_ATTR_ITEM);
+				ground->serializeItemCompact_OTBM(self, f);
+			}
+		}
+
+		for (Item* item : save_tile->items) {
+			if (!item->isMetaItem()) {
+				item->serializeItemNode_OTBM(self, f);
+			}
+		}
+
+		f.endNode();
+	});
+}
+
 bool IOMapOTBM::saveMap(Map& map, NodeFileWriteHandle& f) {
 	/* STOP!
 	 * Before you even think about modifying this, please reconsider.
@@ -1495,98 +1996,107 @@ bool IOMapOTBM::saveMap(Map& map, NodeFileWriteHandle& f) {
 			f.addString(nstr(tmpName.GetFullName()));
 
 			// Start writing tiles
-			uint32_t tiles_saved = 0;
-			bool first = true;
-
-			int local_x = -1, local_y = -1, local_z = -1;
-
-			MapIterator map_iterator = map.begin();
-			while (map_iterator != map.end()) {
-				// Update progressbar
-				++tiles_saved;
-				if (tiles_saved % 8192 == 0) {
-					g_gui.SetLoadDone(int(tiles_saved / double(map.getTileCount()) * 100.0));
-				}
+			// The tiles are collected in iteration order, where every 256x256
+			// block is contiguous. Each block is serialized on its own, either
+			// taken from the area cache of the last save or encoded on a worker
+			// thread, and then written to the file in that order.
+			SavedAreaCache& cache = map.area_cache;
+			const bool use_cache = g_settings.getBoolean(Config::INCREMENTAL_SAVE);
+			if (use_cache) {
+				cache.validate(version, g_items.MajorVersion, g_items.MinorVersion);
+			} else {
+				cache.clear();
+			}
 
-				// Get tile
+			// Blocks a lazily opened map hasn't loaded are copied from its
+			// source file, unless they have to be written in another format
+			if (map.area_source && !map.area_source->isCompatible(version)) {
+				map.loadAllAreas(false);
+			}
+			OTBMAreaSource* source = map.area_source.get();
+			saved_areas.clear();
+
+			std::vector<Tile*> save_tiles;
+			std::vector<size_t> block_starts;
+			save_tiles.reserve(map.getTileCount());
+			bool first_block = true;
+			bool skip_block = false;
+			uint32_t last_block = 0;
+			for (MapIterator map_iterator = map.begin(); map_iterator != map.end(); ++map_iterator) {
 				Tile* save_tile = (*map_iterator)->get();
 
 				// Is it an empty tile that we can skip? (Leftovers...)
-				if (!save_tile || save_tile->size() == 0) {
-					++map_iterator;
-					continue;
-				}
-
-				const Position& pos = save_tile->getPosition();
-
-				// Decide if newd node should be created
-				if (pos.x < local_x || pos.x >= local_x + 256 || pos.y < local_y || pos.y >= local_y + 256 || pos.z != local_z) {
-					// End last node
-					if (!first) {
-						f.endNode();
+				if (save_tile && save_tile->size() != 0) {
+					const uint32_t block = SavedAreaCache::getBlockKey(save_tile->getX(), save_tile->getY());
+					if (first_block || block != last_block) {
+						// Only holds what other files placed there if it is still pending
+						skip_block = source && source->isPending(block);
+						if (!skip_block) {
+							block_starts.push_back(save_tiles.size());
+						}
+						first_block = false;
+						last_block = block;
+					}
+					if (!skip_block) {
+						save_tiles.push_back(save_tile);
 					}
-					first = false;
-
-					// Start newd node
-					f.addNode(OTBM_TILE_AREA);
-					f.addU16(local_x = pos.x & 0xFF00);
-					f.addU16(local_y = pos.y & 0xFF00);
-					f.addU8(local_z = pos.z);
 				}
-				f.addNode(save_tile->isHouseTile() ? OTBM_HOUSETILE : OTBM_TILE);
+			}
 
-				f.addU8(save_tile->getX() & 0xFF);
-				f.addU8(save_tile->getY() & 0xFF);
+			const size_t block_count = block_starts.size();
+			block_starts.push_back(save_tiles.size());
+			const std::vector<uint32_t> source_blocks = source ? source->getPendingBlocks() : std::vector<uint32_t>();
+			const size_t job_count = block_count + source_blocks.size();
 
-				if (save_tile->isHouseTile()) {
-					f.addU32(save_tile->getHouseID());
+			std::vector<const std::string*> cached(block_count, nullptr);
+			if (use_cache) {
+				for (size_t index = 0; index < block_count; ++index) {
+					Tile* first = save_tiles[block_starts[index]];
+					cached[index] = cache.get(SavedAreaCache::getBlockKey(first->getX(), first->getY()));
 				}
+			}
 
-				if (save_tile->getMapFlags()) {
-					f.addByte(OTBM_ATTR_TILE_FLAGS);
-					f.addU32(save_tile->getMapFlags());
+			std::vector<MemoryNodeFileWriteHandle*> blocks(block_count, nullptr);
+			auto serialize = [&self, &save_tiles, &block_starts, &cached, &blocks, block_count](size_t index) {
+				if (index < block_count && !cached[index]) {
+					MemoryNodeFileWriteHandle* block = newd MemoryNodeFileWriteHandle();
+					saveTiles(self, save_tiles, block_starts[index], block_starts[index + 1], *block);
+					blocks[index] = block;
 				}
-
-				if (save_tile->ground) {
-					Item* ground = save_tile->ground;
-					if (ground->isMetaItem()) {
-						// Do nothing, we don't save metaitems...
-					} else if (ground->hasBorderEquivalent()) {
-						bool found = false;
-						for (Item* item : save_tile->items) {
-							if (item->getGroundEquivalent() == ground->getID()) {
-								// Do nothing
-								// Found equivalent
-								found = true;
-								break;
-							}
-						}
-
-						if (!found) {
-							ground->serializeItemNode_OTBM(self, f);
-						}
-					} else if (ground->isComplex()) {
-						ground->serializeItemNode_OTBM(self, f);
+			};
+			auto write = [&](size_t index) {
+				const size_t offset = f.tell();
+				uint32_t key;
+				if (index >= block_count) {
+					key = source_blocks[index - block_count];
+					const uint8_t* data;
+					size_t size;
+					if (source->getBlock(key, data, size)) {
+						f.addEncodedRAW(data, size);
+					}
+				} else {
+					Tile* first = save_tiles[block_starts[index]];
+					key = SavedAreaCache::getBlockKey(first->getX(), first->getY());
+					if (const std::string* blob = cached[index]) {
+						f.addEncodedRAW(reinterpret_cast<const uint8_t*>(blob->data()), blob->size());
 					} else {
-						f.addByte(OTBM_ATTR_ITEM);
-						ground->serializeItemCompact_OTBM(self, f);
+						MemoryNodeFileWriteHandle* block = blocks[index];
+						f.addEncodedRAW(block->getMemory(), block->getSize());
+						if (use_cache) {
+							cache.set(key, std::string(reinterpret_cast<const char*>(block->getMemory()), block->getSize()));
+						}
+						delete block;
+						blocks[index] = nullptr;
 					}
 				}
-
-				for (Item* item : save_tile->items) {
-					if (!item->isMetaItem()) {
-						item->serializeItemNode_OTBM(self, f);
-					}
+				if (f.tell() != offset) {
+					saved_areas.push_back({ key, offset, f.tell() - offset });
 				}
-
-				f.endNode();
-				++map_iterator;
-			}
-
-			// Only close the last node if one has actually been created
-			if (!first) {
-				f.endNode();
-			}
+				g_gui.SetLoadDone(std::min(99, int((index + 1) / double(job_count) * 100.0)));
+			};
+			// A few blocks per thread at most wait for a slow writer
+			const int thread_count = std::max(g_settings.getInteger(Config::WORKER_THREADS), 1);
+			runBoundedOrderedJobs(job_count, thread_count, size_t(thread_count) * 4, serialize, write);
 
 			f.addNode(OTBM_TOWNS);
 			for (const auto& townEntry : map.towns) {
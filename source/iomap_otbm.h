@@ -19,6 +19,9 @@
 #define RME_OTBM_MAP_IO_H_
 
 #include "iomap.h"
+#include "filehandle.h"
+
+#include <unordered_map>
 
 // Pragma pack is VERY important since otherwise it won't be able to load the structs correctly
 #pragma pack(1)
@@ -123,9 +126,59 @@ struct OTBM_HouseTile_coords {
 
 #pragma pack()
 
+struct OTBMTileAreaBatch;
+class OTBMAreaSource;
+
+// Where the tile areas of one 256x256 block were written to, all floors of a
+// block are stored as one run of tile area nodes
+struct OTBMAreaIndexEntry {
+	uint32_t key; // SavedAreaCache::getBlockKey
+	uint64_t offset;
+	uint64_t size;
+};
+typedef std::vector<OTBMAreaIndexEntry> OTBMAreaIndex;
+
+// Writes tiles[begin, end), in map iteration order, as tile area nodes. A new
+// area starts wherever the 256x256 block or the floor changes and the last
+// one is closed at the end, so ranges split at block boundaries write the
+// same bytes one after another as the whole range does in one go.
+// writeTile adds the node of one tile.
+template <class TileType, class WriteTile>
+void writeTileAreas(NodeFileWriteHandle& f, const std::vector<TileType*>& tiles, size_t begin, size_t end, WriteTile writeTile) {
+	for (size_t index = begin; index < end; ++index) {
+		const Position& pos = tiles[index]->getPosition();
+
+		// Decide if a new node should be created, an area covers 256x256 tiles of one floor
+		bool new_area = true;
+		if (index != begin) {
+			const Position& last_pos = tiles[index - 1]->getPosition();
+			new_area = (pos.x & 0xFF00) != (last_pos.x & 0xFF00) || (pos.y & 0xFF00) != (last_pos.y & 0xFF00) || pos.z != last_pos.z;
+		}
+
+		if (new_area) {
+			// End last node
+			if (index != begin) {
+				f.endNode();
+			}
+
+			// Start new node
+			f.addNode(OTBM_TILE_AREA);
+			f.addU16(pos.x & 0xFF00);
+			f.addU16(pos.y & 0xFF00);
+			f.addU8(pos.z);
+		}
+		writeTile(tiles[index]);
+	}
+
+	if (begin != end) {
+		f.endNode();
+	}
+}
+
 class IOMapOTBM : public IOMap {
 public:
-	IOMapOTBM(MapVersion ver) {
+	IOMapOTBM(MapVersion ver) :
+		area_source(nullptr) {
 		version = ver;
 	}
 	~IOMapOTBM() { }
@@ -135,10 +188,17 @@ public:
 	virtual bool loadMap(Map& map, const FileName& identifier);
 	virtual bool saveMap(Map& map, const FileName& identifier);
 
+	// The area index is kept next to the map as "<map>.idx"
+	static bool loadAreaIndex(const FileName& identifier, uint64_t file_size, OTBMAreaIndex& index);
+	static bool saveAreaIndex(const FileName& identifier, uint64_t file_size, const OTBMAreaIndex& index);
+
 protected:
 	static bool getVersionInfo(NodeFileReadHandle* f, MapVersion& out_ver);
 
 	virtual bool loadMap(Map& map, NodeFileReadHandle& handle);
+	// progress_size is the size of the file, or 0 to not report progress
+	void loadTileAreas(Map& map, std::vector<OTBMTileAreaBatch>& batches, size_t progress_size);
+	void spliceTileArea(Map& map, OTBMTileAreaBatch& batch);
 	bool loadSpawns(Map& map, const FileName& dir);
 	bool loadSpawns(Map& map, pugi::xml_document& doc);
 	bool loadHouses(Map& map, const FileName& dir);
@@ -153,6 +213,69 @@ protected:
 	bool saveHouses(Map& map, pugi::xml_document& doc);
 	bool saveWaypoints(Map& map, const FileName& dir);
 	bool saveWaypoints(Map& map, pugi::xml_document& doc);
+
+	// Set while lazily opening a map, its areas are left in the file
+	OTBMAreaSource* area_source;
+	// Filled by saveMap
+	OTBMAreaIndex saved_areas;
+
+	friend class OTBMAreaSource;
+};
+
+// The tile areas of a lazily opened map that have not been needed yet. They
+// are left in the source file, which stays mapped into memory, and a block
+// is decoded into the map the first time one of its tiles is used.
+class OTBMAreaSource : boost::noncopyable {
+public:
+	OTBMAreaSource();
+
+	// Fails if the index does not describe the file
+	bool open(const std::string& filename, const OTBMAreaIndex& index);
+	void setVersion(const MapVersion& version) {
+		maphandle.version = version;
+	}
+	// If the blocks can be written to a file of this version as they are
+	bool isCompatible(const MapVersion& version) const {
+		return maphandle.version.otbm == version.otbm && maphandle.version.client == version.client;
+	}
+
+	bool isPending(uint32_t key) const {
+		auto it = blocks.find(key);
+		return it != blocks.end() && it->second.pending;
+	}
+	size_t getPendingCount() const {
+		return pending;
+	}
+	// Pending blocks in file order
+	std::vector<uint32_t> getPendingBlocks() const;
+	// Raw tile area nodes of a pending block
+	bool getBlock(uint32_t key, const uint8_t*& data, size_t& size) const;
+
+	// Decodes the given pending blocks into the map
+	void load(Map& map, const std::vector<uint32_t>& keys, bool showdialog = false);
+
+	// Called once the map was saved to filename, the pending blocks are read
+	// from the new file from then on
+	void relocate(const std::string& filename, const OTBMAreaIndex& index);
+
+protected:
+	// Steps over the block that starts at areaNode while the map is opened
+	bool skipBlock(BinaryNode* areaNode);
+
+	struct Block {
+		size_t offset;
+		size_t size;
+		bool pending;
+	};
+
+	IOMapOTBM maphandle;
+	std::unique_ptr<MemoryMappedFile> file;
+	std::unordered_map<uint32_t, Block> blocks;
+	// Block keys in file order
+	std::vector<uint32_t> order;
+	size_t pending;
+
+	friend class IOMapOTBM;
 };
 
 #endif
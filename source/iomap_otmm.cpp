@@ -794,6 +794,7 @@ bool IOMapOTMM::saveMap(Map& map, NodeFileWriteHandle& f, const FileName& identi
 			// Start writing tiles
 			uint tiles_saved = 0;
 
+			map.loadAllAreas();
 			MapIterator map_iterator = map.begin();
 
 			f.addNode(OTMM_TILE_DATA);
@@ -88,7 +88,7 @@ Item* Item::deepCopy() const {
 	if (copy) {
 		copy->selected = selected;
 		if (attributes) {
-			copy->attributes = newd ItemAttributeMap(*attributes);
+			copy->attributes = newd ItemAttributeList(*attributes);
 		}
 	}
 	return copy;
@@ -265,23 +265,23 @@ double Item::getWeight() const {
 }
 
 void Item::setUniqueID(unsigned short n) {
-	setAttribute("uid", n);
+	setAttribute(ATTRIBUTE_UNIQUE_ID, n);
 }
 
 void Item::setActionID(unsigned short n) {
-	setAttribute("aid", n);
+	setAttribute(ATTRIBUTE_ACTION_ID, n);
 }
 
 void Item::setText(const std::string& str) {
-	setAttribute("text", str);
+	setAttribute(ATTRIBUTE_TEXT, str);
 }
 
 void Item::setDescription(const std::string& str) {
-	setAttribute("desc", str);
+	setAttribute(ATTRIBUTE_DESCRIPTION, str);
 }
 
 void Item::setTier(unsigned short n) {
-	setAttribute("tier", n);
+	setAttribute(ATTRIBUTE_TIER, n);
 }
 
 double Item::getWeight() {
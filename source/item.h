@@ -89,6 +89,16 @@ protected:
 public:
 	virtual ~Item();
 
+	// Plain items are drawn from the pool shared by all maps (see MapAllocator),
+	// larger complex item types fall through to the regular heap
+	static void* operator new(size_t size);
+	static void operator delete(void* ptr, size_t size);
+#ifdef DEBUG_MEM
+	static void* operator new(size_t size, const char* file, int line) {
+		return operator new(size);
+	}
+#endif
+
 	// Deep copy thingy
 	virtual Item* deepCopy() const;
 
@@ -402,7 +412,7 @@ protected:
 	// Subtype is either fluid type, count, subtype or charges
 	uint16_t subtype;
 	bool selected;
-	int frame;
+	uint8_t frame;
 
 private:
 	Item& operator=(const Item& i); // Can't copy
@@ -423,7 +433,7 @@ inline int Item::getCount() const {
 }
 
 inline uint16_t Item::getUniqueID() const {
-	const int32_t* a = getIntegerAttribute("uid");
+	const int32_t* a = getIntegerAttribute(ATTRIBUTE_UNIQUE_ID);
 	if (a) {
 		return *a;
 	}
@@ -431,7 +441,7 @@ inline uint16_t Item::getUniqueID() const {
 }
 
 inline uint16_t Item::getActionID() const {
-	const int32_t* a = getIntegerAttribute("aid");
+	const int32_t* a = getIntegerAttribute(ATTRIBUTE_ACTION_ID);
 	if (a) {
 		return *a;
 	}
@@ -439,7 +449,7 @@ inline uint16_t Item::getActionID() const {
 }
 
 inline uint16_t Item::getTier() const {
-	const int32_t* a = getIntegerAttribute("tier");
+	const int32_t* a = getIntegerAttribute(ATTRIBUTE_TIER);
 	if (a) {
 		return *a;
 	}
@@ -447,7 +457,7 @@ inline uint16_t Item::getTier() const {
 }
 
 inline std::string Item::getText() const {
-	const std::string* a = getStringAttribute("text");
+	const std::string* a = getStringAttribute(ATTRIBUTE_TEXT);
 	if (a) {
 		return *a;
 	}
@@ -455,7 +465,7 @@ inline std::string Item::getText() const {
 }
 
 inline std::string Item::getDescription() const {
-	const std::string* a = getStringAttribute("desc");
+	const std::string* a = getStringAttribute(ATTRIBUTE_DESCRIPTION);
 	if (a) {
 		return *a;
 	}
@@ -20,14 +20,83 @@
 #include "item_attributes.h"
 #include "filehandle.h"
 
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace {
+	struct AttributeKeyTable {
+		std::shared_mutex mutex;
+		std::unordered_map<std::string, ItemAttributeKey> ids;
+		// deque keeps the names in place as the table grows
+		std::deque<std::string> names;
+
+		AttributeKeyTable() {
+			// Must match the order of the ATTRIBUTE_* constants
+			for (const char* name : { "aid", "uid", "text", "desc", "tier", "keyid" }) {
+				ids.emplace(name, ItemAttributeKey(names.size()));
+				names.emplace_back(name);
+			}
+		}
+	};
+
+	AttributeKeyTable& getKeyTable() {
+		static AttributeKeyTable table;
+		return table;
+	}
+}
+
+ItemAttributeKey ItemAttributeKeys::intern(const std::string& name) {
+	AttributeKeyTable& table = getKeyTable();
+	{
+		std::shared_lock<std::shared_mutex> lock(table.mutex);
+		auto it = table.ids.find(name);
+		if (it != table.ids.end()) {
+			return it->second;
+		}
+	}
+
+	std::unique_lock<std::shared_mutex> lock(table.mutex);
+	auto it = table.ids.find(name);
+	if (it != table.ids.end()) {
+		return it->second;
+	}
+	if (table.names.size() >= ATTRIBUTE_INVALID) {
+		return ATTRIBUTE_INVALID;
+	}
+	ItemAttributeKey key = ItemAttributeKey(table.names.size());
+	table.ids.emplace(name, key);
+	table.names.push_back(name);
+	return key;
+}
+
+ItemAttributeKey ItemAttributeKeys::find(const std::string& name) {
+	AttributeKeyTable& table = getKeyTable();
+	std::shared_lock<std::shared_mutex> lock(table.mutex);
+	auto it = table.ids.find(name);
+	if (it != table.ids.end()) {
+		return it->second;
+	}
+	return ATTRIBUTE_INVALID;
+}
+
+const std::string& ItemAttributeKeys::getName(ItemAttributeKey key) {
+	AttributeKeyTable& table = getKeyTable();
+	std::shared_lock<std::shared_mutex> lock(table.mutex);
+	ASSERT(key < table.names.size());
+	return table.names[key];
+}
+
 ItemAttributes::ItemAttributes() :
 	attributes(nullptr) {
 	////
 }
 
-ItemAttributes::ItemAttributes(const ItemAttributes& o) {
+ItemAttributes::ItemAttributes(const ItemAttributes& o) :
+	attributes(nullptr) {
 	if (o.attributes) {
-		attributes = newd ItemAttributeMap(*o.attributes);
+		attributes = newd ItemAttributeList(*o.attributes);
 	}
 }
 
@@ -37,7 +106,7 @@ ItemAttributes::~ItemAttributes() {
 
 void ItemAttributes::createAttributes() {
 	if (!attributes) {
-		attributes = newd ItemAttributeMap;
+		attributes = newd ItemAttributeList;
 	}
 }
 
@@ -49,95 +118,112 @@ void ItemAttributes::clearAllAttributes() {
 }
 
 ItemAttributeMap ItemAttributes::getAttributes() const {
+	ItemAttributeMap map;
 	if (attributes) {
-		return *attributes;
+		for (const ItemAttributeList::Entry& entry : *attributes) {
+			map.emplace(ItemAttributeKeys::getName(entry.key), entry.value);
+		}
 	}
-	return ItemAttributeMap();
+	return map;
 }
 
 void ItemAttributes::setAttribute(const std::string& key, const ItemAttribute& value) {
-	createAttributes();
-	(*attributes)[key] = value;
+	setAttribute(ItemAttributeKeys::intern(key), value);
 }
 
 void ItemAttributes::setAttribute(const std::string& key, const std::string& value) {
-	createAttributes();
-	(*attributes)[key].set(value);
+	setAttribute(ItemAttributeKeys::intern(key), value);
 }
 
 void ItemAttributes::setAttribute(const std::string& key, int32_t value) {
-	createAttributes();
-	(*attributes)[key].set(value);
+	setAttribute(ItemAttributeKeys::intern(key), value);
 }
 
 void ItemAttributes::setAttribute(const std::string& key, double value) {
-	createAttributes();
-	(*attributes)[key].set(value);
+	setAttribute(ItemAttributeKeys::intern(key), value);
 }
 
 void ItemAttributes::setAttribute(const std::string& key, bool value) {
+	setAttribute(ItemAttributeKeys::intern(key), value);
+}
+
+void ItemAttributes::setAttribute(ItemAttributeKey key, const ItemAttribute& value) {
+	if (key == ATTRIBUTE_INVALID) {
+		return;
+	}
 	createAttributes();
-	(*attributes)[key].set(value);
+	attributes->get(key) = value;
 }
 
-void ItemAttributes::eraseAttribute(const std::string& key) {
-	if (!attributes) {
+void ItemAttributes::setAttribute(ItemAttributeKey key, const std::string& value) {
+	if (key == ATTRIBUTE_INVALID) {
+		return;
+	}
+	createAttributes();
+	attributes->get(key).set(value);
+}
+
+void ItemAttributes::setAttribute(ItemAttributeKey key, int32_t value) {
+	if (key == ATTRIBUTE_INVALID) {
+		return;
+	}
+	createAttributes();
+	attributes->get(key).set(value);
+}
+
+void ItemAttributes::setAttribute(ItemAttributeKey key, double value) {
+	if (key == ATTRIBUTE_INVALID) {
 		return;
 	}
+	createAttributes();
+	attributes->get(key).set(value);
+}
+
+void ItemAttributes::setAttribute(ItemAttributeKey key, bool value) {
+	if (key == ATTRIBUTE_INVALID) {
+		return;
+	}
+	createAttributes();
+	attributes->get(key).set(value);
+}
 
-	ItemAttributeMap::iterator iter = attributes->find(key);
+void ItemAttributes::eraseAttribute(const std::string& key) {
+	eraseAttribute(ItemAttributeKeys::find(key));
+}
 
-	if (iter != attributes->end()) {
-		attributes->erase(iter);
+void ItemAttributes::eraseAttribute(ItemAttributeKey key) {
+	if (!attributes || key == ATTRIBUTE_INVALID) {
+		return;
 	}
+	attributes->erase(key);
 }
 
 const std::string* ItemAttributes::getStringAttribute(const std::string& key) const {
 	if (!attributes) {
 		return nullptr;
 	}
-
-	ItemAttributeMap::iterator iter = attributes->find(key);
-	if (iter != attributes->end()) {
-		return iter->second.getString();
-	}
-	return nullptr;
+	return getStringAttribute(ItemAttributeKeys::find(key));
 }
 
 const int32_t* ItemAttributes::getIntegerAttribute(const std::string& key) const {
 	if (!attributes) {
 		return nullptr;
 	}
-
-	ItemAttributeMap::iterator iter = attributes->find(key);
-	if (iter != attributes->end()) {
-		return iter->second.getInteger();
-	}
-	return nullptr;
+	return getIntegerAttribute(ItemAttributeKeys::find(key));
 }
 
 const double* ItemAttributes::getFloatAttribute(const std::string& key) const {
 	if (!attributes) {
 		return nullptr;
 	}
-
-	ItemAttributeMap::iterator iter = attributes->find(key);
-	if (iter != attributes->end()) {
-		return iter->second.getFloat();
-	}
-	return nullptr;
+	return getFloatAttribute(ItemAttributeKeys::find(key));
 }
 
 const bool* ItemAttributes::getBooleanAttribute(const std::string& key) const {
 	if (!attributes) {
 		return nullptr;
 	}
-
-	ItemAttributeMap::iterator iter = attributes->find(key);
-	if (iter != attributes->end()) {
-		return iter->second.getBoolean();
-	}
-	return nullptr;
+	return getBooleanAttribute(ItemAttributeKeys::find(key));
 }
 
 bool ItemAttributes::hasStringAttribute(const std::string& key) const {
@@ -156,32 +242,126 @@ bool ItemAttributes::hasBooleanAttribute(const std::string& key) const {
 	return getBooleanAttribute(key) != nullptr;
 }
 
+// Attribute list
+// Sorted by key, the first few entries are stored inside the list itself
+
+ItemAttributeList::ItemAttributeList() :
+	entries(reinterpret_cast<Entry*>(storage)),
+	count(0),
+	capacity(INLINE_CAPACITY) {
+	////
+}
+
+ItemAttributeList::ItemAttributeList(const ItemAttributeList& o) :
+	ItemAttributeList() {
+	reserve(o.count);
+	for (const Entry& entry : o) {
+		new (entries + count) Entry { entry.key, entry.value };
+		++count;
+	}
+}
+
+ItemAttributeList::~ItemAttributeList() {
+	for (uint32_t i = 0; i < count; ++i) {
+		entries[i].~Entry();
+	}
+	if (entries != reinterpret_cast<Entry*>(storage)) {
+		::operator delete(entries);
+	}
+}
+
+void ItemAttributeList::reserve(uint32_t new_capacity) {
+	if (new_capacity <= capacity) {
+		return;
+	}
+	Entry* moved = reinterpret_cast<Entry*>(::operator new(new_capacity * sizeof(Entry)));
+	for (uint32_t i = 0; i < count; ++i) {
+		new (moved + i) Entry { entries[i].key, std::move(entries[i].value) };
+		entries[i].~Entry();
+	}
+	if (entries != reinterpret_cast<Entry*>(storage)) {
+		::operator delete(entries);
+	}
+	entries = moved;
+	capacity = new_capacity;
+}
+
+ItemAttribute& ItemAttributeList::get(ItemAttributeKey key) {
+	uint32_t index = 0;
+	while (index < count && entries[index].key < key) {
+		++index;
+	}
+	if (index < count && entries[index].key == key) {
+		return entries[index].value;
+	}
+
+	if (count == capacity) {
+		reserve(capacity * 2);
+	}
+	// Shift the tail up one slot to make room
+	if (index < count) {
+		new (entries + count) Entry { entries[count - 1].key, std::move(entries[count - 1].value) };
+		for (uint32_t i = count - 1; i > index; --i) {
+			entries[i].key = entries[i - 1].key;
+			entries[i].value = std::move(entries[i - 1].value);
+		}
+		entries[index].key = key;
+		entries[index].value.clear();
+	} else {
+		new (entries + count) Entry { key, ItemAttribute() };
+	}
+	++count;
+	return entries[index].value;
+}
+
+void ItemAttributeList::erase(ItemAttributeKey key) {
+	uint32_t index = 0;
+	while (index < count && entries[index].key < key) {
+		++index;
+	}
+	if (index == count || entries[index].key != key) {
+		return;
+	}
+	for (uint32_t i = index; i + 1 < count; ++i) {
+		entries[i].key = entries[i + 1].key;
+		entries[i].value = std::move(entries[i + 1].value);
+	}
+	--count;
+	entries[count].~Entry();
+}
+
 // Attribute type
-// Can hold either int, bool or std::string
-// Without using newd to allocate them
+// Can hold either int, double, bool or std::string
+// Strings are the only type allocated separately
 
 ItemAttribute::ItemAttribute() :
-	type(ItemAttribute::NONE) {
+	type(ItemAttribute::NONE),
+	number(0) {
 	////
 }
 
 ItemAttribute::ItemAttribute(const std::string& str) :
-	type(ItemAttribute::STRING) {
-	new (data) std::string(str);
+	type(ItemAttribute::STRING),
+	string(newd std::string(str)) {
+	////
 }
 
 ItemAttribute::ItemAttribute(int32_t i) :
-	type(ItemAttribute::INTEGER) {
-	*reinterpret_cast<int*>(data) = i;
+	type(ItemAttribute::INTEGER),
+	integer(i) {
+	////
 }
 
 ItemAttribute::ItemAttribute(double f) :
-	type(ItemAttribute::DOUBLE) {
-	*reinterpret_cast<double*>(data) = f;
+	type(ItemAttribute::DOUBLE),
+	number(f) {
+	////
 }
 
-ItemAttribute::ItemAttribute(bool b) {
-	*reinterpret_cast<bool*>(data) = b;
+ItemAttribute::ItemAttribute(bool b) :
+	type(ItemAttribute::BOOLEAN),
+	boolean(b) {
+	////
 }
 
 ItemAttribute::ItemAttribute(const ItemAttribute& o) :
@@ -189,6 +369,11 @@ ItemAttribute::ItemAttribute(const ItemAttribute& o) :
 	*this = o;
 }
 
+ItemAttribute::ItemAttribute(ItemAttribute&& o) noexcept :
+	type(ItemAttribute::NONE) {
+	*this = std::move(o);
+}
+
 ItemAttribute& ItemAttribute::operator=(const ItemAttribute& o) {
 	if (&o == this) {
 		return *this;
@@ -197,15 +382,13 @@ ItemAttribute& ItemAttribute::operator=(const ItemAttribute& o) {
 	clear();
 	type = o.type;
 	if (type == STRING) {
-		new (data) std::string(*reinterpret_cast<const std::string*>(&o.data));
+		string = newd std::string(*o.string);
 	} else if (type == INTEGER) {
-		*reinterpret_cast<int32_t*>(data) = *reinterpret_cast<const int32_t*>(&o.data);
-	} else if (type == FLOAT) {
-		*reinterpret_cast<float*>(data) = *reinterpret_cast<const float*>(&o.data);
-	} else if (type == DOUBLE) {
-		*reinterpret_cast<double*>(data) = *reinterpret_cast<const double*>(&o.data);
+		integer = o.integer;
+	} else if (type == FLOAT || type == DOUBLE) {
+		number = o.number;
 	} else if (type == BOOLEAN) {
-		*reinterpret_cast<bool*>(data) = *reinterpret_cast<const bool*>(&o.data);
+		boolean = o.boolean;
 	} else {
 		type = NONE;
 	}
@@ -213,65 +396,91 @@ ItemAttribute& ItemAttribute::operator=(const ItemAttribute& o) {
 	return *this;
 }
 
+ItemAttribute& ItemAttribute::operator=(ItemAttribute&& o) noexcept {
+	if (&o == this) {
+		return *this;
+	}
+
+	clear();
+	type = o.type;
+	if (type == STRING) {
+		string = o.string;
+	} else if (type == INTEGER) {
+		integer = o.integer;
+	} else if (type == FLOAT || type == DOUBLE) {
+		number = o.number;
+	} else if (type == BOOLEAN) {
+		boolean = o.boolean;
+	} else {
+		type = NONE;
+	}
+	o.type = NONE;
+	return *this;
+}
+
 ItemAttribute::~ItemAttribute() {
 	clear();
 }
 
 void ItemAttribute::clear() {
 	if (type == STRING) {
-		(reinterpret_cast<std::string*>(&data))->~basic_string();
-		type = NONE;
+		delete string;
 	}
+	type = NONE;
 }
 
 void ItemAttribute::set(const std::string& str) {
+	if (type == STRING) {
+		*string = str;
+		return;
+	}
 	clear();
 	type = STRING;
-	new (data) std::string(str);
+	string = newd std::string(str);
 }
 
 void ItemAttribute::set(int32_t i) {
 	clear();
 	type = INTEGER;
-	*reinterpret_cast<int32_t*>(&data) = i;
+	integer = i;
 }
 
 void ItemAttribute::set(double y) {
 	clear();
 	type = DOUBLE;
-	*reinterpret_cast<double*>(&data) = y;
+	number = y;
 }
 
 void ItemAttribute::set(bool b) {
 	clear();
 	type = BOOLEAN;
-	*reinterpret_cast<bool*>(&data) = b;
+	boolean = b;
 }
 
 const std::string* ItemAttribute::getString() const {
 	if (type == STRING) {
-		return reinterpret_cast<const std::string*>(&data);
+		return string;
 	}
 	return nullptr;
 }
 
 const int32_t* ItemAttribute::getInteger() const {
 	if (type == INTEGER) {
-		return reinterpret_cast<const int32_t*>(&data);
+		return &integer;
 	}
 	return nullptr;
 }
 
 const double* ItemAttribute::getFloat() const {
 	if (type == DOUBLE) {
-		return reinterpret_cast<const double*>(&data);
+		return &number;
 	}
 	return nullptr;
 }
 
 const bool* ItemAttribute::getBoolean() const {
 	if (type == BOOLEAN) {
-		return reinterpret_cast<const bool*>(&data);
+		return &boolean;
 	}
 	return nullptr;
 }
@@ -291,7 +500,10 @@ bool ItemAttributes::unserializeAttributeMap(const IOMap& maphandle, BinaryNode*
 			if (!attrib.unserialize(maphandle, stream)) {
 				return false;
 			}
-			(*attributes)[key] = attrib;
+			ItemAttributeKey id = ItemAttributeKeys::intern(key);
+			if (id != ATTRIBUTE_INVALID) {
+				attributes->get(id) = std::move(attrib);
+			}
 		}
 	}
 	return true;
@@ -301,17 +513,18 @@ void ItemAttributes::serializeAttributeMap(const IOMap& maphandle, NodeFileWrite
 	// Maximum of 65535 attributes per item
 	f.addU16(std::min((size_t)0xFFFF, attributes->size()));
 
-	ItemAttributeMap::const_iterator attribute = attributes->begin();
+	// Written in key order, readers look attributes up by name
+	auto attribute = attributes->begin();
 	int i = 0;
 	while (attribute != attributes->end() && i <= 0xFFFF) {
-		const std::string& key = attribute->first;
+		const std::string& key = ItemAttributeKeys::getName(attribute->key);
 		if (key.size() > 0xFFFF) {
 			f.addString(key.substr(0, 65535));
 		} else {
 			f.addString(key);
 		}
 
-		attribute->second.serialize(maphandle, f);
+		attribute->value.serialize(maphandle, f);
 		++attribute, ++i;
 	}
 }
@@ -31,6 +31,29 @@ class ItemAttribute;
 class PropWriteStream;
 class PropStream;
 
+// Attribute names are interned, items only store the key id
+typedef uint16_t ItemAttributeKey;
+
+enum : ItemAttributeKey {
+	ATTRIBUTE_ACTION_ID, // "aid"
+	ATTRIBUTE_UNIQUE_ID, // "uid"
+	ATTRIBUTE_TEXT, // "text"
+	ATTRIBUTE_DESCRIPTION, // "desc"
+	ATTRIBUTE_TIER, // "tier"
+	ATTRIBUTE_KEY_ID, // "keyid"
+
+	ATTRIBUTE_INVALID = 0xFFFF
+};
+
+class ItemAttributeKeys {
+public:
+	// Returns the key for the name, registers it if it hasn't been seen before
+	static ItemAttributeKey intern(const std::string& name);
+	// Returns ATTRIBUTE_INVALID if no item ever used the name
+	static ItemAttributeKey find(const std::string& name);
+	static const std::string& getName(ItemAttributeKey key);
+};
+
 class ItemAttribute {
 public:
 	ItemAttribute();
@@ -39,10 +62,12 @@ public:
 	ItemAttribute(double f);
 	ItemAttribute(bool b);
 	ItemAttribute(const ItemAttribute& o);
+	ItemAttribute(ItemAttribute&& o) noexcept;
 	ItemAttribute& operator=(const ItemAttribute& o);
+	ItemAttribute& operator=(ItemAttribute&& o) noexcept;
 	~ItemAttribute();
 
-	enum Type {
+	enum Type : uint8_t {
 		STRING = 1,
 		INTEGER = 2,
 		FLOAT = 3,
@@ -67,9 +92,68 @@ public:
 	const bool* getBoolean() const;
 
 private:
-	char data[sizeof(std::string) > sizeof(double) ? sizeof(std::string) : sizeof(double)];
+	// Strings live out of line so the attribute stays 16 bytes
+	union {
+		int32_t integer;
+		double number;
+		bool boolean;
+		std::string* string;
+	};
+};
+
+// Attributes of a single item, sorted by key. Most items only carry one or
+// two attributes, those are stored inline without a separate allocation.
+class ItemAttributeList {
+public:
+	struct Entry {
+		ItemAttributeKey key;
+		ItemAttribute value;
+	};
+
+	ItemAttributeList();
+	ItemAttributeList(const ItemAttributeList& o);
+	~ItemAttributeList();
+
+	ItemAttributeList& operator=(const ItemAttributeList& o) = delete;
+
+	size_t size() const {
+		return count;
+	}
+	bool empty() const {
+		return count == 0;
+	}
+
+	const Entry* begin() const {
+		return entries;
+	}
+	const Entry* end() const {
+		return entries + count;
+	}
+
+	const ItemAttribute* find(ItemAttributeKey key) const {
+		for (const Entry* entry = entries; entry != entries + count && entry->key <= key; ++entry) {
+			if (entry->key == key) {
+				return &entry->value;
+			}
+		}
+		return nullptr;
+	}
+	// Returns the attribute for the key, inserting an empty one if needed
+	ItemAttribute& get(ItemAttributeKey key);
+	void erase(ItemAttributeKey key);
+
+private:
+	static const uint32_t INLINE_CAPACITY = 2;
+
+	void reserve(uint32_t new_capacity);
+
+	Entry* entries;
+	uint32_t count;
+	uint32_t capacity;
+	alignas(Entry) uint8_t storage[INLINE_CAPACITY * sizeof(Entry)];
 };
 
+// Copy of the attributes keyed by name, for display and editing
 typedef std::map<std::string, ItemAttribute> ItemAttributeMap;
 
 class ItemAttributes {
@@ -89,12 +173,38 @@ public:
 	void setAttribute(const std::string& key, double value);
 	void setAttribute(const std::string& key, bool set);
 
+	void setAttribute(ItemAttributeKey key, const ItemAttribute& attr);
+	void setAttribute(ItemAttributeKey key, const std::string& value);
+	void setAttribute(ItemAttributeKey key, int32_t value);
+	void setAttribute(ItemAttributeKey key, double value);
+	void setAttribute(ItemAttributeKey key, bool set);
+
 	// returns nullptr if the attribute is not set
 	const std::string* getStringAttribute(const std::string& key) const;
 	const int32_t* getIntegerAttribute(const std::string& key) const;
 	const double* getFloatAttribute(const std::string& key) const;
 	const bool* getBooleanAttribute(const std::string& key) const;
 
+	const ItemAttribute* getAttribute(ItemAttributeKey key) const {
+		return attributes ? attributes->find(key) : nullptr;
+	}
+	const std::string* getStringAttribute(ItemAttributeKey key) const {
+		const ItemAttribute* attr = getAttribute(key);
+		return attr ? attr->getString() : nullptr;
+	}
+	const int32_t* getIntegerAttribute(ItemAttributeKey key) const {
+		const ItemAttribute* attr = getAttribute(key);
+		return attr ? attr->getInteger() : nullptr;
+	}
+	const double* getFloatAttribute(ItemAttributeKey key) const {
+		const ItemAttribute* attr = getAttribute(key);
+		return attr ? attr->getFloat() : nullptr;
+	}
+	const bool* getBooleanAttribute(ItemAttributeKey key) const {
+		const ItemAttribute* attr = getAttribute(key);
+		return attr ? attr->getBoolean() : nullptr;
+	}
+
 	// Returns true if the attribute (of that type) exists
 	bool hasStringAttribute(const std::string& key) const;
 	bool hasIntegerAttribute(const std::string& key) const;
@@ -102,12 +212,13 @@ public:
 	bool hasBooleanAttribute(const std::string& key) const;
 
 	void eraseAttribute(const std::string& key);
+	void eraseAttribute(ItemAttributeKey key);
 
 	void clearAllAttributes();
 	ItemAttributeMap getAttributes() const;
 
 protected:
-	ItemAttributeMap* attributes;
+	ItemAttributeList* attributes;
 
 	void createAttributes();
 };
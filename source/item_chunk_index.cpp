@@ -0,0 +1,89 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+
+#include "main.h"
+
+#include "item_chunk_index.h"
+
+namespace {
+	void sortUnique(std::vector<uint64_t>& list) {
+		std::sort(list.begin(), list.end());
+		list.erase(std::unique(list.begin(), list.end()), list.end());
+	}
+}
+
+void ItemChunkIndex::clear() {
+	chunks.clear();
+	unsorted.clear();
+}
+
+void ItemChunkIndex::add(uint32_t key, uint64_t chunk) {
+	std::vector<uint64_t>& list = chunks[key];
+	// Tiles of a chunk mostly come one after another
+	if (!list.empty() && list.back() >= chunk) {
+		if (list.back() == chunk) {
+			return;
+		}
+		unsorted.insert(key);
+	}
+	list.push_back(chunk);
+}
+
+std::vector<uint64_t> ItemChunkIndex::getCandidates(const std::vector<uint32_t>& keys) {
+	std::vector<uint64_t> candidates;
+	for (uint32_t key : keys) {
+		auto it = chunks.find(key);
+		if (it == chunks.end()) {
+			continue;
+		}
+		if (unsorted.erase(key)) {
+			sortUnique(it->second);
+		}
+		candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+	}
+	if (keys.size() > 1) {
+		sortUnique(candidates);
+	}
+	return candidates;
+}
+
+void ItemChunkIndex::prune(const std::vector<uint32_t>& keys, const std::vector<uint64_t>& candidates, size_t searched, const std::vector<uint32_t>& found) {
+	for (size_t k = 0; k < keys.size(); ++k) {
+		auto it = chunks.find(keys[k]);
+		if (it == chunks.end()) {
+			continue;
+		}
+
+		std::vector<uint64_t>& list = it->second;
+		size_t candidate = 0;
+		size_t kept = 0;
+		for (uint64_t chunk : list) {
+			while (candidate < searched && candidates[candidate] < chunk) {
+				++candidate;
+			}
+			if (candidate < searched && candidates[candidate] == chunk && (found[candidate] & (1u << k)) == 0) {
+				continue;
+			}
+			list[kept++] = chunk;
+		}
+		list.resize(kept);
+		if (list.empty()) {
+			chunks.erase(it);
+		}
+	}
+}
@@ -0,0 +1,59 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+
+#ifndef RME_ITEM_CHUNK_INDEX_H
+#define RME_ITEM_CHUNK_INDEX_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// The chunk lists behind ItemIndex: for every index key, the keys of the 4x4
+// chunks that may hold items with it. Lists are sorted lazily and entries of
+// chunks that lost a key are only dropped once a search has looked at them.
+class ItemChunkIndex {
+public:
+	// Chunks sort by floor, then x / 4, then y / 4
+	static uint64_t getChunkKey(int x, int y, int z) {
+		return uint64_t(z) << 32 | uint64_t(uint32_t(x) >> 2) << 16 | (uint32_t(y) >> 2);
+	}
+	// The tile at the top left corner of the chunk
+	static void getChunkOrigin(uint64_t chunk, int& x, int& y, int& z) {
+		z = int(chunk >> 32);
+		x = int((chunk >> 16) & 0xFFFF) << 2;
+		y = int(chunk & 0xFFFF) << 2;
+	}
+
+	void clear();
+	// Chunks can be added in any order and more than once
+	void add(uint32_t key, uint64_t chunk);
+
+	// The sorted chunks that may hold any of the keys
+	std::vector<uint64_t> getCandidates(const std::vector<uint32_t>& keys);
+	// Called after getCandidates with the same keys, drops the chunks among
+	// the first searched candidates from the list of every key whose bit isn't
+	// set in their found mask
+	void prune(const std::vector<uint32_t>& keys, const std::vector<uint64_t>& candidates, size_t searched, const std::vector<uint32_t>& found);
+
+private:
+	std::unordered_map<uint32_t, std::vector<uint64_t>> chunks;
+	std::unordered_set<uint32_t> unsorted;
+};
+
+#endif
@@ -0,0 +1,184 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+
+#include "main.h"
+
+#include "item_index.h"
+#include "map.h"
+#include "complexitem.h"
+#include "gui.h"
+
+ItemIndex::ItemIndex() :
+	built(false) {
+	////
+}
+
+bool ItemIndex::matches(const Item* item, uint32_t key) {
+	const uint16_t value = key & 0xFFFF;
+	switch (key >> 16) {
+		case ITEM_ID:
+			return item->getID() == value;
+		case ACTION_ID:
+			return value != 0 && item->getActionID() == value;
+		case UNIQUE_ID:
+			return value != 0 && item->getUniqueID() == value;
+		case ANY_ACTION:
+			return item->getActionID() > 0;
+		case ANY_UNIQUE:
+			return item->getUniqueID() > 0;
+		case ANY_TEXT:
+			return !item->getText().empty();
+		case ANY_CONTAINER: {
+			const Container* container = dynamic_cast<const Container*>(item);
+			return container && container->getItemCount() > 0;
+		}
+		default:
+			return false;
+	}
+}
+
+void ItemIndex::getKeys(const Item* item, std::vector<uint32_t>& keys) {
+	keys.push_back(makeKey(ITEM_ID, item->getID()));
+	if (const uint16_t aid = item->getActionID()) {
+		keys.push_back(makeKey(ACTION_ID, aid));
+		keys.push_back(makeKey(ANY_ACTION));
+	}
+	if (const uint16_t uid = item->getUniqueID()) {
+		keys.push_back(makeKey(UNIQUE_ID, uid));
+		keys.push_back(makeKey(ANY_UNIQUE));
+	}
+	if (!item->getText().empty()) {
+		keys.push_back(makeKey(ANY_TEXT));
+	}
+	if (matches(item, makeKey(ANY_CONTAINER))) {
+		keys.push_back(makeKey(ANY_CONTAINER));
+	}
+}
+
+void ItemIndex::getKeys(Tile* tile, std::vector<uint32_t>& keys) {
+	foreach_ItemOnTile(tile, [&keys](Item* item) {
+		getKeys(item, keys);
+	});
+}
+
+void ItemIndex::clear() {
+	chunks.clear();
+	dirty_chunks.clear();
+	built = false;
+}
+
+void ItemIndex::build(Map& map, bool showdialog) {
+	clear();
+	map.loadAllAreas();
+
+	std::vector<uint32_t> keys;
+	uint64_t done = 0;
+	for (MapIterator it = map.begin(); it != map.end(); ++it) {
+		Tile* tile = (*it)->get();
+		const Position& pos = tile->getPosition();
+		const uint64_t chunk = ItemChunkIndex::getChunkKey(pos.x, pos.y, pos.z);
+
+		keys.clear();
+		getKeys(tile, keys);
+		for (uint32_t key : keys) {
+			chunks.add(key, chunk);
+		}
+
+		if (showdialog && ++done % 0x8000 == 0) {
+			g_gui.SetLoadDone((unsigned int)(100 * done / map.getTileCount()));
+		}
+	}
+	built = true;
+}
+
+void ItemIndex::update(Map& map) {
+	std::vector<uint32_t> keys;
+	for (uint64_t chunk : dirty_chunks) {
+		int x, y, z;
+		ItemChunkIndex::getChunkOrigin(chunk, x, y, z);
+
+		keys.clear();
+		for (int dx = 0; dx < 4; ++dx) {
+			for (int dy = 0; dy < 4; ++dy) {
+				if (Tile* tile = map.getTile(x + dx, y + dy, z)) {
+					getKeys(tile, keys);
+				}
+			}
+		}
+
+		// Keys the chunk has lost are left for find to drop
+		std::sort(keys.begin(), keys.end());
+		keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+		for (uint32_t key : keys) {
+			chunks.add(key, chunk);
+		}
+	}
+	dirty_chunks.clear();
+}
+
+std::vector<std::pair<Tile*, Item*>> ItemIndex::find(Map& map, const std::vector<uint32_t>& keys, size_t max_count, bool showdialog) {
+	ASSERT(keys.size() <= 32);
+	if (built) {
+		update(map);
+	} else {
+		build(map, showdialog);
+	}
+
+	const std::vector<uint64_t> candidates = chunks.getCandidates(keys);
+
+	// Which keys were found in each chunk, chunks are always searched to the
+	// end so that the ones that turn out not to have a key can be dropped
+	std::vector<uint32_t> found(candidates.size(), 0);
+	std::vector<std::pair<Tile*, Item*>> result;
+
+	size_t searched = 0;
+	for (; searched < candidates.size() && (max_count == 0 || result.size() < max_count); ++searched) {
+		int x, y, z;
+		ItemChunkIndex::getChunkOrigin(candidates[searched], x, y, z);
+
+		for (int dx = 0; dx < 4; ++dx) {
+			for (int dy = 0; dy < 4; ++dy) {
+				Tile* tile = map.getTile(x + dx, y + dy, z);
+				if (!tile) {
+					continue;
+				}
+
+				foreach_ItemOnTile(tile, [&](Item* item) {
+					bool match = false;
+					for (size_t k = 0; k < keys.size(); ++k) {
+						if (matches(item, keys[k])) {
+							found[searched] |= 1u << k;
+							match = true;
+						}
+					}
+					if (match && (max_count == 0 || result.size() < max_count)) {
+						result.emplace_back(tile, item);
+					}
+				});
+			}
+		}
+	}
+
+	chunks.prune(keys, candidates, searched, found);
+
+	// In map order rather than chunk order, the items of a tile keep their order
+	std::stable_sort(result.begin(), result.end(), [](const std::pair<Tile*, Item*>& a, const std::pair<Tile*, Item*>& b) {
+		return a.first->getPosition() < b.first->getPosition();
+	});
+	return result;
+}
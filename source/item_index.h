@@ -0,0 +1,84 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+
+#ifndef RME_ITEM_INDEX_H_
+#define RME_ITEM_INDEX_H_
+
+#include "item_chunk_index.h"
+#include "position.h"
+
+class Map;
+class Tile;
+class Item;
+
+// Which 4x4 chunks of the map hold items with a given id, action id or
+// unique id, so that searches only have to look at those chunks instead of
+// every item on the map. It is built by the first search and kept up to date
+// from the same places that invalidate the saved area cache.
+class ItemIndex {
+public:
+	enum Kind : uint16_t {
+		ITEM_ID,
+		ACTION_ID,
+		UNIQUE_ID,
+		// Any item with an action id, unique id, text or a non-empty container
+		ANY_ACTION,
+		ANY_UNIQUE,
+		ANY_TEXT,
+		ANY_CONTAINER,
+	};
+
+	static uint32_t makeKey(Kind kind, uint16_t value = 0) {
+		return uint32_t(kind) << 16 | value;
+	}
+	static bool matches(const Item* item, uint32_t key);
+
+	ItemIndex();
+
+	// Must be called whenever the items of a tile are changed
+	void markDirty(const Position& pos) {
+		if (built) {
+			dirty_chunks.insert(ItemChunkIndex::getChunkKey(pos.x, pos.y, pos.z));
+		}
+	}
+	// For changes that may touch any tile, the index is rebuilt by the next search
+	void clear();
+
+	bool isBuilt() const {
+		return built;
+	}
+
+	// All items matching any of the keys, sorted by position. With a
+	// max_count other than 0 only the first max_count found are returned,
+	// chunks are searched by floor, then x / 4, then y / 4. Loads all areas
+	// of the map and builds the index if needed.
+	std::vector<std::pair<Tile*, Item*>> find(Map& map, const std::vector<uint32_t>& keys, size_t max_count = 0, bool showdialog = false);
+
+private:
+	static void getKeys(const Item* item, std::vector<uint32_t>& keys);
+	static void getKeys(Tile* tile, std::vector<uint32_t>& keys);
+
+	void build(Map& map, bool showdialog);
+	void update(Map& map);
+
+	ItemChunkIndex chunks;
+	std::unordered_set<uint64_t> dirty_chunks;
+	bool built;
+};
+
+#endif
@@ -18,7 +18,34 @@
 #include "main.h"
 #include "light_drawer.h"
 
-LightDrawer::LightDrawer() {
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define LIGHT_DRAWER_SSE2
+	#include <emmintrin.h>
+#endif
+
+namespace {
+	// dest = max(dest, source) for every byte
+	void maxBytes(uint8_t* dest, const uint8_t* source, int count) {
+		int i = 0;
+#ifdef LIGHT_DRAWER_SSE2
+		for (; i + 16 <= count; i += 16) {
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dest + i));
+			__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), _mm_max_epu8(a, b));
+		}
+#endif
+		for (; i < count; ++i) {
+			dest[i] = std::max(dest[i], source[i]);
+		}
+	}
+}
+
+LightDrawer::LightDrawer() :
+	buffer_x(0),
+	buffer_y(0),
+	buffer_width(0),
+	buffer_height(0),
+	buffer_valid(false) {
 	texture = 0;
 	global_color = wxColor(50, 50, 50, 255);
 }
@@ -37,48 +64,23 @@ void LightDrawer::draw(int map_x, int map_y, int end_x, int end_y, int scroll_x,
 	int w = end_x - map_x;
 	int h = end_y - map_y;
 
-	buffer.resize(static_cast<size_t>(w * h * PixelFormatRGBA));
-
-	for (int x = 0; x < w; ++x) {
-		for (int y = 0; y < h; ++y) {
-			int mx = (map_x + x);
-			int my = (map_y + y);
-			int index = (y * w + x);
-			int color_index = index * PixelFormatRGBA;
-
-			buffer[color_index] = global_color.Red();
-			buffer[color_index + 1] = global_color.Green();
-			buffer[color_index + 2] = global_color.Blue();
-			buffer[color_index + 3] = 140; // global_color.Alpha();
-
-			for (auto& light : lights) {
-				float intensity = calculateIntensity(mx, my, light);
-				if (intensity == 0.f) {
-					continue;
-				}
-				wxColor light_color = colorFromEightBit(light.color);
-				uint8_t red = static_cast<uint8_t>(light_color.Red() * intensity);
-				uint8_t green = static_cast<uint8_t>(light_color.Green() * intensity);
-				uint8_t blue = static_cast<uint8_t>(light_color.Blue() * intensity);
-				buffer[color_index] = std::max(buffer[color_index], red);
-				buffer[color_index + 1] = std::max(buffer[color_index + 1], green);
-				buffer[color_index + 2] = std::max(buffer[color_index + 2], blue);
-			}
-		}
-	}
-
-	const int draw_x = map_x * TileSize - scroll_x;
-	const int draw_y = map_y * TileSize - scroll_y;
-	int draw_width = w * TileSize;
-	int draw_height = h * TileSize;
-
 	glBindTexture(GL_TEXTURE_2D, texture);
 
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, 0x812F);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, 0x812F);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, buffer.data());
+
+	bool changed = !buffer_valid || map_x != buffer_x || map_y != buffer_y || w != buffer_width || h != buffer_height || global_color != buffer_color || lights != buffer_lights;
+	if (changed) {
+		updateBuffer(map_x, map_y, w, h);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, buffer.data());
+	}
+
+	const int draw_x = map_x * TileSize - scroll_x;
+	const int draw_y = map_y * TileSize - scroll_y;
+	int draw_width = w * TileSize;
+	int draw_height = h * TileSize;
 
 	if (!fog) {
 		glBlendFunc(GL_DST_COLOR, GL_ONE_MINUS_SRC_ALPHA);
@@ -111,6 +113,68 @@ void LightDrawer::draw(int map_x, int map_y, int end_x, int end_y, int scroll_x,
 	}
 }
 
+void LightDrawer::updateBuffer(int map_x, int map_y, int width, int height) {
+	buffer.resize(static_cast<size_t>(width * height * PixelFormatRGBA));
+
+	const uint8_t ambient[PixelFormatRGBA] = { global_color.Red(), global_color.Green(), global_color.Blue(), 140 };
+	for (size_t i = 0; i < buffer.size(); i += PixelFormatRGBA) {
+		memcpy(&buffer[i], ambient, PixelFormatRGBA);
+	}
+
+	// Lights only reach the tiles around them, so each one is blended into
+	// its own square of the buffer instead of checking it for every tile
+	for (const Light& light : lights) {
+		const int radius = light.intensity;
+		const int size = radius * 2 + 1;
+		const int left = std::max<int>(light.map_x - radius, map_x);
+		const int right = std::min<int>(light.map_x + radius + 1, map_x + width);
+		const int top = std::max<int>(light.map_y - radius, map_y);
+		const int bottom = std::min<int>(light.map_y + radius + 1, map_y + height);
+		if (left >= right || top >= bottom) {
+			continue;
+		}
+
+		const std::vector<uint8_t>& kernel = getKernel(light.color, light.intensity);
+		const int kernel_x = left - (light.map_x - radius);
+		for (int y = top; y < bottom; ++y) {
+			const int kernel_y = y - (light.map_y - radius);
+			uint8_t* row = &buffer[((y - map_y) * width + (left - map_x)) * PixelFormatRGBA];
+			maxBytes(row, &kernel[(kernel_y * size + kernel_x) * PixelFormatRGBA], (right - left) * PixelFormatRGBA);
+		}
+	}
+
+	buffer_lights = lights;
+	buffer_x = map_x;
+	buffer_y = map_y;
+	buffer_width = width;
+	buffer_height = height;
+	buffer_color = global_color;
+	buffer_valid = true;
+}
+
+const std::vector<uint8_t>& LightDrawer::getKernel(uint8_t color, uint8_t intensity) {
+	std::vector<uint8_t>& kernel = kernels[color << 8 | intensity];
+	if (!kernel.empty()) {
+		return kernel;
+	}
+
+	const wxColor light_color = colorFromEightBit(color);
+	const int radius = intensity;
+	const int size = radius * 2 + 1;
+	// The alpha stays zero so the ambient alpha is kept
+	kernel.resize(static_cast<size_t>(size * size * PixelFormatRGBA), 0);
+	for (int y = 0; y < size; ++y) {
+		for (int x = 0; x < size; ++x) {
+			float factor = calculateIntensity(x - radius, y - radius, intensity);
+			uint8_t* pixel = &kernel[(y * size + x) * PixelFormatRGBA];
+			pixel[0] = static_cast<uint8_t>(light_color.Red() * factor);
+			pixel[1] = static_cast<uint8_t>(light_color.Green() * factor);
+			pixel[2] = static_cast<uint8_t>(light_color.Blue() * factor);
+		}
+	}
+	return kernel;
+}
+
 void LightDrawer::setGlobalLightColor(uint8_t color) {
 	global_color = colorFromEightBit(color);
 }
@@ -144,6 +208,7 @@ void LightDrawer::clear() noexcept {
 
 void LightDrawer::createGLTexture() {
 	glGenTextures(1, &texture);
+	buffer_valid = false;
 	ASSERT(texture == 0);
 }
 
@@ -18,6 +18,8 @@
 #ifndef RME_LIGHDRAWER_H
 #define RME_LIGHDRAWER_H
 
+#include <unordered_map>
+
 #include "graphics.h"
 #include "position.h"
 
@@ -27,6 +29,10 @@ class LightDrawer {
 		uint16_t map_y = 0;
 		uint8_t color = 0;
 		uint8_t intensity = 0;
+
+		bool operator==(const Light& other) const noexcept {
+			return map_x == other.map_x && map_y == other.map_y && color == other.color && intensity == other.intensity;
+		}
 	};
 
 public:
@@ -43,14 +49,17 @@ private:
 	void createGLTexture();
 	void unloadGLTexture();
 
-	inline float calculateIntensity(int map_x, int map_y, const Light& light) {
-		int dx = map_x - light.map_x;
-		int dy = map_y - light.map_y;
+	void updateBuffer(int map_x, int map_y, int width, int height);
+	// The RGBA a light of this color and intensity adds around itself, a
+	// square of (2 * intensity + 1) tiles per side with the light in the middle
+	const std::vector<uint8_t>& getKernel(uint8_t color, uint8_t intensity);
+
+	static inline float calculateIntensity(int dx, int dy, uint8_t light_intensity) {
 		float distance = std::sqrt(dx * dx + dy * dy);
 		if (distance > MaxLightIntensity) {
 			return 0.f;
 		}
-		float intensity = (-distance + light.intensity) * 0.2f;
+		float intensity = (-distance + light_intensity) * 0.2f;
 		if (intensity < 0.01f) {
 			return 0.f;
 		}
@@ -61,6 +70,15 @@ private:
 	std::vector<Light> lights;
 	std::vector<uint8_t> buffer;
 	wxColor global_color;
+
+	std::unordered_map<uint16_t, std::vector<uint8_t>> kernels;
+
+	// What the texture was last uploaded for, it is reused while none of it changes
+	std::vector<Light> buffer_lights;
+	int buffer_x, buffer_y;
+	int buffer_width, buffer_height;
+	wxColor buffer_color;
+	bool buffer_valid;
 };
 
 #endif
@@ -41,6 +41,8 @@ namespace LuaAPI {
 
 	// Called by tile modification functions to track changes
 	void markTileForUndo(Tile* tile);
+	// Called by item property setters, items don't know which tile they are on
+	void markItemsChanged();
 
 	void registerColor(sol::state& lua);
 	void registerCreature(sol::state& lua);
@@ -245,11 +245,26 @@ namespace LuaAPI {
 
 	// Global accessor for tile modification tracking (used by lua_api_tile.cpp)
 	void markTileForUndo(Tile* tile) {
+		if (tile) {
+			if (Editor* editor = g_gui.GetCurrentEditor()) {
+				editor->map.area_cache.markDirty(tile->getPosition());
+				editor->map.item_index.markDirty(tile->getPosition());
+				if (tile->getLocation()) {
+					tile->getLocation()->touch();
+				}
+			}
+		}
 		if (LuaTransaction::getInstance().isActive()) {
 			LuaTransaction::getInstance().markTileModified(tile);
 		}
 	}
 
+	void markItemsChanged() {
+		if (Editor* editor = g_gui.GetCurrentEditor()) {
+			editor->map.item_index.clear();
+		}
+	}
+
 	// ============================================================================
 	// Helper Functions
 	// ============================================================================
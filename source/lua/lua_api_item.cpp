@@ -17,6 +17,7 @@
 
 #include "main.h"
 #include "lua_api_item.h"
+#include "lua_api.h"
 #include "../item.h"
 #include "../items.h"
 
@@ -56,7 +57,7 @@ namespace LuaAPI {
 			"count", sol::property(&Item::getCount, [](Item& item, int count) {
 				item.setSubtype(static_cast<uint16_t>(count));
 			}),
-			"subtype", sol::property([](const Item& item) -> int { return item.getSubtype(); }, [](Item& item, int subtype) { item.setSubtype(static_cast<uint16_t>(subtype)); }), "actionId", sol::property([](const Item& item) -> int { return item.getActionID(); }, [](Item& item, int aid) { item.setActionID(static_cast<uint16_t>(aid)); }), "uniqueId", sol::property([](const Item& item) -> int { return item.getUniqueID(); }, [](Item& item, int uid) { item.setUniqueID(static_cast<uint16_t>(uid)); }), "tier", sol::property([](const Item& item) -> int { return item.getTier(); }, [](Item& item, int tier) { item.setTier(static_cast<uint16_t>(tier)); }), "text", sol::property(&Item::getText, &Item::setText), "description", sol::property(&Item::getDescription, &Item::setDescription),
+			"subtype", sol::property([](const Item& item) -> int { return item.getSubtype(); }, [](Item& item, int subtype) { item.setSubtype(static_cast<uint16_t>(subtype)); }), "actionId", sol::property([](const Item& item) -> int { return item.getActionID(); }, [](Item& item, int aid) { item.setActionID(static_cast<uint16_t>(aid)); markItemsChanged(); }), "uniqueId", sol::property([](const Item& item) -> int { return item.getUniqueID(); }, [](Item& item, int uid) { item.setUniqueID(static_cast<uint16_t>(uid)); markItemsChanged(); }), "tier", sol::property([](const Item& item) -> int { return item.getTier(); }, [](Item& item, int tier) { item.setTier(static_cast<uint16_t>(tier)); }), "text", sol::property(&Item::getText, [](Item& item, const std::string& text) { item.setText(text); markItemsChanged(); }), "description", sol::property(&Item::getDescription, &Item::setDescription),
 
 			// Selection
 			"isSelected", sol::property(&Item::isSelected), "select", &Item::select, "deselect", &Item::deselect,
@@ -32,6 +32,7 @@ namespace LuaAPI {
 		LuaMapTileIterator(Map* map) :
 			map(map), started(false) {
 			if (map) {
+				map->loadAllAreas();
 				iter = map->begin();
 				endIter = map->end();
 			}
@@ -87,6 +88,7 @@ namespace LuaAPI {
 			if (iter != endIter) {
 				Position pos = *iter;
 				++iter;
+				map->loadArea(pos);
 				return map->getTile(pos);
 			}
 			return nullptr;
@@ -98,6 +100,26 @@ namespace LuaAPI {
 		SpawnPositionList::const_iterator endIter;
 	};
 
+	// Helper to run an item index search, returns a list of { tile = Tile, item = Item }
+	static sol::table findIndexedItems(Map* map, uint32_t key, sol::optional<int> limitOpt, sol::this_state ts) {
+		sol::state_view lua(ts);
+		sol::table result = lua.create_table();
+
+		if (!map) {
+			return result;
+		}
+
+		const size_t limit = limitOpt && *limitOpt > 0 ? size_t(*limitOpt) : 0;
+		int idx = 1;
+		for (const auto& found : map->item_index.find(*map, { key }, limit)) {
+			sol::table entry = lua.create_table();
+			entry["tile"] = found.first;
+			entry["item"] = found.second;
+			result[idx++] = entry;
+		}
+		return result;
+	}
+
 	void registerMap(sol::state& lua) {
 		// Register the iterator type
 		lua.new_usertype<LuaMapTileIterator>("MapTileIterator", sol::no_constructor, "next", &LuaMapTileIterator::next);
@@ -126,7 +148,17 @@ namespace LuaAPI {
 			}),
 
 			// Get tile methods
-			"getTile", sol::overload([](Map* map, int x, int y, int z) -> Tile* { return map ? map->getTile(x, y, z) : nullptr; }, [](Map* map, const Position& pos) -> Tile* { return map ? map->getTile(pos) : nullptr; }),
+			"getTile", sol::overload([](Map* map, int x, int y, int z) -> Tile* {
+				if (!map) {
+					return nullptr;
+				}
+				map->loadArea(Position(x, y, z));
+				return map->getTile(x, y, z); }, [](Map* map, const Position& pos) -> Tile* {
+				if (!map) {
+					return nullptr;
+				}
+				map->loadArea(pos);
+				return map->getTile(pos); }),
 
 			// Get or create tile (for adding content to empty positions)
 			"getOrCreateTile", [](Map* map, sol::variadic_args va) -> Tile* {
@@ -144,6 +176,7 @@ namespace LuaAPI {
 				throw sol::error("getOrCreateTile expects (x, y, z) or (Position)");
 			}
 
+			map->loadArea(pos);
 			return map->getOrCreateTile(pos); },
 
 			// Tiles iterator - allows: for tile in map.tiles do ... end
@@ -159,6 +192,17 @@ namespace LuaAPI {
 				});
 			}),
 
+			// Indexed item searches - allows: for _, found in ipairs(map:findItems(id)) do ... end
+			"findItems", [](Map* map, int itemId, sol::optional<int> limit, sol::this_state ts) {
+				return findIndexedItems(map, ItemIndex::makeKey(ItemIndex::ITEM_ID, static_cast<uint16_t>(itemId)), limit, ts);
+			},
+			"findByActionId", [](Map* map, int actionId, sol::optional<int> limit, sol::this_state ts) {
+				return findIndexedItems(map, ItemIndex::makeKey(ItemIndex::ACTION_ID, static_cast<uint16_t>(actionId)), limit, ts);
+			},
+			"findByUniqueId", [](Map* map, int uniqueId, sol::optional<int> limit, sol::this_state ts) {
+				return findIndexedItems(map, ItemIndex::makeKey(ItemIndex::UNIQUE_ID, static_cast<uint16_t>(uniqueId)), limit, ts);
+			},
+
 			// Spawns iterator - allows: for tile in map.spawns do ... end
 			"spawns", sol::property([](Map* map, sol::this_state ts) {
 				sol::state_view lua(ts);
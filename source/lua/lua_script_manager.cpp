@@ -20,6 +20,7 @@
 #include "lua_api.h"
 #include "lua_api_image.h"
 #include "../gui.h"
+#include "../editor.h"
 #include "../tile.h"
 
 #include <wx/dir.h>
@@ -605,6 +606,13 @@ bool LuaScriptManager::executeScript(const std::string& filepath) {
 	if (!result) {
 		lastError = engine.getLastError();
 	}
+
+	// Scripts may edit items in place, the saved areas can't be trusted anymore
+	if (Editor* editor = g_gui.GetCurrentEditor()) {
+		editor->map.area_cache.clear();
+		editor->map.item_index.clear();
+		editor->map.invalidateTiles();
+	}
 	return result;
 }
 
@@ -258,10 +258,7 @@ namespace OnMapRemoveItems {
 
 		uint16_t itemId;
 
-		bool operator()(Map& map, Item* item, int64_t removed, int64_t done) {
-			if (done % 0x8000 == 0) {
-				g_gui.SetLoadDone((uint32_t)(100 * done / map.getTileCount()));
-			}
+		bool operator()(Map& map, Item* item) const {
 			return item->getID() == itemId && !item->isComplex();
 		}
 	};
@@ -919,23 +916,29 @@ namespace OnSearchForItem {
 		uint32_t maxCount;
 		std::vector<std::pair<Tile*, Item*>> result;
 
+		// No limit when it is 0, like the replace items dialog
 		bool limitReached() const {
-			return result.size() >= (size_t)maxCount;
+			return maxCount != 0 && result.size() >= (size_t)maxCount;
 		}
 
 		void operator()(Map& map, Tile* tile, Item* item, long long done) {
-			if (result.size() >= (size_t)maxCount) {
+			if (limitReached()) {
 				return;
 			}
 
-			if (done % 0x8000 == 0) {
-				g_gui.SetLoadDone((unsigned int)(100 * done / map.getTileCount()));
-			}
-
 			if (item->getID() == itemId) {
 				result.push_back(std::make_pair(tile, item));
 			}
 		}
+
+		void merge(const Finder& other) {
+			for (const auto& found : other.result) {
+				if (limitReached()) {
+					break;
+				}
+				result.push_back(found);
+			}
+		}
 	};
 }
 
@@ -947,17 +950,17 @@ void MainMenuBar::OnSearchForItem(wxCommandEvent& WXUNUSED(event)) {
 	FindItemDialog dialog(frame, "Search for Item");
 	dialog.setSearchMode((FindItemDialog::SearchMode)g_settings.getInteger(Config::FIND_ITEM_MODE));
 	if (dialog.ShowModal() == wxID_OK) {
-		OnSearchForItem::Finder finder(dialog.getResultID(), (uint32_t)g_settings.getInteger(Config::REPLACE_SIZE));
+		const uint32_t maxCount = (uint32_t)g_settings.getInteger(Config::REPLACE_SIZE);
 		g_gui.CreateLoadBar("Searching map...");
 
-		foreach_ItemOnMap(g_gui.GetCurrentMap(), finder, false);
-		std::vector<std::pair<Tile*, Item*>>& result = finder.result;
+		Map& map = g_gui.GetCurrentMap();
+		std::vector<std::pair<Tile*, Item*>> result = map.item_index.find(map, { ItemIndex::makeKey(ItemIndex::ITEM_ID, dialog.getResultID()) }, maxCount, true);
 
 		g_gui.DestroyLoadBar();
 
-		if (finder.limitReached()) {
+		if (maxCount != 0 && result.size() >= (size_t)maxCount) {
 			wxString msg;
-			msg << "The configured limit has been reached. Only " << finder.maxCount << " results will be displayed.";
+			msg << "The configured limit has been reached. Only " << maxCount << " results will be displayed.";
 			g_gui.PopupDialog("Notice", msg, wxOK);
 		}
 
@@ -1001,15 +1004,16 @@ namespace OnSearchForStuff {
 		std::vector<std::pair<Tile*, Item*>> found;
 
 		void operator()(Map& map, Tile* tile, Item* item, long long done) {
-			if (done % 0x8000 == 0) {
-				g_gui.SetLoadDone((unsigned int)(100 * done / map.getTileCount()));
-			}
 			Container* container;
 			if ((search_unique && item->getUniqueID() > 0) || (search_action && item->getActionID() > 0) || (search_container && ((container = dynamic_cast<Container*>(item)) && container->getItemCount())) || (search_writeable && item->getText().length() > 0)) {
 				found.push_back(std::make_pair(tile, item));
 			}
 		}
 
+		void merge(const Searcher& other) {
+			found.insert(found.end(), other.found.begin(), other.found.end());
+		}
+
 		wxString desc(Item* item) {
 			wxString label;
 			if (search_action) {
@@ -1137,7 +1141,7 @@ void MainMenuBar::OnSearchForItemOnSelection(wxCommandEvent& WXUNUSED(event)) {
 		OnSearchForItem::Finder finder(dialog.getResultID(), (uint32_t)g_settings.getInteger(Config::REPLACE_SIZE));
 		g_gui.CreateLoadBar("Searching on selected area...");
 
-		foreach_ItemOnMap(g_gui.GetCurrentMap(), finder, true);
+		foreach_ItemOnMap(g_gui.GetCurrentMap(), finder, true, true);
 		std::vector<std::pair<Tile*, Item*>>& result = finder.result;
 
 		g_gui.DestroyLoadBar();
@@ -1184,7 +1188,7 @@ void MainMenuBar::OnRemoveItemOnSelection(wxCommandEvent& WXUNUSED(event)) {
 		g_gui.GetCurrentEditor()->actionQueue->clear();
 		g_gui.CreateLoadBar("Searching item on selection to remove...");
 		OnMapRemoveItems::RemoveItemCondition condition(dialog.getResultID());
-		int64_t count = RemoveItemOnMap(g_gui.GetCurrentMap(), condition, true);
+		int64_t count = RemoveItemOnMap(g_gui.GetCurrentMap(), condition, true, true);
 		g_gui.DestroyLoadBar();
 
 		wxString msg;
@@ -1344,7 +1348,7 @@ void MainMenuBar::OnMapRemoveItems(wxCommandEvent& WXUNUSED(event)) {
 		OnMapRemoveItems::RemoveItemCondition condition(itemid);
 		g_gui.CreateLoadBar("Searching map for items to remove...");
 
-		int64_t count = RemoveItemOnMap(g_gui.GetCurrentMap(), condition, false);
+		int64_t count = RemoveItemOnMap(g_gui.GetCurrentMap(), condition, false, true);
 
 		g_gui.DestroyLoadBar();
 
@@ -1362,11 +1366,7 @@ namespace OnMapRemoveCorpses {
 	struct condition {
 		condition() { }
 
-		bool operator()(Map& map, Item* item, long long removed, long long done) {
-			if (done % 0x800 == 0) {
-				g_gui.SetLoadDone((unsigned int)(100 * done / map.getTileCount()));
-			}
-
+		bool operator()(Map& map, Item* item) const {
 			return g_materials.isInTileset(item, "Corpses") & !item->isComplex();
 		}
 	};
@@ -1386,7 +1386,7 @@ void MainMenuBar::OnMapRemoveCorpses(wxCommandEvent& WXUNUSED(event)) {
 		OnMapRemoveCorpses::condition func;
 		g_gui.CreateLoadBar("Searching map for items to remove...");
 
-		int64_t count = RemoveItemOnMap(g_gui.GetCurrentMap(), func, false);
+		int64_t count = RemoveItemOnMap(g_gui.GetCurrentMap(), func, false, true);
 
 		g_gui.DestroyLoadBar();
 
@@ -1398,51 +1398,152 @@ void MainMenuBar::OnMapRemoveCorpses(wxCommandEvent& WXUNUSED(event)) {
 }
 
 namespace OnMapRemoveUnreachable {
+	// A tile is unreachable when there is no walkable tile within 10 tiles
+	// horizontally and 8 tiles vertically of it, on floors 0 to 9 for tiles
+	// above ground or 2 floors up or down underground. Instead of looking at
+	// every tile in that window, the walkable tiles of the floors around each
+	// 256x256 block are counted with a summed-area table once, which answers
+	// the question for all tiles of the block.
 	struct condition {
-		condition() { }
-
-		bool isReachable(Tile* tile) {
-			if (tile == nullptr) {
-				return false;
-			}
-			if (!tile->isBlocking()) {
-				return true;
+		enum {
+			BLOCK_SIZE = 256,
+			RANGE_X = 10,
+			RANGE_Y = 8,
+			GRID_WIDTH = BLOCK_SIZE + 2 * RANGE_X,
+			GRID_HEIGHT = BLOCK_SIZE + 2 * RANGE_Y,
+		};
+
+		// One bit per tile of a block
+		typedef std::vector<uint64_t> BlockBits;
+
+		condition(Map& map) {
+			map.loadAllAreas();
+
+			// Which tiles are walkable, and which blocks need an answer
+			std::unordered_map<uint32_t, BlockBits> walkable;
+			std::set<uint32_t> needed;
+			for (TileLocation* tileLocation : map) {
+				Tile* tile = tileLocation->get();
+				const Position& pos = tile->getPosition();
+				needed.insert(getBlockKey(getFloorGroup(pos.z), pos.x, pos.y));
+				if (!tile->isBlocking()) {
+					BlockBits& bits = walkable[getBlockKey(pos.z, pos.x, pos.y)];
+					if (bits.empty()) {
+						bits.resize(BLOCK_SIZE * BLOCK_SIZE / 64);
+					}
+					setBit(bits, pos.x, pos.y);
+				}
 			}
-			return false;
+
+			const std::vector<uint32_t> blocks(needed.begin(), needed.end());
+			std::vector<BlockBits> results(blocks.size());
+			runOrderedJobs(
+				blocks.size(), g_settings.getInteger(Config::WORKER_THREADS),
+				[&](size_t index) {
+					results[index] = findReachable(walkable, blocks[index]);
+				},
+				[&](size_t index) {
+					reachable[blocks[index]] = std::move(results[index]);
+				}
+			);
 		}
 
-		bool operator()(Map& map, Tile* tile, long long removed, long long done, long long total) {
-			if (done % 0x1000 == 0) {
-				g_gui.SetLoadDone((unsigned int)(100 * done / total));
-			}
+		// All floors above ground look at the same floors
+		static int getFloorGroup(int z) {
+			return std::max(z, GROUND_LAYER);
+		}
+		static uint32_t getBlockKey(int z, int x, int y) {
+			return uint32_t(z) << 16 | (uint32_t(x) / BLOCK_SIZE) << 8 | (uint32_t(y) / BLOCK_SIZE);
+		}
+		static bool testBit(const BlockBits& bits, int x, int y) {
+			const uint32_t index = uint32_t(y % BLOCK_SIZE) * BLOCK_SIZE + uint32_t(x % BLOCK_SIZE);
+			return (bits[index / 64] >> (index % 64)) & 1;
+		}
+		static void setBit(BlockBits& bits, int x, int y) {
+			const uint32_t index = uint32_t(y % BLOCK_SIZE) * BLOCK_SIZE + uint32_t(x % BLOCK_SIZE);
+			bits[index / 64] |= uint64_t(1) << (index % 64);
+		}
 
-			Position pos = tile->getPosition();
-			int sx = std::max(pos.x - 10, 0);
-			int ex = std::min(pos.x + 10, 65535);
-			int sy = std::max(pos.y - 8, 0);
-			int ey = std::min(pos.y + 8, 65535);
-			int sz, ez;
+		// Which tiles of a block have a walkable tile in reach
+		static BlockBits findReachable(const std::unordered_map<uint32_t, BlockBits>& walkable, uint32_t key) {
+			const int z = key >> 16;
+			const int block_x = (key >> 8) & 0xFF;
+			const int block_y = key & 0xFF;
+			const int origin_x = block_x * BLOCK_SIZE - RANGE_X;
+			const int origin_y = block_y * BLOCK_SIZE - RANGE_Y;
 
-			if (pos.z <= GROUND_LAYER) {
+			int sz, ez;
+			if (z <= GROUND_LAYER) {
 				sz = 0;
 				ez = 9;
 			} else {
 				// underground
-				sz = std::max(pos.z - 2, GROUND_LAYER);
-				ez = std::min(pos.z + 2, MAP_MAX_LAYER);
+				sz = std::max(z - 2, GROUND_LAYER);
+				ez = std::min(z + 2, MAP_MAX_LAYER);
 			}
 
-			for (int z = sz; z <= ez; ++z) {
-				for (int y = sy; y <= ey; ++y) {
-					for (int x = sx; x <= ex; ++x) {
-						if (isReachable(map.getTile(x, y, z))) {
-							return false;
+			// Walkable tiles on any of the floors, around the block
+			std::vector<uint8_t> grid(GRID_WIDTH * GRID_HEIGHT, 0);
+			for (int floor = sz; floor <= ez; ++floor) {
+				for (int nx = block_x - 1; nx <= block_x + 1; ++nx) {
+					for (int ny = block_y - 1; ny <= block_y + 1; ++ny) {
+						if (nx < 0 || ny < 0 || nx >= 65536 / BLOCK_SIZE || ny >= 65536 / BLOCK_SIZE) {
+							continue;
+						}
+
+						auto it = walkable.find(getBlockKey(floor, nx * BLOCK_SIZE, ny * BLOCK_SIZE));
+						if (it == walkable.end()) {
+							continue;
+						}
+
+						const int sx = std::max(nx * BLOCK_SIZE, origin_x);
+						const int ex = std::min(nx * BLOCK_SIZE + BLOCK_SIZE, origin_x + GRID_WIDTH);
+						const int sy = std::max(ny * BLOCK_SIZE, origin_y);
+						const int ey = std::min(ny * BLOCK_SIZE + BLOCK_SIZE, origin_y + GRID_HEIGHT);
+						for (int y = sy; y < ey; ++y) {
+							for (int x = sx; x < ex; ++x) {
+								if (testBit(it->second, x, y)) {
+									grid[(y - origin_y) * GRID_WIDTH + (x - origin_x)] = 1;
+								}
+							}
 						}
 					}
 				}
 			}
-			return true;
+
+			// sums[y][x] is the number of walkable tiles above and left of (x, y)
+			const int stride = GRID_WIDTH + 1;
+			std::vector<uint32_t> sums(stride * (GRID_HEIGHT + 1), 0);
+			for (int y = 0; y < GRID_HEIGHT; ++y) {
+				uint32_t row = 0;
+				for (int x = 0; x < GRID_WIDTH; ++x) {
+					row += grid[y * GRID_WIDTH + x];
+					sums[(y + 1) * stride + x + 1] = sums[y * stride + x + 1] + row;
+				}
+			}
+
+			BlockBits bits(BLOCK_SIZE * BLOCK_SIZE / 64, 0);
+			for (int y = 0; y < BLOCK_SIZE; ++y) {
+				// Grid rows y to y + 2 * RANGE_Y, columns x to x + 2 * RANGE_X
+				const uint32_t* top = &sums[y * stride];
+				const uint32_t* bottom = &sums[(y + 2 * RANGE_Y + 1) * stride];
+				for (int x = 0; x < BLOCK_SIZE; ++x) {
+					const uint32_t count = bottom[x + 2 * RANGE_X + 1] - bottom[x] - top[x + 2 * RANGE_X + 1] + top[x];
+					if (count != 0) {
+						setBit(bits, x, y);
+					}
+				}
+			}
+			return bits;
+		}
+
+		bool operator()(Map& map, Tile* tile) const {
+			const Position& pos = tile->getPosition();
+			auto it = reachable.find(getBlockKey(getFloorGroup(pos.z), pos.x, pos.y));
+			return it == reachable.end() || !testBit(it->second, pos.x, pos.y);
 		}
+
+		std::unordered_map<uint32_t, BlockBits> reachable;
 	};
 }
 
@@ -1457,10 +1558,10 @@ void MainMenuBar::OnMapRemoveUnreachable(wxCommandEvent& WXUNUSED(event)) {
 		g_gui.GetCurrentEditor()->selection.clear();
 		g_gui.GetCurrentEditor()->actionQueue->clear();
 
-		OnMapRemoveUnreachable::condition func;
 		g_gui.CreateLoadBar("Searching map for tiles to remove...");
+		OnMapRemoveUnreachable::condition func(g_gui.GetCurrentMap());
 
-		long long removed = remove_if_TileOnMap(g_gui.GetCurrentMap(), func);
+		long long removed = remove_if_TileOnMap(g_gui.GetCurrentMap(), func, true);
 
 		g_gui.DestroyLoadBar();
 
@@ -1549,33 +1650,143 @@ void MainMenuBar::OnMapEditMonsters(wxCommandEvent& WXUNUSED(event)) {
 	;
 }
 
+namespace OnMapStatistics {
+	struct TileCounter {
+		uint64_t tile_count = 0;
+		uint64_t detailed_tile_count = 0;
+		uint64_t blocking_tile_count = 0;
+		uint64_t walkable_tile_count = 0;
+		uint64_t spawn_count = 0;
+		uint64_t creature_count = 0;
+
+		uint64_t item_count = 0;
+		uint64_t loose_item_count = 0;
+		uint64_t depot_count = 0;
+		uint64_t action_item_count = 0;
+		uint64_t unique_item_count = 0;
+		uint64_t container_count = 0; // Only includes containers containing more than 1 item
+
+		// Returns true if the item is anything but ground or border
+		bool addItem(Item* item) {
+			item_count += 1;
+			if (item->isGroundTile() || item->isBorder()) {
+				return false;
+			}
+
+			const ItemType& it = g_items[item->getID()];
+			if (it.moveable) {
+				loose_item_count += 1;
+			}
+			if (it.isDepot()) {
+				depot_count += 1;
+			}
+			if (item->getActionID() > 0) {
+				action_item_count += 1;
+			}
+			if (item->getUniqueID() > 0) {
+				unique_item_count += 1;
+			}
+			if (Container* c = dynamic_cast<Container*>(item)) {
+				if (c->getVector().size()) {
+					container_count += 1;
+				}
+			}
+			return true;
+		}
+
+		void add(Tile* tile) {
+			if (tile->empty()) {
+				return;
+			}
+
+			tile_count += 1;
+
+			bool is_detailed = false;
+			if (tile->ground) {
+				is_detailed |= addItem(tile->ground);
+			}
+			for (Item* item : tile->items) {
+				is_detailed |= addItem(item);
+			}
+
+			if (tile->spawn) {
+				spawn_count += 1;
+			}
+
+			if (tile->creature) {
+				creature_count += 1;
+			}
+
+			if (tile->isBlocking()) {
+				blocking_tile_count += 1;
+			} else {
+				walkable_tile_count += 1;
+			}
+
+			if (is_detailed) {
+				detailed_tile_count += 1;
+			}
+		}
+
+		void merge(const TileCounter& other) {
+			tile_count += other.tile_count;
+			detailed_tile_count += other.detailed_tile_count;
+			blocking_tile_count += other.blocking_tile_count;
+			walkable_tile_count += other.walkable_tile_count;
+			spawn_count += other.spawn_count;
+			creature_count += other.creature_count;
+			item_count += other.item_count;
+			loose_item_count += other.loose_item_count;
+			depot_count += other.depot_count;
+			action_item_count += other.action_item_count;
+			unique_item_count += other.unique_item_count;
+			container_count += other.container_count;
+		}
+	};
+}
+
 void MainMenuBar::OnMapStatistics(wxCommandEvent& WXUNUSED(event)) {
 	if (!g_gui.IsEditorOpen()) {
 		return;
 	}
 
+	Map* map = &g_gui.GetCurrentMap();
+	map->loadAllAreas(true);
+
 	g_gui.CreateLoadBar("Collecting data...");
 
-	Map* map = &g_gui.GetCurrentMap();
+	// Tiles are counted on the worker threads, every batch into its own slot
+	std::vector<OnMapStatistics::TileCounter> counters(getTileBatchSlotCount());
+	OnMapStatistics::TileCounter total;
+	foreach_TileBatchOnMap(
+		*map, false, true,
+		[&counters](size_t slot, Tile* tile, long long) {
+			counters[slot].add(tile);
+		},
+		[&total, &counters](size_t slot) {
+			total.merge(counters[slot]);
+			counters[slot] = OnMapStatistics::TileCounter();
+		}
+	);
 
 	int load_counter = 0;
 
-	uint64_t tile_count = 0;
-	uint64_t detailed_tile_count = 0;
-	uint64_t blocking_tile_count = 0;
-	uint64_t walkable_tile_count = 0;
+	uint64_t tile_count = total.tile_count;
+	uint64_t detailed_tile_count = total.detailed_tile_count;
+	uint64_t blocking_tile_count = total.blocking_tile_count;
+	uint64_t walkable_tile_count = total.walkable_tile_count;
 	double percent_pathable = 0.0;
 	double percent_detailed = 0.0;
-	uint64_t spawn_count = 0;
-	uint64_t creature_count = 0;
+	uint64_t spawn_count = total.spawn_count;
+	uint64_t creature_count = total.creature_count;
 	double creatures_per_spawn = 0.0;
 
-	uint64_t item_count = 0;
-	uint64_t loose_item_count = 0;
-	uint64_t depot_count = 0;
-	uint64_t action_item_count = 0;
-	uint64_t unique_item_count = 0;
-	uint64_t container_count = 0; // Only includes containers containing more than 1 item
+	uint64_t item_count = total.item_count;
+	uint64_t loose_item_count = total.loose_item_count;
+	uint64_t depot_count = total.depot_count;
+	uint64_t action_item_count = total.action_item_count;
+	uint64_t unique_item_count = total.unique_item_count;
+	uint64_t container_count = total.container_count;
 
 	int town_count = map->towns.count();
 	int house_count = map->houses.count();
@@ -1589,76 +1800,6 @@ void MainMenuBar::OnMapStatistics(wxCommandEvent& WXUNUSED(event)) {
 	double sqm_per_house = 0.0;
 	double sqm_per_town = 0.0;
 
-	for (MapIterator mit = map->begin(); mit != map->end(); ++mit) {
-		Tile* tile = (*mit)->get();
-		if (load_counter % 8192 == 0) {
-			g_gui.SetLoadDone((unsigned int)(int64_t(load_counter) * 95ll / int64_t(map->getTileCount())));
-		}
-
-		if (tile->empty()) {
-			continue;
-		}
-
-		tile_count += 1;
-
-		bool is_detailed = false;
-#define ANALYZE_ITEM(_item)                                         \
-	{                                                               \
-		item_count += 1;                                            \
-		if (!(_item)->isGroundTile() && !(_item)->isBorder()) {     \
-			is_detailed = true;                                     \
-			ItemType& it = g_items[(_item)->getID()];               \
-			if (it.moveable) {                                      \
-				loose_item_count += 1;                              \
-			}                                                       \
-			if (it.isDepot()) {                                     \
-				depot_count += 1;                                   \
-			}                                                       \
-			if ((_item)->getActionID() > 0) {                       \
-				action_item_count += 1;                             \
-			}                                                       \
-			if ((_item)->getUniqueID() > 0) {                       \
-				unique_item_count += 1;                             \
-			}                                                       \
-			if (Container* c = dynamic_cast<Container*>((_item))) { \
-				if (c->getVector().size()) {                        \
-					container_count += 1;                           \
-				}                                                   \
-			}                                                       \
-		}                                                           \
-	}
-
-		if (tile->ground) {
-			ANALYZE_ITEM(tile->ground);
-		}
-
-		for (ItemVector::const_iterator item_iter = tile->items.begin(); item_iter != tile->items.end(); ++item_iter) {
-			Item* item = *item_iter;
-			ANALYZE_ITEM(item);
-		}
-#undef ANALYZE_ITEM
-
-		if (tile->spawn) {
-			spawn_count += 1;
-		}
-
-		if (tile->creature) {
-			creature_count += 1;
-		}
-
-		if (tile->isBlocking()) {
-			blocking_tile_count += 1;
-		} else {
-			walkable_tile_count += 1;
-		}
-
-		if (is_detailed) {
-			detailed_tile_count += 1;
-		}
-
-		load_counter += 1;
-	}
-
 	creatures_per_spawn = (spawn_count != 0 ? double(creature_count) / double(spawn_count) : -1.0);
 	percent_pathable = 100.0 * (tile_count != 0 ? double(walkable_tile_count) / double(tile_count) : -1.0);
 	percent_detailed = 100.0 * (tile_count != 0 ? double(detailed_tile_count) / double(tile_count) : -1.0);
@@ -1754,6 +1895,19 @@ void MainMenuBar::OnMapStatistics(wxCommandEvent& WXUNUSED(event)) {
 		os << "\t\tLargest House: \"" << largest_house->name << "\" (" << largest_house_size << " sqm)\n";
 	}
 
+	os << "\tMemory data:\n";
+	auto describePool = [&os](const char* name, const MapObjectPool& pool) {
+		os << "\t\t" << name << ": " << pool.getLiveCount() << " live, "
+		   << pool.getLiveBytes() / 1024 << " KiB used, "
+		   << pool.getReservedBytes() / 1024 << " KiB reserved in " << pool.getSlabCount() << " slabs\n";
+	};
+	describePool("Tile pool (all maps)", MapAllocator::getTilePool());
+	describePool("Item pool (all maps)", MapAllocator::getItemPool());
+	describePool("Floor pool", map->allocator.getFloorPool());
+	describePool("Node pool", map->allocator.getNodePool());
+	os << "\t\tSave cache: " << map->area_cache.getBlockCount() << " areas, "
+	   << map->area_cache.getMemoryUsage() / 1024 << " KiB\n";
+
 	os << "\n";
 	os << "Generated by Remere's Map Editor version " + __RME_VERSION__ + "\n";
 
@@ -2144,7 +2298,25 @@ void MainMenuBar::SearchItems(bool unique, bool action, bool container, bool wri
 	searcher.search_container = container;
 	searcher.search_writeable = writable;
 
-	foreach_ItemOnMap(g_gui.GetCurrentMap(), searcher, onSelection);
+	Map& map = g_gui.GetCurrentMap();
+	if (onSelection) {
+		foreach_ItemOnMap(map, searcher, true, true);
+	} else {
+		std::vector<uint32_t> keys;
+		if (unique) {
+			keys.push_back(ItemIndex::makeKey(ItemIndex::ANY_UNIQUE));
+		}
+		if (action) {
+			keys.push_back(ItemIndex::makeKey(ItemIndex::ANY_ACTION));
+		}
+		if (container) {
+			keys.push_back(ItemIndex::makeKey(ItemIndex::ANY_CONTAINER));
+		}
+		if (writable) {
+			keys.push_back(ItemIndex::makeKey(ItemIndex::ANY_TEXT));
+		}
+		searcher.found = map.item_index.find(map, keys, 0, true);
+	}
 	searcher.sort();
 	std::vector<std::pair<Tile*, Item*>>& found = searcher.found;
 
@@ -18,12 +18,55 @@
 #include "main.h"
 
 #include "gui.h" // loadbar
+#include "settings.h"
 #include "lua/lua_script_manager.h"
 
 #include "map.h"
+#include "iomap_otbm.h"
 
 #include <sstream>
 
+//**************** SavedAreaCache **********************
+
+SavedAreaCache::SavedAreaCache() :
+	memory_usage(0),
+	version(MAP_OTBM_UNKNOWN, CLIENT_VERSION_NONE),
+	items_major(0),
+	items_minor(0) {
+	////
+}
+
+void SavedAreaCache::clear() {
+	blocks.clear();
+	memory_usage = 0;
+}
+
+void SavedAreaCache::validate(const MapVersion& version, uint32_t items_major, uint32_t items_minor) {
+	if (this->version.otbm != version.otbm || this->version.client != version.client || this->items_major != items_major || this->items_minor != items_minor) {
+		clear();
+		this->version = version;
+		this->items_major = items_major;
+		this->items_minor = items_minor;
+	}
+}
+
+void SavedAreaCache::erase(uint32_t key) {
+	auto it = blocks.find(key);
+	if (it != blocks.end()) {
+		memory_usage -= it->second.size();
+		blocks.erase(it);
+	}
+}
+
+void SavedAreaCache::set(uint32_t key, std::string&& blob) {
+	std::string& entry = blocks[key];
+	memory_usage -= entry.size();
+	entry = std::move(blob);
+	memory_usage += entry.size();
+}
+
+//**************** Map **********************
+
 Map::Map() :
 	BaseMap(),
 	width(512),
@@ -42,6 +85,56 @@ Map::~Map() {
 	////
 }
 
+void Map::loadAreas(int start_x, int start_y, int end_x, int end_y) {
+	if (!area_source) {
+		return;
+	}
+
+	if (start_x > end_x) {
+		std::swap(start_x, end_x);
+	}
+	if (start_y > end_y) {
+		std::swap(start_y, end_y);
+	}
+	start_x = std::max(start_x, 0) >> 8;
+	start_y = std::max(start_y, 0) >> 8;
+	end_x = std::min(end_x, MAP_MAX_WIDTH) >> 8;
+	end_y = std::min(end_y, MAP_MAX_HEIGHT) >> 8;
+
+	std::vector<uint32_t> keys;
+	for (int block_x = start_x; block_x <= end_x; ++block_x) {
+		for (int block_y = start_y; block_y <= end_y; ++block_y) {
+			const uint32_t key = SavedAreaCache::getBlockKey(block_x << 8, block_y << 8);
+			if (area_source->isPending(key)) {
+				keys.push_back(key);
+			}
+		}
+	}
+	if (keys.empty()) {
+		return;
+	}
+
+	area_source->load(*this, keys);
+	if (area_source->getPendingCount() == 0) {
+		area_source.reset();
+	}
+}
+
+void Map::loadAllAreas(bool showdialog) {
+	if (!area_source) {
+		return;
+	}
+
+	if (showdialog) {
+		g_gui.CreateLoadBar("Loading map areas...");
+	}
+	area_source->load(*this, area_source->getPendingBlocks(), showdialog);
+	area_source.reset();
+	if (showdialog) {
+		g_gui.DestroyLoadBar();
+	}
+}
+
 bool Map::open(const std::string file) {
 	if (file == filename) {
 		return true; // Do not reopen ourselves!
@@ -141,14 +234,21 @@ bool Map::convert(MapVersion to, bool showdialog) {
 		convert(getReplacementMapFrom854To854(), showdialog);
 	*/
 	mapVersion = to;
+	area_cache.clear();
+	item_index.clear();
+	invalidateTiles();
 
 	return true;
 }
 
 bool Map::convert(const ConversionMap& rm, bool showdialog) {
+	loadAllAreas(showdialog);
 	if (showdialog) {
 		g_gui.CreateLoadBar("Converting map ...");
 	}
+	area_cache.clear();
+	item_index.clear();
+	invalidateTiles();
 
 	uint64_t tiles_done = 0;
 	std::vector<uint16_t> id_list;
@@ -279,6 +379,7 @@ bool Map::convert(const ConversionMap& rm, bool showdialog) {
 }
 
 void Map::cleanInvalidTiles(bool showdialog) {
+	loadAllAreas(showdialog);
 	if (showdialog) {
 		g_gui.CreateLoadBar("Removing invalid tiles...");
 	}
@@ -299,6 +400,9 @@ void Map::cleanInvalidTiles(bool showdialog) {
 			} else {
 				delete *item_iter;
 				item_iter = tile->items.erase(item_iter);
+				tile->getLocation()->touch();
+				area_cache.markDirty(tile->getPosition());
+				item_index.markDirty(tile->getPosition());
 			}
 		}
 
@@ -314,6 +418,7 @@ void Map::cleanInvalidTiles(bool showdialog) {
 }
 
 void Map::convertHouseTiles(uint32_t fromId, uint32_t toId) {
+	loadAllAreas(true);
 	g_gui.CreateLoadBar("Converting house tiles...");
 	uint64_t tiles_done = 0;
 
@@ -327,6 +432,8 @@ void Map::convertHouseTiles(uint32_t fromId, uint32_t toId) {
 		}
 
 		tile->setHouseID(toId);
+		tile->getLocation()->touch();
+		area_cache.markDirty(tile->getPosition());
 		++tiles_done;
 		if (tiles_done % 0x10000 == 0) {
 			g_gui.SetLoadDone(int(tiles_done / double(getTileCount()) * 100.0));
@@ -499,6 +606,8 @@ bool Map::exportMinimap(FileName filename, int floor /*= GROUND_LAYER*/, bool di
 		int min_x = 0x10000, min_y = 0x10000;
 		int max_x = 0x00000, max_y = 0x00000;
 
+		loadAllAreas(displaydialog);
+
 		if (size() == 0) {
 			return true;
 		}
@@ -644,3 +753,61 @@ bool Map::exportMinimap(FileName filename, int floor /*= GROUND_LAYER*/, bool di
 
 	return true;
 }
+
+//**************** Map traversal **********************
+
+size_t getTileBatchSlotCount() {
+	return size_t(std::max(g_settings.getInteger(Config::WORKER_THREADS), 1)) * 4;
+}
+
+void foreach_TileBatchOnMap(Map& map, bool selectedTiles, bool showdialog, const std::function<void(size_t, Tile*, long long)>& process, const std::function<void(size_t)>& finish) {
+	struct TileBatch {
+		// Tiles and how many tiles a serial walk has passed at each of them
+		std::vector<std::pair<Tile*, long long>> tiles;
+		long long done = 0;
+	};
+
+	const size_t batch_size = 4096;
+	const int thread_count = std::max(g_settings.getInteger(Config::WORKER_THREADS), 1);
+	std::vector<TileBatch> batches(getTileBatchSlotCount());
+
+	auto processBatch = [&batches, &process](size_t slot) {
+		for (const auto& entry : batches[slot].tiles) {
+			process(slot, entry.first, entry.second);
+		}
+	};
+	auto finishBatch = [&](size_t slot) {
+		if (finish) {
+			finish(slot);
+		}
+		batches[slot].tiles.clear();
+		if (showdialog) {
+			g_gui.SetLoadDone(static_cast<int32_t>(batches[slot].done / double(map.getTileCount()) * 100.0));
+		}
+	};
+
+	OrderedJobPipeline pipeline(thread_count, batches.size(), processBatch, finishBatch);
+	size_t slot = pipeline.acquire();
+	long long done = 0;
+	for (TileLocation* tileLocation : map) {
+		Tile* tile = tileLocation->get();
+		ASSERT(tile);
+
+		++done;
+		if (selectedTiles && !tile->isSelected()) {
+			continue;
+		}
+
+		batches[slot].tiles.emplace_back(tile, done);
+		if (batches[slot].tiles.size() == batch_size) {
+			batches[slot].done = done;
+			pipeline.submit();
+			slot = pipeline.acquire();
+		}
+	}
+	if (!batches[slot].tiles.empty()) {
+		batches[slot].done = done;
+		pipeline.submit();
+	}
+	pipeline.flush();
+}
@@ -26,6 +26,61 @@
 #include "complexitem.h"
 #include "waypoints.h"
 #include "templates.h"
+#include "item_index.h"
+
+#include <unordered_map>
+
+class OTBMAreaSource;
+
+// Tile areas encoded by the last save, one blob per 256x256 block with all of
+// its floors. A block is dropped as soon as one of its tiles changes, so the
+// next save only has to encode the blocks that were edited.
+class SavedAreaCache {
+public:
+	SavedAreaCache();
+
+	static uint32_t getBlockKey(int x, int y) {
+		return ((uint32_t(x) >> 8) & 0xFF) << 8 | ((uint32_t(y) >> 8) & 0xFF);
+	}
+
+	// Must be called whenever a tile is changed outside of the action queue
+	void markDirty(int x, int y) {
+		if (!blocks.empty()) {
+			erase(getBlockKey(x, y));
+		}
+	}
+	void markDirty(const Position& pos) {
+		markDirty(pos.x, pos.y);
+	}
+	// For changes that may touch any tile
+	void clear();
+
+	// Blobs are only valid for the format they were encoded with
+	void validate(const MapVersion& version, uint32_t items_major, uint32_t items_minor);
+
+	const std::string* get(uint32_t key) const {
+		auto it = blocks.find(key);
+		return it == blocks.end() ? nullptr : &it->second;
+	}
+	void set(uint32_t key, std::string&& blob);
+
+	size_t getBlockCount() const {
+		return blocks.size();
+	}
+	size_t getMemoryUsage() const {
+		return memory_usage;
+	}
+
+private:
+	void erase(uint32_t key);
+
+	std::unordered_map<uint32_t, std::string> blocks;
+	size_t memory_usage;
+
+	MapVersion version;
+	uint32_t items_major;
+	uint32_t items_minor;
+};
 
 class Map : public BaseMap {
 public:
@@ -37,6 +92,20 @@ public:
 	void cleanInvalidTiles(bool showdialog = false);
 	void convertHouseTiles(uint32_t fromId, uint32_t toId);
 
+	// Lazily opened maps leave their tile areas in the file until they are
+	// used, these have to be called before touching tiles that may not be
+	// loaded yet. Operations on the entire map need all of them.
+	bool hasPendingAreas() const {
+		return area_source != nullptr;
+	}
+	void loadArea(const Position& pos) {
+		if (area_source) {
+			loadAreas(pos.x, pos.y, pos.x, pos.y);
+		}
+	}
+	void loadAreas(int start_x, int start_y, int end_x, int end_y);
+	void loadAllAreas(bool showdialog = false);
+
 	// Save a bmp image of the minimap
 	bool exportMinimap(FileName filename, int floor = GROUND_LAYER, bool showdialog = false);
 	//
@@ -152,7 +221,12 @@ public:
 	Houses houses;
 	Spawns spawns;
 
+	SavedAreaCache area_cache;
+	ItemIndex item_index;
+
 protected:
+	std::unique_ptr<OTBMAreaSource> area_source;
+
 	bool has_changed; // If the map has changed
 	bool unnamed; // If the map has yet to receive a name
 
@@ -164,56 +238,74 @@ public:
 	Waypoints waypoints;
 };
 
-template <typename ForeachType>
-inline void foreach_ItemOnMap(Map& map, ForeachType& foreach, bool selectedTiles) {
-	MapIterator tileiter = map.begin();
-	MapIterator end = map.end();
-	long long done = 0;
-
-	while (tileiter != end) {
-		++done;
-		Tile* tile = (*tileiter)->get();
-		if (selectedTiles && !tile->isSelected()) {
-			++tileiter;
-			continue;
-		}
+// Number of tile batches foreach_TileBatchOnMap has in flight at once, the
+// results gathered per batch need this many slots
+size_t getTileBatchSlotCount();
+
+// Calls process(slot, tile, done) for every tile of the map, or only for the
+// selected ones, on the worker threads. done is the number of tiles a serial
+// walk would have passed by then. Tiles are handed out in batches of tiles
+// that are next to each other, and finish(slot) is called on the calling
+// thread for every batch in map order, so what process gathered for a slot
+// can be merged there in the order a serial walk would have found it.
+// process must only change the tile it is given.
+void foreach_TileBatchOnMap(Map& map, bool selectedTiles, bool showdialog, const std::function<void(size_t, Tile*, long long)>& process, const std::function<void(size_t)>& finish);
+
+// Calls callback for the ground, the items and the contents of containers on
+// a tile, containers are searched breadth first
+template <typename ItemCallback>
+inline void foreach_ItemOnTile(Tile* tile, ItemCallback&& callback) {
+	if (tile->ground) {
+		callback(tile->ground);
+	}
 
-		if (tile->ground) {
-			foreach (map, tile, tile->ground, done)
-				;
+	std::queue<Container*> containers;
+	for (Item* item : tile->items) {
+		callback(item);
+		if (Container* container = dynamic_cast<Container*>(item)) {
+			containers.push(container);
 		}
-
-		std::queue<Container*> containers;
-		for (ItemVector::iterator itemiter = tile->items.begin(); itemiter != tile->items.end(); ++itemiter) {
-			Item* item = *itemiter;
-			Container* container = dynamic_cast<Container*>(item);
-			foreach (map, tile, item, done)
-				;
-			if (container) {
-				containers.push(container);
-
-				do {
-					container = containers.front();
-					ItemVector& v = container->getVector();
-					for (ItemVector::iterator containeriter = v.begin(); containeriter != v.end(); ++containeriter) {
-						Item* i = *containeriter;
-						Container* c = dynamic_cast<Container*>(i);
-						foreach (map, tile, i, done)
-							;
-						if (c) {
-							containers.push(c);
-						}
-					}
-					containers.pop();
-				} while (containers.size());
+		while (!containers.empty()) {
+			for (Item* inner : containers.front()->getVector()) {
+				callback(inner);
+				if (Container* container = dynamic_cast<Container*>(inner)) {
+					containers.push(container);
+				}
 			}
+			containers.pop();
 		}
-		++tileiter;
 	}
 }
 
+// Calls foreach(map, tile, item, done) for every item on the map, or on the
+// selected tiles, on the worker threads. Every batch of tiles is searched by
+// its own copy of foreach, and the copies are folded back in map order with
+// foreach.merge(copy), which gives the same results as a serial walk.
+template <typename ForeachType>
+inline void foreach_ItemOnMap(Map& map, ForeachType& foreach, bool selectedTiles, bool showdialog = false) {
+	if (!selectedTiles) {
+		map.loadAllAreas();
+	}
+
+	const ForeachType blank(foreach);
+	std::vector<ForeachType> visitors(getTileBatchSlotCount(), blank);
+	foreach_TileBatchOnMap(
+		map, selectedTiles, showdialog,
+		[&map, &visitors](size_t slot, Tile* tile, long long done) {
+			foreach_ItemOnTile(tile, [&](Item* item) {
+				visitors[slot](map, tile, item, done);
+			});
+		},
+		[&foreach, &visitors, &blank](size_t slot) {
+			foreach.merge(visitors[slot]);
+			visitors[slot] = blank;
+		}
+	);
+}
+
 template <typename ForeachType>
 inline void foreach_TileOnMap(Map& map, ForeachType& foreach) {
+	map.loadAllAreas();
 	MapIterator tileiter = map.begin();
 	MapIterator end = map.end();
 	long long done = 0;
@@ -224,64 +316,85 @@ inline void foreach_TileOnMap(Map& map, ForeachType& foreach) {
 	}
 }
 
+// Removes every tile of the map that remove_if(map, tile) holds for. Tiles
+// are checked on the worker threads against the map as it was before, and
+// removed afterwards in map order, remove_if must not change anything.
 template <typename RemoveIfType>
-inline long long remove_if_TileOnMap(Map& map, RemoveIfType& remove_if) {
-	MapIterator tileiter = map.begin();
-	MapIterator end = map.end();
-	long long done = 0;
-	long long removed = 0;
-	long long total = map.getTileCount();
-
-	while (tileiter != end) {
-		Tile* tile = (*tileiter)->get();
-		if (remove_if(map, tile, removed, done, total)) {
-			map.setTile(tile->getPosition(), nullptr, true);
-			++removed;
+inline long long remove_if_TileOnMap(Map& map, RemoveIfType& remove_if, bool showdialog = false) {
+	map.loadAllAreas();
+
+	std::vector<std::vector<Position>> matches(getTileBatchSlotCount());
+	std::vector<Position> found;
+	foreach_TileBatchOnMap(
+		map, false, showdialog,
+		[&map, &remove_if, &matches](size_t slot, Tile* tile, long long) {
+			if (remove_if(map, tile)) {
+				matches[slot].push_back(tile->getPosition());
+			}
+		},
+		[&found, &matches](size_t slot) {
+			found.insert(found.end(), matches[slot].begin(), matches[slot].end());
+			matches[slot].clear();
 		}
-		++tileiter;
-		++done;
-	}
+	);
 
-	return removed;
+	for (const Position& pos : found) {
+		map.area_cache.markDirty(pos);
+		map.item_index.markDirty(pos);
+		map.setTile(pos, nullptr, true);
+	}
+	return found.size();
 }
 
+// Removes the grounds and items, but not the contents of containers, on the
+// map or on the selected tiles that condition(map, item) holds for. Items are
+// checked on the worker threads and removed afterwards in map order,
+// condition must not change anything.
 template <typename RemoveIfType>
-inline int64_t RemoveItemOnMap(Map& map, RemoveIfType& condition, bool selectedOnly) {
-	int64_t done = 0;
-	int64_t removed = 0;
-
-	MapIterator it = map.begin();
-	MapIterator end = map.end();
-
-	while (it != end) {
-		++done;
-		Tile* tile = (*it)->get();
-		if (selectedOnly && !tile->isSelected()) {
-			++it;
-			continue;
-		}
+inline int64_t RemoveItemOnMap(Map& map, RemoveIfType& condition, bool selectedOnly, bool showdialog = false) {
+	if (!selectedOnly) {
+		map.loadAllAreas();
+	}
 
-		if (tile->ground) {
-			if (condition(map, tile->ground, removed, done)) {
-				delete tile->ground;
-				tile->ground = nullptr;
-				++removed;
+	std::vector<std::vector<std::pair<Tile*, Item*>>> matches(getTileBatchSlotCount());
+	std::vector<std::pair<Tile*, Item*>> found;
+	foreach_TileBatchOnMap(
+		map, selectedOnly, showdialog,
+		[&map, &condition, &matches](size_t slot, Tile* tile, long long) {
+			if (tile->ground && condition(map, tile->ground)) {
+				matches[slot].emplace_back(tile, tile->ground);
 			}
+			for (Item* item : tile->items) {
+				if (condition(map, item)) {
+					matches[slot].emplace_back(tile, item);
+				}
+			}
+		},
+		[&found, &matches](size_t slot) {
+			found.insert(found.end(), matches[slot].begin(), matches[slot].end());
+			matches[slot].clear();
+		}
+	);
+
+	Tile* changed = nullptr;
+	for (const auto& match : found) {
+		Tile* tile = match.first;
+		Item* item = match.second;
+		if (item == tile->ground) {
+			tile->ground = nullptr;
+		} else {
+			tile->items.erase(std::find(tile->items.begin(), tile->items.end(), item));
 		}
+		delete item;
 
-		for (auto iit = tile->items.begin(); iit != tile->items.end();) {
-			Item* item = *iit;
-			if (condition(map, item, removed, done)) {
-				iit = tile->items.erase(iit);
-				delete item;
-				++removed;
-			} else {
-				++iit;
-			}
+		if (tile != changed) {
+			tile->getLocation()->touch();
+			map.area_cache.markDirty(tile->getPosition());
+			map.item_index.markDirty(tile->getPosition());
+			changed = tile;
 		}
-		++it;
 	}
-	return removed;
+	return found.size();
 }
 
 #endif
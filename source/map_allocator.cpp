@@ -0,0 +1,353 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "map_allocator.h"
+#include "basemap.h"
+
+#include <atomic>
+
+namespace {
+	const size_t FIRST_SLAB_OBJECTS = 16;
+	const size_t MAX_SLAB_BYTES = 256 * 1024;
+	// Objects moved between a thread cache and the shared free-list at once,
+	// a cache holds at most twice as many
+	const size_t CACHE_BATCH = 64;
+
+	std::atomic<int> next_cache_index(0);
+}
+
+thread_local MapObjectPool::ThreadCaches MapObjectPool::thread_caches;
+
+MapObjectPool::ThreadCaches::~ThreadCaches() {
+	for (ThreadCache& cache : caches) {
+		if (cache.pool) {
+			cache.pool->flush(cache, cache.count);
+		}
+	}
+}
+
+//**************** MapObjectPool **********************
+
+MapObjectPool::MapObjectPool(size_t size, size_t align, bool thread_caches) :
+	object_size(0),
+	next_slab_count(FIRST_SLAB_OBJECTS),
+	max_slab_count(FIRST_SLAB_OBJECTS),
+	free_list(nullptr),
+	free_count(0),
+	freed_since_trim(0),
+	bump(nullptr),
+	bump_end(nullptr),
+	reserved_count(0),
+	live_count(0),
+	cache_index(-1) {
+	if (thread_caches) {
+		const int index = next_cache_index++;
+		if (index < int(sizeof(ThreadCaches::caches) / sizeof(ThreadCache))) {
+			cache_index = index;
+		}
+	}
+	align = std::max(align, alignof(FreeNode));
+	size = std::max(size, sizeof(FreeNode));
+	object_size = (size + align - 1) / align * align;
+	max_slab_count = std::max(FIRST_SLAB_OBJECTS, MAX_SLAB_BYTES / object_size);
+}
+
+MapObjectPool::~MapObjectPool() {
+	releaseAll();
+}
+
+void* MapObjectPool::allocate() {
+	if (cache_index >= 0) {
+		ThreadCache& cache = thread_caches.caches[cache_index];
+		if (!cache.head) {
+			refill(cache);
+		}
+		FreeNode* node = cache.head;
+		cache.head = node->next;
+		--cache.count;
+		return node;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	++live_count;
+	if (free_list) {
+		FreeNode* node = free_list;
+		free_list = node->next;
+		--free_count;
+		return node;
+	}
+	if (bump == bump_end) {
+		addSlab();
+	}
+	void* ptr = bump;
+	bump += object_size;
+	return ptr;
+}
+
+void MapObjectPool::deallocate(void* ptr) {
+	if (!ptr) {
+		return;
+	}
+	if (cache_index >= 0) {
+		ThreadCache& cache = thread_caches.caches[cache_index];
+		FreeNode* node = reinterpret_cast<FreeNode*>(ptr);
+		node->next = cache.head;
+		cache.head = node;
+		if (++cache.count >= CACHE_BATCH * 2) {
+			flush(cache, CACHE_BATCH);
+		}
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	FreeNode* node = reinterpret_cast<FreeNode*>(ptr);
+	node->next = free_list;
+	free_list = node;
+	++free_count;
+	++freed_since_trim;
+	--live_count;
+}
+
+void MapObjectPool::refill(ThreadCache& cache) {
+	std::lock_guard<std::mutex> lock(mutex);
+	cache.pool = this;
+	for (size_t taken = 0; taken < CACHE_BATCH; ++taken) {
+		FreeNode* node = free_list;
+		if (node) {
+			free_list = node->next;
+			--free_count;
+		} else {
+			if (bump == bump_end) {
+				addSlab();
+			}
+			node = reinterpret_cast<FreeNode*>(bump);
+			bump += object_size;
+		}
+		node->next = cache.head;
+		cache.head = node;
+		++cache.count;
+		++live_count;
+	}
+}
+
+void MapObjectPool::flush(ThreadCache& cache, size_t count) {
+	if (count == 0) {
+		return;
+	}
+
+	// Splits off the first count objects, they are linked in already
+	FreeNode* first = cache.head;
+	FreeNode* last = first;
+	for (size_t i = 1; i < count; ++i) {
+		last = last->next;
+	}
+	cache.head = last->next;
+	cache.count -= count;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	last->next = free_list;
+	free_list = first;
+	free_count += count;
+	freed_since_trim += count;
+	live_count -= count;
+}
+
+void MapObjectPool::addSlab() {
+	Slab slab;
+	slab.count = next_slab_count;
+	slab.data = reinterpret_cast<uint8_t*>(::operator new(slab.count * object_size));
+	slabs.push_back(slab);
+	reserved_count += slab.count;
+
+	bump = slab.data;
+	bump_end = slab.data + slab.count * object_size;
+	next_slab_count = std::min(next_slab_count * 2, max_slab_count);
+}
+
+void MapObjectPool::releaseAll() {
+	for (const Slab& slab : slabs) {
+		::operator delete(slab.data);
+	}
+	slabs.clear();
+	free_list = nullptr;
+	free_count = 0;
+	freed_since_trim = 0;
+	bump = bump_end = nullptr;
+	reserved_count = 0;
+	next_slab_count = FIRST_SLAB_OBJECTS;
+}
+
+void MapObjectPool::trim() {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (slabs.empty()) {
+		return;
+	}
+	if (live_count == 0) {
+		releaseAll();
+		return;
+	}
+	// Walking the free-list is linear, only do it once enough objects were
+	// freed since the last pass that a whole slab may have become empty.
+	if (freed_since_trim < max_slab_count) {
+		return;
+	}
+	freed_since_trim = 0;
+
+	std::vector<Slab> sorted = slabs;
+	std::sort(sorted.begin(), sorted.end(), [](const Slab& a, const Slab& b) { return a.data < b.data; });
+	auto findSlab = [&sorted](const void* ptr) -> size_t {
+		auto it = std::upper_bound(sorted.begin(), sorted.end(), ptr, [](const void* p, const Slab& s) { return p < s.data; });
+		return size_t(it - sorted.begin()) - 1;
+	};
+
+	std::vector<size_t> unused(sorted.size(), 0);
+	for (FreeNode* node = free_list; node; node = node->next) {
+		++unused[findSlab(node)];
+	}
+	size_t bump_slab = sorted.size();
+	if (bump != bump_end) {
+		bump_slab = findSlab(bump);
+		unused[bump_slab] += (bump_end - bump) / object_size;
+	}
+
+	std::vector<bool> released(sorted.size(), false);
+	bool any = false;
+	for (size_t i = 0; i < sorted.size(); ++i) {
+		if (unused[i] == sorted[i].count) {
+			released[i] = any = true;
+		}
+	}
+
+	if (any) {
+		FreeNode* kept = nullptr;
+		free_count = 0;
+		for (FreeNode* node = free_list; node;) {
+			FreeNode* next = node->next;
+			if (!released[findSlab(node)]) {
+				node->next = kept;
+				kept = node;
+				++free_count;
+			}
+			node = next;
+		}
+		free_list = kept;
+
+		if (bump_slab < sorted.size() && released[bump_slab]) {
+			bump = bump_end = nullptr;
+		}
+
+		slabs.clear();
+		reserved_count = 0;
+		for (size_t i = 0; i < sorted.size(); ++i) {
+			if (released[i]) {
+				::operator delete(sorted[i].data);
+			} else {
+				slabs.push_back(sorted[i]);
+				reserved_count += sorted[i].count;
+			}
+		}
+	}
+}
+
+size_t MapObjectPool::getLiveCount() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return live_count;
+}
+
+size_t MapObjectPool::getLiveBytes() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return live_count * object_size;
+}
+
+size_t MapObjectPool::getReservedBytes() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return reserved_count * object_size;
+}
+
+size_t MapObjectPool::getSlabCount() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return slabs.size();
+}
+
+//**************** MapAllocator **********************
+
+MapAllocator::MapAllocator() :
+	floor_pool(sizeof(Floor), alignof(Floor)),
+	node_pool(sizeof(QTreeNode), alignof(QTreeNode)) {
+	////
+}
+
+MapAllocator::~MapAllocator() {
+	// Floors and nodes go away with the pools, the tiles and items of this
+	// map have already been returned to the shared pools by the tree.
+	getTilePool().trim();
+	getItemPool().trim();
+}
+
+void MapAllocator::trim() {
+	getTilePool().trim();
+	getItemPool().trim();
+	floor_pool.trim();
+	node_pool.trim();
+}
+
+MapObjectPool& MapAllocator::getTilePool() {
+	// Never destroyed, tiles may outlive every map (undo history, copy buffer)
+	static MapObjectPool* pool = newd MapObjectPool(sizeof(Tile), alignof(Tile), true);
+	return *pool;
+}
+
+MapObjectPool& MapAllocator::getItemPool() {
+	static MapObjectPool* pool = newd MapObjectPool(sizeof(Item), alignof(Item), true);
+	return *pool;
+}
+
+//**************** Tile **********************
+
+void* Tile::operator new(size_t size) {
+	if (size != sizeof(Tile)) {
+		return ::operator new(size);
+	}
+	return MapAllocator::getTilePool().allocate();
+}
+
+void Tile::operator delete(void* ptr, size_t size) {
+	if (size != sizeof(Tile)) {
+		::operator delete(ptr);
+		return;
+	}
+	MapAllocator::getTilePool().deallocate(ptr);
+}
+
+//**************** Item **********************
+
+void* Item::operator new(size_t size) {
+	if (size != sizeof(Item)) {
+		return ::operator new(size);
+	}
+	return MapAllocator::getItemPool().allocate();
+}
+
+void Item::operator delete(void* ptr, size_t size) {
+	if (size != sizeof(Item)) {
+		::operator delete(ptr);
+		return;
+	}
+	MapAllocator::getItemPool().deallocate(ptr);
+}
@@ -21,13 +21,91 @@
 #include "tile.h"
 #include "map_region.h"
 
+#include <mutex>
+
 class BaseMap;
 
+// Fixed-size object pool. Objects are carved out of large slabs and recycled
+// through an intrusive free-list, slabs are handed back to the system in bulk
+// once they hold no live objects anymore (see trim()).
+//
+// Pools that are allocated from by many threads at once can give every thread
+// a cache of free objects, which is refilled from and returned to the shared
+// free-list in batches so that the lock is only taken once per batch. Objects
+// in a cache count as live. Caches are only kept by pools that are never
+// destroyed, a thread returns its objects when it ends.
+class MapObjectPool {
+public:
+	MapObjectPool(size_t object_size, size_t object_align, bool thread_caches = false);
+	~MapObjectPool();
+
+	MapObjectPool(const MapObjectPool&) = delete;
+	MapObjectPool& operator=(const MapObjectPool&) = delete;
+
+	void* allocate();
+	void deallocate(void* ptr);
+
+	// Releases every slab that has no live objects left
+	void trim();
+
+	size_t getObjectSize() const {
+		return object_size;
+	}
+	size_t getLiveCount() const;
+	size_t getLiveBytes() const;
+	size_t getReservedBytes() const;
+	size_t getSlabCount() const;
+
+private:
+	struct FreeNode {
+		FreeNode* next;
+	};
+	struct ThreadCache {
+		FreeNode* head = nullptr;
+		size_t count = 0;
+		MapObjectPool* pool = nullptr;
+	};
+	struct ThreadCaches {
+		~ThreadCaches();
+		ThreadCache caches[4];
+	};
+	static thread_local ThreadCaches thread_caches;
+
+	void refill(ThreadCache& cache);
+	void flush(ThreadCache& cache, size_t count);
+	struct Slab {
+		uint8_t* data;
+		size_t count;
+	};
+
+	void addSlab();
+	void releaseAll();
+
+	size_t object_size;
+	size_t next_slab_count;
+	size_t max_slab_count;
+
+	FreeNode* free_list;
+	size_t free_count;
+	size_t freed_since_trim;
+	// Untouched tail of the newest slab
+	uint8_t* bump;
+	uint8_t* bump_end;
+
+	std::vector<Slab> slabs;
+	size_t reserved_count;
+	size_t live_count;
+	// Index into thread_caches, or -1 without caches
+	int cache_index;
+
+	mutable std::mutex mutex;
+};
+
 class MapAllocator {
 
 public:
-	MapAllocator() { }
-	~MapAllocator() { }
+	MapAllocator();
+	~MapAllocator();
 
 	// shorthands for tiles
 	Tile* operator()(TileLocation* location) {
@@ -38,9 +116,10 @@ public:
 		freeTile(t);
 	}
 
-	//
+	// Tiles move freely between maps (copy buffer, undo history), so they
+	// are drawn from a pool shared by all maps, see Tile::operator new.
 	Tile* allocateTile(TileLocation* location) {
-		return newd Tile(*location);
+		return new Tile(*location);
 	}
 	void freeTile(Tile* t) {
 		delete t;
@@ -48,19 +127,41 @@ public:
 
 	//
 	Floor* allocateFloor(int x, int y, int z) {
-		return newd Floor(x, y, z);
+		return new (floor_pool.allocate()) Floor(x, y, z);
 	}
 	void freeFloor(Floor* f) {
-		delete f;
+		if (f) {
+			f->~Floor();
+			floor_pool.deallocate(f);
+		}
 	}
 
 	//
 	QTreeNode* allocateNode(BaseMap& map) {
-		return newd QTreeNode(map);
+		return new (node_pool.allocate()) QTreeNode(map);
 	}
 	void freeNode(QTreeNode* qt) {
-		delete qt;
+		if (qt) {
+			qt->~QTreeNode();
+			node_pool.deallocate(qt);
+		}
 	}
+
+	// Hands unused slabs back to the system
+	void trim();
+
+	static MapObjectPool& getTilePool();
+	static MapObjectPool& getItemPool();
+	const MapObjectPool& getFloorPool() const {
+		return floor_pool;
+	}
+	const MapObjectPool& getNodePool() const {
+		return node_pool;
+	}
+
+private:
+	MapObjectPool floor_pool;
+	MapObjectPool node_pool;
 };
 
 #endif
@@ -199,6 +199,9 @@ void MapCanvas::OnPaint(wxPaintEvent& event) {
 	SetCurrent(*g_gui.GetGLContext(this));
 
 	if (g_gui.IsRenderingEnabled()) {
+		// Upload what was decoded in the background, without holding up the frame
+		g_gui.gfx.uploadPrefetchedSprites(2);
+
 		DrawingOptions& options = drawer->getOptions();
 		if (screenshot_buffer) {
 			options.SetIngame();
@@ -248,6 +251,23 @@ void MapCanvas::OnPaint(wxPaintEvent& event) {
 		drawer->SetupGL();
 		drawer->Draw();
 
+#ifdef __DEBUG__
+		const bool show_frame_stats = true;
+#else
+		const bool show_frame_stats = g_settings.getBoolean(Config::SHOW_TEXTURE_STATS);
+#endif
+		if (show_frame_stats) {
+			const TextureStats& texture_stats = g_gui.gfx.getTextureStats();
+			wxString frame_status;
+			frame_status << "zoom: " << int((1.0 / zoom) * 100) << "%";
+#ifdef __DEBUG__
+			const SpriteBatch::Stats& stats = drawer->getFrameStats();
+			frame_status << " draws: " << stats.draw_calls << " quads: " << stats.quads << " binds: " << stats.binds;
+#endif
+			frame_status << " textures: " << int(texture_stats.texture_bytes / (1024 * 1024)) << " MB hits: " << int(texture_stats.hit_rate * 100) << "% evictions/s: " << int(texture_stats.evictions_per_second);
+			g_gui.root->SetStatusText(frame_status, 3);
+		}
+
 		if (screenshot_buffer) {
 			drawer->TakeScreenshot(screenshot_buffer);
 		}
@@ -1063,6 +1083,8 @@ void MapCanvas::OnMouseActionRelease(wxMouseEvent& event) {
 						}
 					}
 
+					editor.map.loadAreas(start_x - MAP_LAYERS, start_y - MAP_LAYERS, end_x + MAP_LAYERS, end_y + MAP_LAYERS);
+
 					if (numtiles < 500) {
 						// No point in threading for such a small set.
 						threadcount = 1;
@@ -117,8 +117,17 @@ bool DrawingOptions::isDrawLight() const noexcept {
 	return show_lights;
 }
 
+// Chunks kept for views that scrolled away, a screen needs a few hundred
+static const size_t MAX_CACHED_CHUNKS = 4096;
+// Past this zoom tiles are drawn as the blended average colour of their items,
+// creatures and the markers on top are still drawn as sprites
+static const float LOD_MIN_ZOOM = 4.0f;
+// Sprites are decoded ahead this many tiles around the view, and again once
+// the view has moved half of it
+static const int PREFETCH_MARGIN = 8;
+
 MapDrawer::MapDrawer(MapCanvas* canvas) :
-	canvas(canvas), editor(canvas->editor) {
+	canvas(canvas), editor(canvas->editor), frame_count(0), prefetch_x(-1), prefetch_y(-1), prefetch_floor(-1) {
 	light_drawer = std::make_shared<LightDrawer>();
 }
 
@@ -160,6 +169,9 @@ void MapDrawer::SetupVars() {
 
 	end_x = start_x + screensize_x / tile_size + 2;
 	end_y = start_y + screensize_y / tile_size + 2;
+
+	// Upper floors are drawn shifted, and brushes reach a bit past the view
+	editor.map.loadAreas(start_x - MAP_LAYERS, start_y - MAP_LAYERS, end_x + MAP_LAYERS, end_y + MAP_LAYERS);
 }
 
 void MapDrawer::SetupGL() {
@@ -179,6 +191,8 @@ void MapDrawer::SetupGL() {
 	glPushMatrix();
 	glLoadIdentity();
 	glTranslatef(0.375f, 0.375f, 0.0f);
+
+	batch.begin();
 }
 
 void MapDrawer::Release() {
@@ -232,6 +246,72 @@ void MapDrawer::Draw() {
 	if (options.show_tooltips || overlayHasTooltips) {
 		DrawTooltips();
 	}
+	batch.flush();
+	PrefetchSprites();
+}
+
+void MapDrawer::PrefetchSprites() {
+	// Far zoomed out only the average colours are drawn
+	if (zoom > LOD_MIN_ZOOM || options.show_as_minimap || options.show_only_colors) {
+		return;
+	}
+
+	int view_x = view_scroll_x / TileSize;
+	int view_y = view_scroll_y / TileSize;
+	if (floor == prefetch_floor && std::abs(view_x - prefetch_x) < PREFETCH_MARGIN / 2 && std::abs(view_y - prefetch_y) < PREFETCH_MARGIN / 2) {
+		return;
+	}
+
+	int view_width = screensize_x / tile_size + 2;
+	int view_height = screensize_y / tile_size + 2;
+
+	// The current floor and the ones right above and below it
+	for (int map_z = std::max(floor - 1, 0); map_z <= std::min(floor + 1, MAP_MAX_LAYER); ++map_z) {
+		// Floors above the ground are drawn shifted
+		int shift = map_z <= GROUND_LAYER ? GROUND_LAYER - map_z : floor - map_z;
+		int nd_start_x = (view_x + shift - PREFETCH_MARGIN) & ~3;
+		int nd_start_y = (view_y + shift - PREFETCH_MARGIN) & ~3;
+		int nd_end_x = view_x + shift + view_width + PREFETCH_MARGIN;
+		int nd_end_y = view_y + shift + view_height + PREFETCH_MARGIN;
+
+		for (int nd_map_x = std::max(nd_start_x, 0); nd_map_x <= nd_end_x; nd_map_x += 4) {
+			for (int nd_map_y = std::max(nd_start_y, 0); nd_map_y <= nd_end_y; nd_map_y += 4) {
+				QTreeNode* nd = editor.map.getLeaf(nd_map_x, nd_map_y);
+				if (!nd) {
+					continue;
+				}
+
+				Floor* chunk_floor = nd->getFloor(map_z);
+				if (!chunk_floor) {
+					continue;
+				}
+
+				for (TileLocation& location : chunk_floor->locs) {
+					Tile* tile = location.get();
+					if (!tile) {
+						continue;
+					}
+
+					// The decoder is full, the rest of the area is tried again next frame
+					if (tile->ground && g_items[tile->ground->getID()].sprite) {
+						if (!g_gui.gfx.prefetchSprite(g_items[tile->ground->getID()].sprite)) {
+							return;
+						}
+					}
+					for (const Item* item : tile->items) {
+						GameSprite* sprite = g_items[item->getID()].sprite;
+						if (sprite && !g_gui.gfx.prefetchSprite(sprite)) {
+							return;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	prefetch_x = view_x;
+	prefetch_y = view_y;
+	prefetch_floor = floor;
 }
 
 MapViewInfo MapDrawer::getViewInfo() const {
@@ -296,11 +376,12 @@ bool MapDrawer::drawOverlayCommands(const std::vector<MapOverlayCommand>& comman
 	int vPort[4];
 	glGetIntegerv(GL_VIEWPORT, vPort);
 
-	glDisable(GL_TEXTURE_2D);
+	batch.setTextured(false);
 	for (const auto& cmd : commands) {
 		bool isScreenSpace = cmd.screen_space;
 
 		if (isScreenSpace) {
+			batch.flush();
 			glMatrixMode(GL_PROJECTION);
 			glPushMatrix();
 			glLoadIdentity();
@@ -370,6 +451,7 @@ bool MapDrawer::drawOverlayCommands(const std::vector<MapOverlayCommand>& comman
 				glLineStipple(1, 0x00FF);
 			}
 
+			batch.flush();
 			glLineWidth(cmd.width);
 			glColor4ub(cmd.color.Red(), cmd.color.Green(), cmd.color.Blue(), cmd.color.Alpha());
 			glBegin(GL_LINES);
@@ -389,9 +471,9 @@ bool MapDrawer::drawOverlayCommands(const std::vector<MapOverlayCommand>& comman
 					int screen_x = 0;
 					int screen_y = 0;
 					if (mapToScreen(this, cmd.x, cmd.y, cmd.z, screen_x, screen_y)) {
-						glEnable(GL_TEXTURE_2D);
+						batch.setTextured(true);
 						BlitSpriteType(screen_x, screen_y, cmd.sprite_id, cmd.color.Red(), cmd.color.Green(), cmd.color.Blue(), cmd.color.Alpha());
-						glDisable(GL_TEXTURE_2D);
+						batch.setTextured(false);
 					}
 				}
 			}
@@ -400,6 +482,7 @@ bool MapDrawer::drawOverlayCommands(const std::vector<MapOverlayCommand>& comman
 				if (isScreenSpace) {
 					int screen_x = static_cast<int>(cmd.x);
 					int screen_y = static_cast<int>(cmd.y);
+					batch.flush();
 					DrawDirectText(screen_x, screen_y, cmd.text, cmd.color);
 				} else {
 					int screen_x = 0;
@@ -413,13 +496,14 @@ bool MapDrawer::drawOverlayCommands(const std::vector<MapOverlayCommand>& comman
 		}
 
 		if (isScreenSpace) {
+			batch.flush();
 			glMatrixMode(GL_PROJECTION);
 			glPopMatrix();
 			glMatrixMode(GL_MODELVIEW);
 			glPopMatrix();
 		}
 	}
-	glEnable(GL_TEXTURE_2D);
+	batch.setTextured(true);
 	return hasTooltips;
 }
 
@@ -487,28 +571,29 @@ void MapDrawer::DrawMap() {
 
 	bool only_colors = options.show_as_minimap || options.show_only_colors;
 
+	++frame_count;
+	const ChunkCacheKey cache_key = getChunkCacheKey();
+	if (cache_key != chunk_cache_key) {
+		chunk_cache.clear();
+		chunk_cache_key = cache_key;
+	}
+
 	// Enable texture mode
 	if (!only_colors) {
-		glEnable(GL_TEXTURE_2D);
+		batch.setTextured(true);
 	}
 
 	for (int map_z = start_z; map_z >= superend_z; map_z--) {
 		if (map_z == end_z && start_z != end_z && options.show_shade) {
 			// Draw shade
 			if (!only_colors) {
-				glDisable(GL_TEXTURE_2D);
+				batch.setTextured(false);
 			}
 
-			glColor4ub(0, 0, 0, 128);
-			glBegin(GL_QUADS);
-			glVertex2f(0, int(screensize_y * zoom));
-			glVertex2f(int(screensize_x * zoom), int(screensize_y * zoom));
-			glVertex2f(int(screensize_x * zoom), 0);
-			glVertex2f(0, 0);
-			glEnd();
+			batch.addQuad(0, 0, int(screensize_x * zoom), int(screensize_y * zoom), nullptr, 0, 0, 0, 128);
 
 			if (!only_colors) {
-				glEnable(GL_TEXTURE_2D);
+				batch.setTextured(true);
 			}
 		}
 
@@ -531,14 +616,16 @@ void MapDrawer::DrawMap() {
 					}
 
 					if (!live_client || nd->isVisible(map_z > GROUND_LAYER)) {
-						for (int map_x = 0; map_x < 4; ++map_x) {
-							for (int map_y = 0; map_y < 4; ++map_y) {
-								TileLocation* location = nd->getTile(map_x, map_y, map_z);
-								DrawTile(location);
-								// draw light, but only if not zoomed too far
-								if (location && options.isDrawLight() && zoom <= 10.0) {
-									AddLight(location);
-								}
+						Floor* chunk_floor = nd->getFloor(map_z);
+						if (!chunk_floor) {
+							continue;
+						}
+
+						DrawTileChunk(chunk_floor);
+						// draw light, but only if not zoomed too far
+						if (options.isDrawLight() && zoom <= 10.0) {
+							for (TileLocation& location : chunk_floor->locs) {
+								AddLight(&location);
 							}
 						}
 					} else {
@@ -550,20 +637,14 @@ void MapDrawer::DrawMap() {
 						int cy = (nd_map_y)*TileSize - view_scroll_y - getFloorAdjustment(floor);
 						int cx = (nd_map_x)*TileSize - view_scroll_x - getFloorAdjustment(floor);
 
-						glColor4ub(255, 0, 255, 128);
-						glBegin(GL_QUADS);
-						glVertex2f(cx, cy + TileSize * 4);
-						glVertex2f(cx + TileSize * 4, cy + TileSize * 4);
-						glVertex2f(cx + TileSize * 4, cy);
-						glVertex2f(cx, cy);
-						glEnd();
+						batch.addQuad(cx, cy, TileSize * 4, TileSize * 4, nullptr, 255, 0, 255, 128);
 					}
 				}
 			}
 		}
 
 		if (only_colors) {
-			glEnable(GL_TEXTURE_2D);
+			batch.setTextured(true);
 		}
 
 		// Draws the doodad preview or the paste preview (or import preview)
@@ -656,7 +737,18 @@ void MapDrawer::DrawMap() {
 	}
 
 	if (!only_colors) {
-		glEnable(GL_TEXTURE_2D);
+		batch.setTextured(true);
+	}
+
+	// Forget the chunks that went out of view once there are too many
+	if (chunk_cache.size() > MAX_CACHED_CHUNKS) {
+		for (auto it = chunk_cache.begin(); it != chunk_cache.end();) {
+			if (it->second.last_frame != frame_count) {
+				it = chunk_cache.erase(it);
+			} else {
+				++it;
+			}
+		}
 	}
 }
 
@@ -677,7 +769,7 @@ void MapDrawer::DrawIngameBox() {
 
 	static wxColor side_color(0, 0, 0, 200);
 
-	glDisable(GL_TEXTURE_2D);
+	batch.setTextured(false);
 
 	// left side
 	if (box_start_map_x >= start_x) {
@@ -716,10 +808,11 @@ void MapDrawer::DrawIngameBox() {
 	box_end_y = box_start_y + TileSize;
 	drawRect(box_start_x, box_start_y, box_end_x - box_start_x, box_end_y - box_start_y, *wxGREEN);
 
-	glEnable(GL_TEXTURE_2D);
+	batch.setTextured(true);
 }
 
 void MapDrawer::DrawGrid() {
+	batch.flush();
 	for (int y = start_y; y < end_y; ++y) {
 		glColor4ub(255, 255, 255, 128);
 		glBegin(GL_LINES);
@@ -738,7 +831,7 @@ void MapDrawer::DrawGrid() {
 }
 
 void MapDrawer::DrawDraggingShadow() {
-	glEnable(GL_TEXTURE_2D);
+	batch.setTextured(true);
 
 	// Draw dragging shadow
 	if (!editor.selection.isBusy() && dragging && !options.ingame) {
@@ -795,11 +888,11 @@ void MapDrawer::DrawDraggingShadow() {
 		}
 	}
 
-	glDisable(GL_TEXTURE_2D);
+	batch.setTextured(false);
 }
 
 void MapDrawer::DrawHigherFloors() {
-	glEnable(GL_TEXTURE_2D);
+	batch.setTextured(true);
 
 	// Draw "transparent higher floor"
 	if (floor != 8 && floor != 0 && options.transparent_floors) {
@@ -838,7 +931,7 @@ void MapDrawer::DrawHigherFloors() {
 		}
 	}
 
-	glDisable(GL_TEXTURE_2D);
+	batch.setTextured(false);
 }
 
 void MapDrawer::DrawSelectionBox() {
@@ -875,6 +968,7 @@ void MapDrawer::DrawSelectionBox() {
 	lines[3][2] = last_click_rx;
 	lines[3][3] = last_click_ry;
 
+	batch.flush();
 	glEnable(GL_LINE_STIPPLE);
 	glLineStipple(1, 0xf0);
 	glLineWidth(1.0);
@@ -922,13 +1016,7 @@ void MapDrawer::DrawLiveCursors() {
 		float draw_x = ((cursor.pos.x * TileSize) - view_scroll_x) - offset;
 		float draw_y = ((cursor.pos.y * TileSize) - view_scroll_y) - offset;
 
-		glColor(cursor.color);
-		glBegin(GL_QUADS);
-		glVertex2f(draw_x, draw_y);
-		glVertex2f(draw_x + TileSize, draw_y);
-		glVertex2f(draw_x + TileSize, draw_y + TileSize);
-		glVertex2f(draw_x, draw_y + TileSize);
-		glEnd();
+		batch.addQuad(draw_x, draw_y, TileSize, TileSize, nullptr, cursor.color.Red(), cursor.color.Green(), cursor.color.Blue(), cursor.color.Alpha());
 	}
 }
 
@@ -975,6 +1063,7 @@ void MapDrawer::DrawBrush() {
 			int delta_x = last_click_end_sx - last_click_start_sx;
 			int delta_y = last_click_end_sy - last_click_start_sy;
 
+			batch.flush();
 			glColor(brushColor);
 			glBegin(GL_QUADS);
 			{
@@ -1007,7 +1096,7 @@ void MapDrawer::DrawBrush() {
 			glEnd();
 		} else {
 			if (brush->isRaw()) {
-				glEnable(GL_TEXTURE_2D);
+				batch.setTextured(true);
 			}
 
 			if (g_gui.GetBrushShape() == BRUSHSHAPE_SQUARE || brush->isSpawn() /* Spawn brush is always square */) {
@@ -1057,6 +1146,7 @@ void MapDrawer::DrawBrush() {
 					int last_click_end_sx = last_click_end_map_x * TileSize - view_scroll_x - getFloorAdjustment(floor);
 					int last_click_end_sy = last_click_end_map_y * TileSize - view_scroll_y - getFloorAdjustment(floor);
 
+					batch.flush();
 					glColor(brushColor);
 					glBegin(GL_QUADS);
 					glVertex2f(last_click_start_sx, last_click_start_sy);
@@ -1112,6 +1202,7 @@ void MapDrawer::DrawBrush() {
 							if (brush->isRaw()) {
 								DrawRawBrush(cx, cy, raw_brush->getItemType(), 160, 160, 160, 160);
 							} else {
+								batch.flush();
 								glColor(brushColor);
 								glBegin(GL_QUADS);
 								glVertex2f(cx, cy + TileSize);
@@ -1126,7 +1217,7 @@ void MapDrawer::DrawBrush() {
 			}
 
 			if (brush->isRaw()) {
-				glDisable(GL_TEXTURE_2D);
+				batch.setTextured(false);
 			}
 		}
 	} else {
@@ -1144,6 +1235,7 @@ void MapDrawer::DrawBrush() {
 			int delta_x = end_sx - start_sx;
 			int delta_y = end_sy - start_sy;
 
+			batch.flush();
 			glColor(brushColor);
 			glBegin(GL_QUADS);
 			{
@@ -1178,6 +1270,7 @@ void MapDrawer::DrawBrush() {
 			int cx = (mouse_map_x)*TileSize - view_scroll_x - getFloorAdjustment(floor);
 			int cy = (mouse_map_y)*TileSize - view_scroll_y - getFloorAdjustment(floor);
 
+			batch.flush();
 			glColorCheck(brush, Position(mouse_map_x, mouse_map_y, floor));
 			glBegin(GL_QUADS);
 			glVertex2f(cx, cy + TileSize);
@@ -1186,7 +1279,7 @@ void MapDrawer::DrawBrush() {
 			glVertex2f(cx, cy);
 			glEnd();
 		} else if (brush->isCreature()) {
-			glEnable(GL_TEXTURE_2D);
+			batch.setTextured(true);
 			int cy = (mouse_map_y)*TileSize - view_scroll_y - getFloorAdjustment(floor);
 			int cx = (mouse_map_x)*TileSize - view_scroll_x - getFloorAdjustment(floor);
 			CreatureBrush* creature_brush = brush->asCreature();
@@ -1195,11 +1288,11 @@ void MapDrawer::DrawBrush() {
 			} else {
 				BlitCreature(cx, cy, creature_brush->getType()->outfit, SOUTH, 255, 64, 64, 160);
 			}
-			glDisable(GL_TEXTURE_2D);
+			batch.setTextured(false);
 		} else if (!brush->isDoodad()) {
 			RAWBrush* raw_brush = nullptr;
 			if (brush->isRaw()) { // Textured brush
-				glEnable(GL_TEXTURE_2D);
+				batch.setTextured(true);
 				raw_brush = brush->asRaw();
 			}
 
@@ -1217,6 +1310,7 @@ void MapDrawer::DrawBrush() {
 									getColor(brush, Position(mouse_map_x + x, mouse_map_y + y, floor), r, g, b);
 									DrawBrushIndicator(cx, cy, brush, r, g, b);
 								} else {
+									batch.flush();
 									if (brush->isHouseExit() || brush->isOptionalBorder()) {
 										glColorCheck(brush, Position(mouse_map_x + x, mouse_map_y + y, floor));
 									} else {
@@ -1243,6 +1337,7 @@ void MapDrawer::DrawBrush() {
 									getColor(brush, Position(mouse_map_x + x, mouse_map_y + y, floor), r, g, b);
 									DrawBrushIndicator(cx, cy, brush, r, g, b);
 								} else {
+									batch.flush();
 									if (brush->isHouseExit() || brush->isOptionalBorder()) {
 										glColorCheck(brush, Position(mouse_map_x + x, mouse_map_y + y, floor));
 									} else {
@@ -1263,7 +1358,7 @@ void MapDrawer::DrawBrush() {
 			}
 
 			if (brush->isRaw()) { // Textured brush
-				glDisable(GL_TEXTURE_2D);
+				batch.setTextured(false);
 			}
 		}
 	}
@@ -1397,8 +1492,8 @@ void MapDrawer::BlitItem(int& draw_x, int& draw_y, const Position& pos, Item* it
 	for (int cx = 0; cx != spr->width; cx++) {
 		for (int cy = 0; cy != spr->height; cy++) {
 			for (int cf = 0; cf != spr->layers; cf++) {
-				int texnum = spr->getHardwareID(cx, cy, cf, subtype, pattern_x, pattern_y, pattern_z, frame);
-				glBlitTexture(screenx - cx * TileSize, screeny - cy * TileSize, texnum, red, green, blue, alpha);
+				const AtlasRegion* region = spr->getAtlasRegion(cx, cy, cf, subtype, pattern_x, pattern_y, pattern_z, frame);
+				glBlitTexture(screenx - cx * TileSize, screeny - cy * TileSize, region, red, green, blue, alpha);
 			}
 		}
 	}
@@ -1447,10 +1542,10 @@ void MapDrawer::BlitItem(int& draw_x, int& draw_y, const Position& pos, Item* it
 
 			int startOffset = std::max<int>(16, 32 - light.intensity);
 			int sqSize = TileSize - startOffset;
-			glDisable(GL_TEXTURE_2D);
+			batch.setTextured(false);
 			glBlitSquare(draw_x + startOffset - 2, draw_y + startOffset - 2, 0, 0, 0, byteA, sqSize + 2);
 			glBlitSquare(draw_x + startOffset - 1, draw_y + startOffset - 1, byteR, byteG, byteB, byteA, sqSize);
-			glEnable(GL_TEXTURE_2D);
+			batch.setTextured(true);
 		}
 	}
 }
@@ -1467,9 +1562,8 @@ void MapDrawer::BlitSpriteType(int screenx, int screeny, uint32_t spriteid, int
 	for (int cx = 0; cx != spr->width; ++cx) {
 		for (int cy = 0; cy != spr->height; ++cy) {
 			for (int cf = 0; cf != spr->layers; ++cf) {
-				int texnum = spr->getHardwareID(cx, cy, cf, -1, 0, 0, 0, tme);
-				// printf("CF: %d\tTexturenum: %d\n", cf, texnum);
-				glBlitTexture(screenx - cx * TileSize, screeny - cy * TileSize, texnum, red, green, blue, alpha);
+				const AtlasRegion* region = spr->getAtlasRegion(cx, cy, cf, -1, 0, 0, 0, tme);
+				glBlitTexture(screenx - cx * TileSize, screeny - cy * TileSize, region, red, green, blue, alpha);
 			}
 		}
 	}
@@ -1486,9 +1580,8 @@ void MapDrawer::BlitSpriteType(int screenx, int screeny, GameSprite* spr, int re
 	for (int cx = 0; cx != spr->width; ++cx) {
 		for (int cy = 0; cy != spr->height; ++cy) {
 			for (int cf = 0; cf != spr->layers; ++cf) {
-				int texnum = spr->getHardwareID(cx, cy, cf, -1, 0, 0, 0, tme);
-				// printf("CF: %d\tTexturenum: %d\n", cf, texnum);
-				glBlitTexture(screenx - cx * TileSize, screeny - cy * TileSize, texnum, red, green, blue, alpha);
+				const AtlasRegion* region = spr->getAtlasRegion(cx, cy, cf, -1, 0, 0, 0, tme);
+				glBlitTexture(screenx - cx * TileSize, screeny - cy * TileSize, region, red, green, blue, alpha);
 			}
 		}
 	}
@@ -1522,8 +1615,8 @@ void MapDrawer::BlitCreature(int screenx, int screeny, const Outfit& outfit, Dir
 
 				for (int cx = 0; cx != mountSpr->width; ++cx) {
 					for (int cy = 0; cy != mountSpr->height; ++cy) {
-						int texnum = mountSpr->getHardwareID(cx, cy, (int)dir, 0, 0, mountOutfit, tme);
-						glBlitTexture(screenx - cx * TileSize, screeny - cy * TileSize, texnum, red, green, blue, alpha);
+						const AtlasRegion* region = mountSpr->getAtlasRegion(cx, cy, (int)dir, 0, 0, mountOutfit, tme);
+						glBlitTexture(screenx - cx * TileSize, screeny - cy * TileSize, region, red, green, blue, alpha);
 					}
 				}
 
@@ -1541,8 +1634,8 @@ void MapDrawer::BlitCreature(int screenx, int screeny, const Outfit& outfit, Dir
 
 			for (int cx = 0; cx != spr->width; ++cx) {
 				for (int cy = 0; cy != spr->height; ++cy) {
-					int texnum = spr->getHardwareID(cx, cy, (int)dir, pattern_y, pattern_z, outfit, tme);
-					glBlitTexture(screenx - cx * TileSize, screeny - cy * TileSize, texnum, red, green, blue, alpha);
+					const AtlasRegion* region = spr->getAtlasRegion(cx, cy, (int)dir, pattern_y, pattern_z, outfit, tme);
+					glBlitTexture(screenx - cx * TileSize, screeny - cy * TileSize, region, red, green, blue, alpha);
 				}
 			}
 		}
@@ -1568,23 +1661,45 @@ void MapDrawer::BlitSquare(int sx, int sy, int red, int green, int blue, int alp
 		return;
 	}
 
-	int texnum = spr->getHardwareID(0, 0, 0, -1, 0, 0, 0, 0);
-	if (texnum == 0) {
+	glBlitTexture(sx, sy, spr->getAtlasRegion(0, 0, 0, -1, 0, 0, 0, 0), red, green, blue, alpha);
+}
+
+static void blendAverageColor(const DrawingOptions& options, Item* item, float& red, float& green, float& blue, float& alpha) {
+	ItemType& it = g_items[item->getID()];
+	if (it.id == 0 || it.isMetaItem() || !it.sprite || it.pickupable && !options.show_items) {
 		return;
 	}
 
-	glBindTexture(GL_TEXTURE_2D, texnum);
-	glColor4ub(uint8_t(red), uint8_t(green), uint8_t(blue), uint8_t(alpha));
-	glBegin(GL_QUADS);
-	glTexCoord2f(0.f, 0.f);
-	glVertex2f(sx, sy);
-	glTexCoord2f(1.f, 0.f);
-	glVertex2f(sx + TileSize, sy);
-	glTexCoord2f(1.f, 1.f);
-	glVertex2f(sx + TileSize, sy + TileSize);
-	glTexCoord2f(0.f, 1.f);
-	glVertex2f(sx, sy + TileSize);
-	glEnd();
+	// Colours are premultiplied by alpha while blending
+	const wxColor& color = it.sprite->getAverageColor();
+	float a = color.Alpha() / 255.f;
+	float shade = !options.ingame && item->isSelected() ? 0.5f : 1.f;
+	red = red * (1.f - a) + color.Red() * shade * a;
+	green = green * (1.f - a) + color.Green() * shade * a;
+	blue = blue * (1.f - a) + color.Blue() * shade * a;
+	alpha = alpha * (1.f - a) + a;
+}
+
+void MapDrawer::DrawTileColor(int draw_x, int draw_y, const Tile* tile, uint8_t r, uint8_t g, uint8_t b) {
+	float red = 0.f, green = 0.f, blue = 0.f, alpha = 0.f;
+	if (tile->ground) {
+		blendAverageColor(options, tile->ground, red, green, blue, alpha);
+	}
+	if (zoom < 10.0 || !options.hide_items_when_zoomed) {
+		for (Item* item : tile->items) {
+			blendAverageColor(options, item, red, green, blue, alpha);
+		}
+	}
+
+	if (alpha <= 0.f) {
+		if (options.always_show_zones && (r != 255 || g != 255 || b != 255)) {
+			BlitSquare(draw_x, draw_y, r, g, b, 60);
+		}
+		return;
+	}
+
+	// Apply the same tint the ground sprite would get
+	BlitSquare(draw_x, draw_y, int(red / alpha * r / 255.f), int(green / alpha * g / 255.f), int(blue / alpha * b / 255.f), int(alpha * 255.f));
 }
 
 void MapDrawer::DrawRawBrush(int screenx, int screeny, ItemType* itemType, uint8_t r, uint8_t g, uint8_t b, uint8_t alpha) {
@@ -1789,6 +1904,8 @@ void MapDrawer::DrawTile(TileLocation* location) {
 		} else if (r != 255 || g != 255 || b != 255) {
 			BlitSquare(draw_x, draw_y, r, g, b, 128);
 		}
+	} else if (zoom > LOD_MIN_ZOOM) {
+		DrawTileColor(draw_x, draw_y, tile, r, g, b);
 	} else {
 		if (tile->ground) {
 			if (options.show_preview && zoom <= 2.0) {
@@ -1815,6 +1932,11 @@ void MapDrawer::DrawTile(TileLocation* location) {
 					WriteTooltip(*it, tooltip, tile->isHouseTile());
 				}
 
+				// far out the items are already part of the tile colour
+				if (zoom > LOD_MIN_ZOOM) {
+					continue;
+				}
+
 				// item animation
 				if (options.show_preview && zoom <= 2.0) {
 					(*it)->animate();
@@ -1885,6 +2007,126 @@ void MapDrawer::DrawTile(TileLocation* location) {
 	}
 }
 
+static bool hasAnimatedItems(Floor* chunk_floor) {
+	for (TileLocation& location : chunk_floor->locs) {
+		Tile* tile = location.get();
+		if (!tile) {
+			continue;
+		}
+
+		if (tile->ground) {
+			GameSprite* sprite = g_items[tile->ground->getID()].sprite;
+			if (sprite && sprite->animator) {
+				return true;
+			}
+		}
+		for (const Item* item : tile->items) {
+			GameSprite* sprite = g_items[item->getID()].sprite;
+			if (sprite && sprite->animator) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void MapDrawer::DrawTileChunk(Floor* chunk_floor) {
+	TileLocation* locations = chunk_floor->locs;
+
+	// Tooltips are collected while drawing, and saving the map changes which tiles are modified
+	if (options.show_tooltips || options.show_only_modified) {
+		for (int i = 0; i < MAP_LAYERS; ++i) {
+			DrawTile(&locations[i]);
+		}
+		return;
+	}
+
+	uint32_t revision = 0;
+	for (int i = 0; i < MAP_LAYERS; ++i) {
+		revision += locations[i].getRevision();
+	}
+
+	const Position origin = locations[0].getPosition();
+	const uint64_t key = (uint64_t(origin.x) << 32) | (uint64_t(origin.y) << 8) | uint64_t(origin.z);
+	TileChunk& chunk = chunk_cache[key];
+	chunk.last_frame = frame_count;
+
+	const bool unchanged = chunk.floor == chunk_floor && chunk.revision == revision && chunk.textured == batch.isTextured();
+	if (unchanged && chunk.cacheable) {
+		// Only fails if one of its sprites was evicted, then just this chunk is drawn again
+		if (batch.replay(chunk.quads, chunk.scroll_x - view_scroll_x, chunk.scroll_y - view_scroll_y)) {
+			batch.setTextured(chunk.textured);
+			return;
+		}
+	}
+
+	if (!unchanged || chunk.cacheable) {
+		chunk.floor = chunk_floor;
+		chunk.revision = revision;
+		chunk.textured = batch.isTextured();
+		chunk.cacheable = !(options.show_preview && zoom <= 2.0 && hasAnimatedItems(chunk_floor));
+		chunk.quads.clear();
+
+		if (chunk.cacheable) {
+			chunk.scroll_x = view_scroll_x;
+			chunk.scroll_y = view_scroll_y;
+			batch.startRecording(chunk.quads);
+			for (int i = 0; i < MAP_LAYERS; ++i) {
+				DrawTile(&locations[i]);
+			}
+			batch.stopRecording();
+			return;
+		}
+	}
+
+	for (int i = 0; i < MAP_LAYERS; ++i) {
+		DrawTile(&locations[i]);
+	}
+}
+
+MapDrawer::ChunkCacheKey MapDrawer::getChunkCacheKey() const {
+	const bool flags[] = {
+		options.transparent_items,
+		options.show_light_str,
+		options.show_tech_items,
+		options.show_waypoints,
+		options.ingame,
+		options.show_creatures,
+		options.show_spawns,
+		options.show_houses,
+		options.show_special_tiles,
+		options.show_items,
+		options.highlight_items,
+		options.highlight_locked_doors,
+		options.show_blocking,
+		options.show_as_minimap,
+		options.show_only_colors,
+		options.show_preview,
+		options.show_hooks,
+		options.hide_items_when_zoomed,
+		options.show_towns,
+		options.always_show_zones,
+		options.extended_house_shader,
+		// Zoom levels at which tiles are drawn differently
+		zoom <= 2.0,
+		zoom <= 3.0,
+		zoom <= LOD_MIN_ZOOM,
+		zoom < 10.0,
+	};
+
+	ChunkCacheKey key;
+	for (size_t i = 0; i < sizeof(flags) / sizeof(flags[0]); ++i) {
+		if (flags[i]) {
+			key.options |= 1u << i;
+		}
+	}
+	key.house_id = current_house_id;
+	key.floor = floor;
+	key.tile_generation = editor.map.getTileGeneration();
+	key.texture_generation = g_gui.gfx.getTextureGeneration();
+	return key;
+}
+
 void MapDrawer::DrawBrushIndicator(int x, int y, Brush* brush, uint8_t r, uint8_t g, uint8_t b) {
 	x += (TileSize / 2);
 	y += (TileSize / 2);
@@ -1907,6 +2149,7 @@ void MapDrawer::DrawBrushIndicator(int x, int y, Brush* brush, uint8_t r, uint8_
 	};
 
 	// circle
+	batch.flush();
 	glBegin(GL_TRIANGLE_FAN);
 	glColor4ub(0x00, 0x00, 0x00, 0x50);
 	glVertex2i(x, y);
@@ -1936,29 +2179,23 @@ void MapDrawer::DrawBrushIndicator(int x, int y, Brush* brush, uint8_t r, uint8_
 }
 
 void MapDrawer::DrawHookIndicator(int x, int y, const ItemType& type) {
-	glDisable(GL_TEXTURE_2D);
-	glColor4ub(uint8_t(0), uint8_t(0), uint8_t(255), uint8_t(200));
-	glBegin(GL_QUADS);
+	batch.setTextured(false);
 	if (type.hookSouth) {
-		x -= 10;
-		y += 10;
-		glVertex2f(x, y);
-		glVertex2f(x + 10, y);
-		glVertex2f(x + 20, y + 10);
-		glVertex2f(x + 10, y + 10);
+		const float hx = x - 10;
+		const float hy = y + 10;
+		const float corners[4][2] = { { hx, hy }, { hx + 10, hy }, { hx + 20, hy + 10 }, { hx + 10, hy + 10 } };
+		batch.addQuad(corners, 0, 0, 255, 200);
 	} else if (type.hookEast) {
-		x += 10;
-		y -= 10;
-		glVertex2f(x, y);
-		glVertex2f(x + 10, y + 10);
-		glVertex2f(x + 10, y + 20);
-		glVertex2f(x, y + 10);
+		const float hx = x + 10;
+		const float hy = y - 10;
+		const float corners[4][2] = { { hx, hy }, { hx + 10, hy + 10 }, { hx + 10, hy + 20 }, { hx, hy + 10 } };
+		batch.addQuad(corners, 0, 0, 255, 200);
 	}
-	glEnd();
-	glEnable(GL_TEXTURE_2D);
+	batch.setTextured(true);
 }
 
 void MapDrawer::DrawTooltips() {
+	batch.flush();
 	for (std::vector<MapTooltip*>::const_iterator it = tooltips.begin(); it != tooltips.end(); ++it) {
 		MapTooltip* tooltip = (*it);
 		const char* text = tooltip->text.c_str();
@@ -2066,7 +2303,10 @@ void MapDrawer::DrawTooltips() {
 
 void MapDrawer::DrawLight() {
 	// draw in-game light
+	batch.flush();
 	light_drawer->draw(start_x, start_y, end_x, end_y, view_scroll_x, view_scroll_y, options.experimental_fog);
+	// The light drawer binds its own texture
+	batch.reset();
 }
 
 void MapDrawer::MakeTooltip(int screenx, int screeny, const std::string& text, uint8_t r, uint8_t g, uint8_t b) {
@@ -2132,20 +2372,9 @@ void MapDrawer::TakeScreenshot(uint8_t* screenshot_buffer) {
 	}
 }
 
-void MapDrawer::glBlitTexture(int sx, int sy, int texture_number, int red, int green, int blue, int alpha) {
-	if (texture_number != 0) {
-		glBindTexture(GL_TEXTURE_2D, texture_number);
-		glColor4ub(uint8_t(red), uint8_t(green), uint8_t(blue), uint8_t(alpha));
-		glBegin(GL_QUADS);
-		glTexCoord2f(0.f, 0.f);
-		glVertex2f(sx, sy);
-		glTexCoord2f(1.f, 0.f);
-		glVertex2f(sx + TileSize, sy);
-		glTexCoord2f(1.f, 1.f);
-		glVertex2f(sx + TileSize, sy + TileSize);
-		glTexCoord2f(0.f, 1.f);
-		glVertex2f(sx, sy + TileSize);
-		glEnd();
+void MapDrawer::glBlitTexture(int sx, int sy, const AtlasRegion* region, int red, int green, int blue, int alpha) {
+	if (region) {
+		batch.addQuad(sx, sy, TileSize, TileSize, region, uint8_t(red), uint8_t(green), uint8_t(blue), uint8_t(alpha));
 	}
 }
 
@@ -2154,13 +2383,7 @@ void MapDrawer::glBlitSquare(int sx, int sy, int red, int green, int blue, int a
 		size = TileSize;
 	}
 
-	glColor4ub(uint8_t(red), uint8_t(green), uint8_t(blue), uint8_t(alpha));
-	glBegin(GL_QUADS);
-	glVertex2f(sx, sy);
-	glVertex2f(sx + size, sy);
-	glVertex2f(sx + size, sy + size);
-	glVertex2f(sx, sy + size);
-	glEnd();
+	batch.addQuad(sx, sy, size, size, nullptr, uint8_t(red), uint8_t(green), uint8_t(blue), uint8_t(alpha));
 }
 
 void MapDrawer::glColor(wxColor color) {
@@ -2219,6 +2442,7 @@ void MapDrawer::glColorCheck(Brush* brush, const Position& pos) {
 }
 
 void MapDrawer::drawRect(int x, int y, int w, int h, const wxColor& color, int width) {
+	batch.flush();
 	glLineWidth(width);
 	glColor4ub(color.Red(), color.Green(), color.Blue(), color.Alpha());
 	glBegin(GL_LINE_STRIP);
@@ -2231,11 +2455,5 @@ void MapDrawer::drawRect(int x, int y, int w, int h, const wxColor& color, int w
 }
 
 void MapDrawer::drawFilledRect(int x, int y, int w, int h, const wxColor& color) {
-	glColor4ub(color.Red(), color.Green(), color.Blue(), color.Alpha());
-	glBegin(GL_QUADS);
-	glVertex2f(x, y);
-	glVertex2f(x + w, y);
-	glVertex2f(x + w, y + h);
-	glVertex2f(x, y + h);
-	glEnd();
+	batch.addQuad(x, y, w, h, nullptr, color.Red(), color.Green(), color.Blue(), color.Alpha());
 }
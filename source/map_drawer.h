@@ -18,9 +18,14 @@
 #ifndef RME_MAP_DRAWER_H_
 #define RME_MAP_DRAWER_H_
 
+#include <unordered_map>
+
 #include "map_overlay.h"
+#include "sprite_batch.h"
 
 class GameSprite;
+class Floor;
+struct AtlasRegion;
 
 struct MapTooltip {
 	enum TextLength {
@@ -110,6 +115,55 @@ class MapDrawer {
 	int tile_size;
 	int floor;
 
+	SpriteBatch batch;
+
+	// The quads drawn for one floor of a 4x4 tile leaf, replayed as long as
+	// none of its locations has changed
+	struct TileChunk {
+		TileChunk() :
+			floor(nullptr), revision(0), scroll_x(0), scroll_y(0), textured(false), cacheable(false), last_frame(0) {
+			////
+		}
+
+		Floor* floor;
+		uint32_t revision;
+		int scroll_x, scroll_y;
+		bool textured;
+		// False when the chunk is animated and has to be drawn every frame
+		bool cacheable;
+		uint32_t last_frame;
+		SpriteBatch::Recording quads;
+	};
+
+	// Everything besides the tiles themselves that changes how chunks look,
+	// the cache is dropped when any of it changes
+	struct ChunkCacheKey {
+		ChunkCacheKey() :
+			options(0), house_id(0), floor(-1), tile_generation(0), texture_generation(0) {
+			////
+		}
+
+		bool operator!=(const ChunkCacheKey& other) const {
+			return options != other.options || house_id != other.house_id || floor != other.floor || tile_generation != other.tile_generation || texture_generation != other.texture_generation;
+		}
+
+		uint32_t options;
+		uint32_t house_id;
+		int floor;
+		uint32_t tile_generation;
+		// Only changes when all sprites are unloaded, single evictions are
+		// caught when a chunk is replayed
+		uint32_t texture_generation;
+	};
+
+	std::unordered_map<uint64_t, TileChunk> chunk_cache;
+	ChunkCacheKey chunk_cache_key;
+	uint32_t frame_count;
+
+	// Where sprites were last prefetched for, in tiles
+	int prefetch_x, prefetch_y;
+	int prefetch_floor;
+
 protected:
 	std::vector<MapTooltip*> tooltips;
 	std::ostringstream tooltip;
@@ -137,12 +191,18 @@ public:
 	void DrawGrid();
 	void DrawTooltips();
 	void DrawLight();
+	// Queues the sprites around the view for decoding in the background
+	void PrefetchSprites();
 
 	void TakeScreenshot(uint8_t* screenshot_buffer);
 
 	DrawingOptions& getOptions() {
 		return options;
 	}
+	// Draw calls, quads and texture binds of the last frame
+	const SpriteBatch::Stats& getFrameStats() const {
+		return batch.getStats();
+	}
 
 	MapViewInfo getViewInfo() const;
 	bool drawOverlayCommands(const std::vector<MapOverlayCommand>& commands);
@@ -157,7 +217,10 @@ protected:
 	void BlitCreature(int screenx, int screeny, const Outfit& outfit, Direction dir, int red = 255, int green = 255, int blue = 255, int alpha = 255);
 	void BlitSquare(int sx, int sy, int red, int green, int blue, int alpha, int size = 0);
 	void DrawRawBrush(int screenx, int screeny, ItemType* itemType, uint8_t r, uint8_t g, uint8_t b, uint8_t alpha);
+	void DrawTileColor(int draw_x, int draw_y, const Tile* tile, uint8_t r, uint8_t g, uint8_t b);
 	void DrawTile(TileLocation* tile);
+	void DrawTileChunk(Floor* chunk_floor);
+	ChunkCacheKey getChunkCacheKey() const;
 	void DrawBrushIndicator(int x, int y, Brush* brush, uint8_t r, uint8_t g, uint8_t b);
 	void DrawHookIndicator(int x, int y, const ItemType& type);
 	void WriteTooltip(Item* item, std::ostringstream& stream, bool isHouseTile = false);
@@ -177,7 +240,7 @@ protected:
 	};
 
 	void getColor(Brush* brush, const Position& position, uint8_t& r, uint8_t& g, uint8_t& b);
-	void glBlitTexture(int sx, int sy, int texture_number, int red, int green, int blue, int alpha);
+	void glBlitTexture(int sx, int sy, const AtlasRegion* region, int red, int green, int blue, int alpha);
 	void glBlitSquare(int sx, int sy, int red, int green, int blue, int alpha, int size = 0);
 	void glColor(wxColor color);
 	void glColor(BrushColor color);
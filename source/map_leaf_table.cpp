@@ -0,0 +1,52 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+
+#include "main.h"
+
+#include "map_leaf_table.h"
+
+QTreeLeafTable::QTreeLeafTable() {
+	for (uint32_t i = 0; i < DIRECTORY_SIZE; ++i) {
+		columns[i] = nullptr;
+	}
+}
+
+QTreeLeafTable::~QTreeLeafTable() {
+	for (uint32_t i = 0; i < DIRECTORY_SIZE; ++i) {
+		if (Page** column = columns[i]) {
+			for (uint32_t j = 0; j < DIRECTORY_SIZE; ++j) {
+				delete column[j];
+			}
+			delete[] column;
+		}
+	}
+}
+
+void QTreeLeafTable::set(int x, int y, QTreeNode* leaf) {
+	uint32_t ux = uint32_t(x) & 0xFFFF;
+	uint32_t uy = uint32_t(y) & 0xFFFF;
+	Page**& column = columns[ux >> PAGE_BITS];
+	if (!column) {
+		column = newd Page*[DIRECTORY_SIZE]();
+	}
+	Page*& page = column[uy >> PAGE_BITS];
+	if (!page) {
+		page = newd Page();
+	}
+	page->leaves[leafIndex(ux, uy)] = leaf;
+}
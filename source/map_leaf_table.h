@@ -0,0 +1,71 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+
+#ifndef RME_MAP_LEAF_TABLE_H
+#define RME_MAP_LEAF_TABLE_H
+
+#include <cstdint>
+
+class QTreeNode;
+
+// Flat page table from tile coordinates to the QTreeNode leaf covering them,
+// so tile lookups don't have to descend the tree. A page covers 64x64 tiles
+// (16x16 leaves), pages are allocated on demand. Leaves are never removed
+// from the tree while the map is alive, so entries are only ever added.
+class QTreeLeafTable {
+public:
+	QTreeLeafTable();
+	~QTreeLeafTable();
+
+	QTreeLeafTable(const QTreeLeafTable&) = delete;
+	QTreeLeafTable& operator=(const QTreeLeafTable&) = delete;
+
+	// Coordinates wrap at 16 bits, just like the tree
+	QTreeNode* get(int x, int y) const {
+		uint32_t ux = uint32_t(x) & 0xFFFF;
+		uint32_t uy = uint32_t(y) & 0xFFFF;
+		Page* const* column = columns[ux >> PAGE_BITS];
+		if (!column) {
+			return nullptr;
+		}
+		const Page* page = column[uy >> PAGE_BITS];
+		if (!page) {
+			return nullptr;
+		}
+		return page->leaves[leafIndex(ux, uy)];
+	}
+	void set(int x, int y, QTreeNode* leaf);
+
+private:
+	static const uint32_t PAGE_BITS = 6;
+	static const uint32_t LEAF_BITS = 2;
+	static const uint32_t PAGE_LEAVES = 1 << (PAGE_BITS - LEAF_BITS);
+	static const uint32_t DIRECTORY_SIZE = 1 << (16 - PAGE_BITS);
+
+	struct Page {
+		QTreeNode* leaves[PAGE_LEAVES * PAGE_LEAVES];
+	};
+
+	static uint32_t leafIndex(uint32_t ux, uint32_t uy) {
+		return ((ux >> LEAF_BITS) & (PAGE_LEAVES - 1)) * PAGE_LEAVES + ((uy >> LEAF_BITS) & (PAGE_LEAVES - 1));
+	}
+
+	Page** columns[DIRECTORY_SIZE];
+};
+
+#endif
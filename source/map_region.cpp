@@ -27,6 +27,7 @@
 TileLocation::TileLocation() :
 	tile(nullptr),
 	position(0, 0, 0),
+	revision(0),
 	spawn_count(0),
 	waypoint_count(0),
 	town_count(0),
@@ -78,11 +79,11 @@ QTreeNode::QTreeNode(BaseMap& map) :
 QTreeNode::~QTreeNode() {
 	if (isLeaf) {
 		for (int i = 0; i < MAP_LAYERS; ++i) {
-			delete array[i];
+			map.allocator.freeFloor(array[i]);
 		}
 	} else {
 		for (int i = 0; i < MAP_LAYERS; ++i) {
-			delete child[i];
+			map.allocator.freeNode(child[i]);
 		}
 	}
 }
@@ -122,11 +123,11 @@ QTreeNode* QTreeNode::getLeafForce(int x, int y) {
 
 		} else {
 			if (level == 0) {
-				qt = newd QTreeNode(map);
+				qt = map.allocator.allocateNode(map);
 				qt->isLeaf = true;
 				return qt;
 			} else {
-				qt = newd QTreeNode(map);
+				qt = map.allocator.allocateNode(map);
 			}
 		}
 		node = node->child[index];
@@ -141,7 +142,7 @@ QTreeNode* QTreeNode::getLeafForce(int x, int y) {
 Floor* QTreeNode::createFloor(int x, int y, int z) {
 	ASSERT(isLeaf);
 	if (!array[z]) {
-		array[z] = newd Floor(x, y, z);
+		array[z] = map.allocator.allocateFloor(x, y, z);
 	}
 	return array[z];
 }
@@ -235,6 +236,7 @@ Tile* QTreeNode::setTile(int x, int y, int z, Tile* newtile) {
 	TileLocation* tmp = &f->locs[offset_x * 4 + offset_y];
 	Tile* oldtile = tmp->tile;
 	tmp->tile = newtile;
+	++tmp->revision;
 
 	if (newtile && !oldtile) {
 		++map.tilecount;
@@ -255,4 +257,5 @@ void QTreeNode::clearTile(int x, int y, int z) {
 	TileLocation* tmp = &f->locs[offset_x * 4 + offset_y];
 	delete tmp->tile;
 	tmp->tile = map.allocator(tmp);
+	++tmp->revision;
 }
@@ -36,6 +36,8 @@ public:
 protected:
 	Tile* tile;
 	Position position;
+	// Increased whenever anything that is drawn on this location changes
+	uint32_t revision;
 	size_t spawn_count;
 	size_t waypoint_count;
 	size_t town_count;
@@ -71,29 +73,42 @@ public:
 	size_t getSpawnCount() const {
 		return spawn_count;
 	}
+	uint32_t getRevision() const {
+		return revision;
+	}
+	void touch() {
+		++revision;
+	}
+
 	void increaseSpawnCount() {
 		spawn_count++;
+		++revision;
 	}
 	void decreaseSpawnCount() {
 		spawn_count--;
+		++revision;
 	}
 	size_t getWaypointCount() const {
 		return waypoint_count;
 	}
 	void increaseWaypointCount() {
 		waypoint_count++;
+		++revision;
 	}
 	void decreaseWaypointCount() {
 		waypoint_count--;
+		++revision;
 	}
 	size_t getTownCount() const {
 		return town_count;
 	}
 	void increaseTownCount() {
 		town_count++;
+		++revision;
 	}
 	void decreaseTownCount() {
 		town_count--;
+		++revision;
 	}
 	HouseExitList* createHouseExits() {
 		if (house_exits) {
@@ -79,6 +79,16 @@ wxNotebookPage* PreferencesWindow::CreateGeneralPage() {
 	always_make_backup_chkbox->SetValue(g_settings.getInteger(Config::ALWAYS_MAKE_BACKUP) == 1);
 	sizer->Add(always_make_backup_chkbox, 0, wxLEFT | wxTOP, 5);
 
+	incremental_save_chkbox = newd wxCheckBox(general_page, wxID_ANY, "Reuse unchanged areas when saving");
+	incremental_save_chkbox->SetValue(g_settings.getInteger(Config::INCREMENTAL_SAVE) == 1);
+	SetWindowToolTip(incremental_save_chkbox, "Keeps the encoded data of unchanged map areas in memory so that saving only re-encodes the areas that were edited.");
+	sizer->Add(incremental_save_chkbox, 0, wxLEFT | wxTOP, 5);
+
+	lazy_map_loading_chkbox = newd wxCheckBox(general_page, wxID_ANY, "Load map areas on demand");
+	lazy_map_loading_chkbox->SetValue(g_settings.getInteger(Config::LAZY_MAP_LOADING) == 1);
+	SetWindowToolTip(lazy_map_loading_chkbox, "Saving writes an index of the map areas next to the map (.otbm.idx). Maps that have one are opened without loading any tiles, areas are loaded once they are viewed, selected or searched.");
+	sizer->Add(lazy_map_loading_chkbox, 0, wxLEFT | wxTOP, 5);
+
 	update_check_on_startup_chkbox = newd wxCheckBox(general_page, wxID_ANY, "Check for updates on startup");
 	update_check_on_startup_chkbox->SetValue(g_settings.getInteger(Config::USE_UPDATER) == 1);
 	sizer->Add(update_check_on_startup_chkbox, 0, wxLEFT | wxTOP, 5);
@@ -116,7 +126,7 @@ wxNotebookPage* PreferencesWindow::CreateGeneralPage() {
 	grid_sizer->Add(tmptext = newd wxStaticText(general_page, wxID_ANY, "Replace count: "), 0);
 	replace_size_spin = newd wxSpinCtrl(general_page, wxID_ANY, i2ws(g_settings.getInteger(Config::REPLACE_SIZE)), wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 0, 100000);
 	grid_sizer->Add(replace_size_spin, 0);
-	SetWindowToolTip(tmptext, replace_size_spin, "How many items you can replace on the map using the Replace Item tool.");
+	SetWindowToolTip(tmptext, replace_size_spin, "How many items Find Item and Replace Items look for at most, 0 for no limit.");
 
 	sizer->Add(grid_sizer, 0, wxALL, 5);
 	sizer->AddSpacer(10);
@@ -220,6 +230,16 @@ wxNotebookPage* PreferencesWindow::CreateGraphicsPage() {
 	sizer->Add(use_memcached_chkbox, 0, wxLEFT | wxTOP, 5);
 	SetWindowToolTip(use_memcached_chkbox, "When this is checked, sprites will be loaded into memory at startup and unpacked at runtime. This is faster but consumes more memory.\nIf it is not checked, the editor will use less memory but there will be a performance decrease due to reading sprites from the disk.");
 
+	use_mapped_chkbox = newd wxCheckBox(graphics_page, wxID_ANY, "Map sprite file into memory");
+	use_mapped_chkbox->SetValue(g_settings.getBoolean(Config::USE_MAPPED_SPRITES));
+	sizer->Add(use_mapped_chkbox, 0, wxLEFT | wxTOP, 5);
+	SetWindowToolTip(use_mapped_chkbox, "When this is checked and memcached sprites are not used, sprites are read straight from a memory mapping of the sprite file.\nThis starts as fast as reading sprites from the disk, while the system keeps the sprites that are in use in memory.");
+
+	show_texture_stats_chkbox = newd wxCheckBox(graphics_page, wxID_ANY, "Show texture statistics");
+	show_texture_stats_chkbox->SetValue(g_settings.getBoolean(Config::SHOW_TEXTURE_STATS));
+	sizer->Add(show_texture_stats_chkbox, 0, wxLEFT | wxTOP, 5);
+	SetWindowToolTip(show_texture_stats_chkbox, "When this is checked, the status bar shows how much memory textures use, how often drawn sprites were already loaded and how many are freed per second.\nUse this to pick the texture memory budget.");
+
 	sizer->AddSpacer(10);
 
 	auto* subsizer = newd wxFlexGridSizer(2, 10, 10);
@@ -281,6 +301,17 @@ wxNotebookPage* PreferencesWindow::CreateGraphicsPage() {
 	subsizer->Add(screenshot_format_choice, 0);
 	SetWindowToolTip(screenshot_format_choice, tmp, "This will affect the screenshot format used by the editor.\nTo take a screenshot, press F11.");
 
+	// Memory budgets
+	subsizer->Add(tmp = newd wxStaticText(graphics_page, wxID_ANY, "Texture memory budget (MB): "), 0);
+	texture_budget_spin = newd wxSpinCtrl(graphics_page, wxID_ANY, i2ws(g_settings.getInteger(Config::TEXTURE_MEMORY_BUDGET)), wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 16, 0x10000);
+	subsizer->Add(texture_budget_spin, 0);
+	SetWindowToolTip(texture_budget_spin, tmp, "How much memory textures and sprite data may use before the least recently used ones are freed.");
+
+	subsizer->Add(tmp = newd wxStaticText(graphics_page, wxID_ANY, "Software memory budget (MB): "), 0);
+	software_budget_spin = newd wxSpinCtrl(graphics_page, wxID_ANY, i2ws(g_settings.getInteger(Config::SOFTWARE_MEMORY_BUDGET)), wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 1, 0x10000);
+	subsizer->Add(software_budget_spin, 0);
+	SetWindowToolTip(software_budget_spin, tmp, "How much memory the GUI sprites (icons) may use before the least recently used ones are freed.");
+
 	sizer->Add(subsizer, 1, wxEXPAND | wxALL, 5);
 
 	// Advanced g_settings
@@ -298,31 +329,6 @@ wxNotebookPage* PreferencesWindow::CreateGraphicsPage() {
 		wxFlexGridSizer* pane_grid_sizer = newd wxFlexGridSizer(2, 10, 10);
 		pane_grid_sizer->AddGrowableCol(1);
 
-		pane_grid_sizer->Add(tmp = newd wxStaticText(pane->GetPane(), wxID_ANY, "Texture clean interval: "), 0);
-		clean_interval_spin = newd wxSpinCtrl(pane->GetPane(), wxID_ANY, i2ws(g_settings.getInteger(Config::TEXTURE_CLEAN_PULSE)), wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 0, 0x1000000);
-		pane_grid_sizer->Add(clean_interval_spin, 0);
-		SetWindowToolTip(clean_interval_spin, tmp, "This controls how often the editor tries to free hardware texture resources.");
-
-		pane_grid_sizer->Add(tmp = newd wxStaticText(pane->GetPane(), wxID_ANY, "Texture longevity: "), 0);
-		texture_longevity_spin = newd wxSpinCtrl(pane->GetPane(), wxID_ANY, i2ws(g_settings.getInteger(Config::TEXTURE_LONGEVITY)), wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 0, 0x1000000);
-		pane_grid_sizer->Add(texture_longevity_spin, 0);
-		SetWindowToolTip(texture_longevity_spin, tmp, "This controls for how long (in seconds) that the editor will keep textures in memory before it cleans them up.");
-
-		pane_grid_sizer->Add(tmp = newd wxStaticText(pane->GetPane(), wxID_ANY, "Texture clean threshold: "), 0);
-		texture_threshold_spin = newd wxSpinCtrl(pane->GetPane(), wxID_ANY, i2ws(g_settings.getInteger(Config::TEXTURE_CLEAN_THRESHOLD)), wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 100, 0x1000000);
-		pane_grid_sizer->Add(texture_threshold_spin, 0);
-		SetWindowToolTip(texture_threshold_spin, tmp, "This controls how many textures the editor will hold in memory before it attempts to clean up old textures. However, an infinite amount MIGHT be loaded.");
-
-		pane_grid_sizer->Add(tmp = newd wxStaticText(pane->GetPane(), wxID_ANY, "Software clean threshold: "), 0);
-		software_threshold_spin = newd wxSpinCtrl(pane->GetPane(), wxID_ANY, i2ws(g_settings.getInteger(Config::SOFTWARE_CLEAN_THRESHOLD)), wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 100, 0x1000000);
-		pane_grid_sizer->Add(software_threshold_spin, 0);
-		SetWindowToolTip(software_threshold_spin, tmp, "This controls how many GUI sprites (icons) the editor will hold in memory at the same time.");
-
-		pane_grid_sizer->Add(tmp = newd wxStaticText(pane->GetPane(), wxID_ANY, "Software clean amount: "), 0);
-		software_clean_amount_spin = newd wxSpinCtrl(pane->GetPane(), wxID_ANY, i2ws(g_settings.getInteger(Config::SOFTWARE_CLEAN_SIZE)), wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 1, 0x1000000);
-		pane_grid_sizer->Add(software_clean_amount_spin, 0);
-		SetWindowToolTip(software_clean_amount_spin, tmp, "How many sprites the editor will free at once when the limit is exceeded.");
-
 		pane_sizer->Add(pane_grid_sizer, 0, wxEXPAND);
 
 		pane->GetPane()->SetSizerAndFit(pane_sizer);
@@ -585,6 +591,8 @@ void PreferencesWindow::Apply() {
 	// General
 	g_settings.setInteger(Config::WELCOME_DIALOG, show_welcome_dialog_chkbox->GetValue());
 	g_settings.setInteger(Config::ALWAYS_MAKE_BACKUP, always_make_backup_chkbox->GetValue());
+	g_settings.setInteger(Config::INCREMENTAL_SAVE, incremental_save_chkbox->GetValue());
+	g_settings.setInteger(Config::LAZY_MAP_LOADING, lazy_map_loading_chkbox->GetValue());
 	g_settings.setInteger(Config::USE_UPDATER, update_check_on_startup_chkbox->GetValue());
 	g_settings.setInteger(Config::ONLY_ONE_INSTANCE, only_one_instance_chkbox->GetValue());
 	g_settings.setInteger(Config::UNDO_SIZE, undo_size_spin->GetValue());
@@ -616,6 +624,10 @@ void PreferencesWindow::Apply() {
 		must_restart = true;
 	}
 	g_settings.setInteger(Config::USE_MEMCACHED_SPRITES_TO_SAVE, use_memcached_chkbox->GetValue());
+	if (g_settings.getBoolean(Config::USE_MAPPED_SPRITES) != use_mapped_chkbox->GetValue()) {
+		must_restart = true;
+	}
+	g_settings.setInteger(Config::USE_MAPPED_SPRITES_TO_SAVE, use_mapped_chkbox->GetValue());
 	if (icon_background_choice->GetSelection() == 0) {
 		if (g_settings.getInteger(Config::ICON_BACKGROUND) != 0) {
 			g_gui.gfx.cleanSoftwareSprites();
@@ -660,13 +672,11 @@ void PreferencesWindow::Apply() {
 	// g_settings.setInteger(Config::CURSOR_ALT_ALPHA, clr.Alpha());
 
 	g_settings.setInteger(Config::HIDE_ITEMS_WHEN_ZOOMED, hide_items_when_zoomed_chkbox->GetValue());
+	g_settings.setInteger(Config::TEXTURE_MEMORY_BUDGET, texture_budget_spin->GetValue());
+	g_settings.setInteger(Config::SOFTWARE_MEMORY_BUDGET, software_budget_spin->GetValue());
+	g_settings.setInteger(Config::SHOW_TEXTURE_STATS, show_texture_stats_chkbox->GetValue());
 	/*
 	g_settings.setInteger(Config::TEXTURE_MANAGEMENT, texture_managment_chkbox->GetValue());
-	g_settings.setInteger(Config::TEXTURE_CLEAN_PULSE, clean_interval_spin->GetValue());
-	g_settings.setInteger(Config::TEXTURE_LONGEVITY, texture_longevity_spin->GetValue());
-	g_settings.setInteger(Config::TEXTURE_CLEAN_THRESHOLD, texture_threshold_spin->GetValue());
-	g_settings.setInteger(Config::SOFTWARE_CLEAN_THRESHOLD, software_threshold_spin->GetValue());
-	g_settings.setInteger(Config::SOFTWARE_CLEAN_SIZE, software_clean_amount_spin->GetValue());
 	*/
 
 	// Interface
@@ -45,6 +45,8 @@ protected:
 
 	// General
 	wxCheckBox* always_make_backup_chkbox;
+	wxCheckBox* incremental_save_chkbox;
+	wxCheckBox* lazy_map_loading_chkbox;
 	wxCheckBox* create_on_startup_chkbox;
 	wxCheckBox* update_check_on_startup_chkbox;
 	wxCheckBox* only_one_instance_chkbox;
@@ -72,18 +74,17 @@ protected:
 	wxCheckBox* icon_selection_shadow_chkbox;
 	wxChoice* icon_background_choice;
 	wxCheckBox* use_memcached_chkbox;
+	wxCheckBox* use_mapped_chkbox;
 	wxDirPickerCtrl* screenshot_directory_picker;
 	wxChoice* screenshot_format_choice;
 	wxCheckBox* hide_items_when_zoomed_chkbox;
 	wxColourPickerCtrl* cursor_color_pick;
 	wxColourPickerCtrl* cursor_alt_color_pick;
+	wxSpinCtrl* texture_budget_spin;
+	wxSpinCtrl* software_budget_spin;
+	wxCheckBox* show_texture_stats_chkbox;
 	/*
 	wxCheckBox* texture_managment_chkbox;
-	wxSpinCtrl* clean_interval_spin;
-	wxSpinCtrl* texture_longevity_spin;
-	wxSpinCtrl* texture_threshold_spin;
-	wxSpinCtrl* software_threshold_spin;
-	wxSpinCtrl* software_clean_amount_spin;
 	*/
 
 	// Interface
@@ -332,13 +332,19 @@ void ReplaceItemsDialog::OnExecuteButtonClicked(wxCommandEvent& WXUNUSED(event))
 
 	int done = 0;
 	for (const ReplacingItem& info : items) {
-		ItemFinder finder(info.replaceId, (uint32_t)g_settings.getInteger(Config::REPLACE_SIZE));
+		const int32_t limit = g_settings.getInteger(Config::REPLACE_SIZE);
+		std::vector<std::pair<Tile*, Item*>> result;
 
 		// search on map
-		foreach_ItemOnMap(editor->map, finder, selectionOnly);
+		if (selectionOnly) {
+			ItemFinder finder(info.replaceId, limit);
+			foreach_ItemOnMap(editor->map, finder, true);
+			result = std::move(finder.result);
+		} else {
+			result = editor->map.item_index.find(editor->map, { ItemIndex::makeKey(ItemIndex::ITEM_ID, info.replaceId) }, limit > 0 ? size_t(limit) : 0);
+		}
 
 		uint32_t total = 0;
-		std::vector<std::pair<Tile*, Item*>>& result = finder.result;
 
 		if (!result.empty()) {
 			Action* action = editor->actionQueue->createAction(ACTION_REPLACE_ITEMS);
@@ -102,6 +102,18 @@ struct ItemFinder {
 		}
 	}
 
+	void merge(const ItemFinder& other) {
+		for (const auto& found : other.result) {
+			if (exceeded) {
+				break;
+			}
+			result.push_back(found);
+			if (limit > 0 && result.size() >= size_t(limit)) {
+				exceeded = true;
+			}
+		}
+	}
+
 	std::vector<std::pair<Tile*, Item*>> result;
 
 private:
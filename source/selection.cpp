@@ -217,6 +217,10 @@ void Selection::clear() {
 	} else {
 		for (TileSet::iterator it = tiles.begin(); it != tiles.end(); it++) {
 			(*it)->deselect();
+			// Deselected in place, so redraw the location
+			if ((*it)->getLocation()) {
+				(*it)->getLocation()->touch();
+			}
 		}
 		tiles.clear();
 	}
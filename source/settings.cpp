@@ -260,6 +260,8 @@ void Settings::IO(IOMode mode) {
 	Int(BORDERIZE_DRAG_THRESHOLD, 6000);
 	Int(BORDERIZE_PASTE_THRESHOLD, 10000);
 	Int(ALWAYS_MAKE_BACKUP, 0);
+	Int(INCREMENTAL_SAVE, 1);
+	Int(LAZY_MAP_LOADING, 0);
 	Int(USE_AUTOMAGIC, 1);
 	Int(HOUSE_BRUSH_REMOVE_ITEMS, 0);
 	Int(AUTO_ASSIGN_DOORID, 1);
@@ -282,17 +284,16 @@ void Settings::IO(IOMode mode) {
 
 	section("Graphics");
 	Int(TEXTURE_MANAGEMENT, 1);
-	Int(TEXTURE_CLEAN_PULSE, 15);
-	Int(TEXTURE_LONGEVITY, 20);
-	Int(TEXTURE_CLEAN_THRESHOLD, 2500);
-	Int(SOFTWARE_CLEAN_THRESHOLD, 1800);
-	Int(SOFTWARE_CLEAN_SIZE, 500);
+	Int(TEXTURE_MEMORY_BUDGET, 256);
+	Int(SOFTWARE_MEMORY_BUDGET, 16);
+	Int(SHOW_TEXTURE_STATS, 0);
 	Int(ICON_BACKGROUND, 0);
 	Int(HARD_REFRESH_RATE, 200);
 	Int(HIDE_ITEMS_WHEN_ZOOMED, 1);
 	String(SCREENSHOT_DIRECTORY, "");
 	String(SCREENSHOT_FORMAT, "png");
 	IntToSave(USE_MEMCACHED_SPRITES, 0);
+	IntToSave(USE_MAPPED_SPRITES, 1);
 	Int(MINIMAP_UPDATE_DELAY, 333);
 	Int(MINIMAP_VIEW_BOX, 1);
 	String(MINIMAP_EXPORT_DIR, "");
@@ -31,14 +31,14 @@ namespace Config {
 
 		MERGE_MOVE,
 		TEXTURE_MANAGEMENT,
-		TEXTURE_CLEAN_PULSE,
-		TEXTURE_CLEAN_THRESHOLD,
-		TEXTURE_LONGEVITY,
+		TEXTURE_MEMORY_BUDGET,
 		HARD_REFRESH_RATE,
 		USE_MEMCACHED_SPRITES,
 		USE_MEMCACHED_SPRITES_TO_SAVE,
-		SOFTWARE_CLEAN_THRESHOLD,
-		SOFTWARE_CLEAN_SIZE,
+		USE_MAPPED_SPRITES,
+		USE_MAPPED_SPRITES_TO_SAVE,
+		SOFTWARE_MEMORY_BUDGET,
+		SHOW_TEXTURE_STATS,
 		TRANSPARENT_FLOORS,
 		TRANSPARENT_ITEMS,
 		SHOW_INGAME_BOX,
@@ -75,6 +75,8 @@ namespace Config {
 		BORDERIZE_PASTE_THRESHOLD,
 		ICON_BACKGROUND,
 		ALWAYS_MAKE_BACKUP,
+		INCREMENTAL_SAVE,
+		LAZY_MAP_LOADING,
 		USE_AUTOMAGIC,
 		HOUSE_BRUSH_REMOVE_ITEMS,
 		AUTO_ASSIGN_DOORID,
@@ -0,0 +1,191 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+
+#include "main.h"
+
+#include "sprite_batch.h"
+#include "texture_atlas.h"
+
+// Keeps a single draw call within what every driver handles well
+static const size_t MAX_BATCH_QUADS = 4096;
+
+SpriteBatch::SpriteBatch() :
+	recording(nullptr),
+	texture(0),
+	bound_texture(0),
+	textured(false) {
+	vertices.reserve(MAX_BATCH_QUADS * 4);
+}
+
+void SpriteBatch::begin() {
+	vertices.clear();
+	recording = nullptr;
+	stats = Stats();
+	reset();
+}
+
+void SpriteBatch::reset() {
+	flush();
+	texture = 0;
+	bound_texture = 0;
+	textured = false;
+	glDisable(GL_TEXTURE_2D);
+}
+
+void SpriteBatch::flush() {
+	if (vertices.empty()) {
+		return;
+	}
+
+	if (textured && texture != 0 && texture != bound_texture) {
+		glBindTexture(GL_TEXTURE_2D, texture);
+		bound_texture = texture;
+		++stats.binds;
+	}
+
+	const Vertex* data = vertices.data();
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glVertexPointer(2, GL_FLOAT, sizeof(Vertex), &data->x);
+	glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), data->color);
+	if (textured) {
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), &data->u);
+	}
+
+	glDrawArrays(GL_QUADS, 0, GLsizei(vertices.size()));
+
+	if (textured) {
+		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	}
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+
+	++stats.draw_calls;
+	stats.quads += vertices.size() / 4;
+	vertices.clear();
+}
+
+void SpriteBatch::setTextured(bool textured) {
+	if (this->textured == textured) {
+		return;
+	}
+
+	flush();
+	this->textured = textured;
+	if (textured) {
+		glEnable(GL_TEXTURE_2D);
+	} else {
+		glDisable(GL_TEXTURE_2D);
+	}
+}
+
+void SpriteBatch::addQuad(float x, float y, float width, float height, const AtlasRegion* region, uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha) {
+	float u0 = 0.f, v0 = 0.f, u1 = 0.f, v1 = 0.f;
+	if (region) {
+		u0 = region->u0;
+		v0 = region->v0;
+		u1 = region->u1;
+		v1 = region->v1;
+	}
+
+	Vertex quad[4];
+	setVertex(quad[0], x, y, u0, v0, red, green, blue, alpha);
+	setVertex(quad[1], x + width, y, u1, v0, red, green, blue, alpha);
+	setVertex(quad[2], x + width, y + height, u1, v1, red, green, blue, alpha);
+	setVertex(quad[3], x, y + height, u0, v1, red, green, blue, alpha);
+	pushQuad(quad, region ? region->texture : 0, region);
+}
+
+void SpriteBatch::addQuad(const float (&corners)[4][2], uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha) {
+	Vertex quad[4];
+	for (int i = 0; i < 4; ++i) {
+		setVertex(quad[i], corners[i][0], corners[i][1], 0.f, 0.f, red, green, blue, alpha);
+	}
+	pushQuad(quad, 0, nullptr);
+}
+
+void SpriteBatch::startRecording(Recording& recording) {
+	this->recording = &recording;
+}
+
+void SpriteBatch::stopRecording() {
+	recording = nullptr;
+}
+
+bool SpriteBatch::replay(const Recording& recording, float offset_x, float offset_y) {
+	for (const RecordedQuad& recorded : recording) {
+		const AtlasRegion* region = recorded.region;
+		if (region && (region->texture != recorded.texture || region->page != recorded.page || region->slot != recorded.slot)) {
+			return false;
+		}
+	}
+
+	for (const RecordedQuad& recorded : recording) {
+		if (recorded.region && recorded.region->owner) {
+			recorded.region->owner->visit();
+		}
+		setTextured(recorded.textured);
+
+		Vertex quad[4];
+		for (int i = 0; i < 4; ++i) {
+			quad[i] = recorded.vertices[i];
+			quad[i].x += offset_x;
+			quad[i].y += offset_y;
+		}
+		pushQuad(quad, recorded.texture, recorded.region);
+	}
+	return true;
+}
+
+void SpriteBatch::setVertex(Vertex& vertex, float x, float y, float u, float v, uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha) {
+	vertex.x = x;
+	vertex.y = y;
+	vertex.u = u;
+	vertex.v = v;
+	vertex.color[0] = red;
+	vertex.color[1] = green;
+	vertex.color[2] = blue;
+	vertex.color[3] = alpha;
+}
+
+void SpriteBatch::pushQuad(const Vertex (&quad)[4], GLuint quad_texture, const AtlasRegion* region) {
+	// Quads without a texture of their own draw with whatever is bound
+	if (textured && quad_texture != 0 && quad_texture != texture) {
+		if (texture != 0) {
+			flush();
+		}
+		texture = quad_texture;
+	}
+
+	if (vertices.size() >= MAX_BATCH_QUADS * 4) {
+		flush();
+	}
+	vertices.insert(vertices.end(), quad, quad + 4);
+
+	if (recording) {
+		recording->emplace_back();
+		RecordedQuad& recorded = recording->back();
+		recorded.region = region;
+		recorded.page = region ? region->page : 0;
+		recorded.slot = region ? region->slot : 0;
+		recorded.texture = quad_texture;
+		recorded.textured = textured;
+		std::copy(quad, quad + 4, recorded.vertices);
+	}
+}
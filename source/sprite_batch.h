@@ -0,0 +1,103 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+
+#ifndef RME_SPRITE_BATCH_H_
+#define RME_SPRITE_BATCH_H_
+
+struct AtlasRegion;
+
+// Collects the quads of a frame into a vertex array and draws every run
+// that shares a texture with a single call, in the order they were added.
+// Any immediate mode drawing in between must flush the batch first.
+class SpriteBatch : boost::noncopyable {
+public:
+	struct Stats {
+		Stats() :
+			draw_calls(0), quads(0), binds(0) {
+			////
+		}
+
+		size_t draw_calls;
+		size_t quads;
+		size_t binds;
+	};
+
+	struct Vertex {
+		float x, y;
+		float u, v;
+		uint8_t color[4];
+	};
+
+	// A quad as it was added, so it can be added again later
+	struct RecordedQuad {
+		// Where the texture came from, and where it was in the atlas then
+		const AtlasRegion* region;
+		uint32_t page;
+		uint32_t slot;
+		GLuint texture;
+		bool textured;
+		Vertex vertices[4];
+	};
+	typedef std::vector<RecordedQuad> Recording;
+
+	SpriteBatch();
+
+	// Starts a frame, texturing is disabled and nothing is bound
+	void begin();
+	// Call after other code has bound textures or toggled texturing
+	void reset();
+	void flush();
+
+	// Flushes and enables/disables GL_TEXTURE_2D if it changes
+	void setTextured(bool textured);
+	bool isTextured() const noexcept {
+		return textured;
+	}
+
+	// A null region draws a plain colored quad
+	void addQuad(float x, float y, float width, float height, const AtlasRegion* region, uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha);
+	// Plain colored quad with arbitrary corners, in drawing order
+	void addQuad(const float (&corners)[4][2], uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha);
+
+	// Copies every quad added until stopRecording() into the recording
+	void startRecording(Recording& recording);
+	void stopRecording();
+	// Adds the recorded quads again, moved by the offset, and tells the owners
+	// of their regions that they are still in use. Adds nothing and returns
+	// false if any of the regions has been removed or moved since.
+	bool replay(const Recording& recording, float offset_x, float offset_y);
+
+	// Counters since the last begin()
+	const Stats& getStats() const noexcept {
+		return stats;
+	}
+
+protected:
+	void setVertex(Vertex& vertex, float x, float y, float u, float v, uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha);
+	void pushQuad(const Vertex (&quad)[4], GLuint quad_texture, const AtlasRegion* region);
+
+	std::vector<Vertex> vertices;
+	Recording* recording;
+	Stats stats;
+	// Texture of the queued quads, 0 if none of them needs one
+	GLuint texture;
+	GLuint bound_texture;
+	bool textured;
+};
+
+#endif
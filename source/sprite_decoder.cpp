@@ -0,0 +1,116 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+
+#include "main.h"
+
+#include "sprite_decoder.h"
+#include "settings.h"
+
+// Requests past this are refused until the workers catch up
+static const size_t MAX_QUEUED_SPRITES = 8192;
+
+class SpriteDecoder::Worker : public JoinableThread {
+public:
+	explicit Worker(SpriteDecoder& decoder) :
+		decoder(decoder) { }
+
+protected:
+	virtual ExitCode Entry() {
+		std::unique_lock<std::mutex> lock(decoder.mutex);
+		while (true) {
+			decoder.job_queued.wait(lock, [this]() { return decoder.stopping || !decoder.queued.empty(); });
+			if (decoder.stopping) {
+				return nullptr;
+			}
+
+			const uint32_t id = decoder.queued.front();
+			decoder.queued.pop_front();
+			lock.unlock();
+			uint8_t* rgba = decoder.decode(id);
+			lock.lock();
+
+			Result result;
+			result.id = id;
+			result.rgba = rgba;
+			decoder.results.push_back(result);
+		}
+	}
+
+	SpriteDecoder& decoder;
+};
+
+SpriteDecoder::SpriteDecoder(const std::function<uint8_t*(uint32_t)>& decode) :
+	decode(decode),
+	stopping(false) {
+	////
+}
+
+SpriteDecoder::~SpriteDecoder() {
+	stop();
+}
+
+bool SpriteDecoder::request(uint32_t id) {
+	if (workers.empty()) {
+		int thread_count = std::max(g_settings.getInteger(Config::WORKER_THREADS), 1);
+		for (int i = 0; i < thread_count; ++i) {
+			Worker* worker = newd Worker(*this);
+			worker->Execute();
+			workers.push_back(worker);
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (queued.size() >= MAX_QUEUED_SPRITES) {
+		return false;
+	}
+	queued.push_back(id);
+	job_queued.notify_one();
+	return true;
+}
+
+bool SpriteDecoder::takeResult(uint32_t& id, uint8_t*& rgba) {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (results.empty()) {
+		return false;
+	}
+
+	id = results.back().id;
+	rgba = results.back().rgba;
+	results.pop_back();
+	return true;
+}
+
+void SpriteDecoder::stop() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		queued.clear();
+		job_queued.notify_all();
+	}
+	for (JoinableThread* worker : workers) {
+		worker->Wait();
+		delete worker;
+	}
+	workers.clear();
+
+	for (const Result& result : results) {
+		delete[] result.rgba;
+	}
+	results.clear();
+	stopping = false;
+}
@@ -0,0 +1,59 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+
+#ifndef RME_SPRITE_DECODER_H_
+#define RME_SPRITE_DECODER_H_
+
+#include "threads.h"
+
+#include <deque>
+
+// Decodes sprites into RGBA pixels on worker threads. Requests are made and
+// results taken on the GL thread, which uploads them from there.
+class SpriteDecoder : boost::noncopyable {
+public:
+	// decode(id) runs on a worker thread and returns the newd pixels of the
+	// sprite, or nullptr if it could not be read
+	explicit SpriteDecoder(const std::function<uint8_t*(uint32_t)>& decode);
+	~SpriteDecoder();
+
+	// Queues the sprite, false if too many are queued already
+	bool request(uint32_t id);
+	// Takes one decoded sprite, the pixels are owned by the caller
+	bool takeResult(uint32_t& id, uint8_t*& rgba);
+	// Drops all queued sprites and results and waits for the workers to exit
+	void stop();
+
+protected:
+	class Worker;
+
+	struct Result {
+		uint32_t id;
+		uint8_t* rgba;
+	};
+
+	std::function<uint8_t*(uint32_t)> decode;
+	std::deque<uint32_t> queued;
+	std::vector<Result> results;
+	bool stopping;
+	std::mutex mutex;
+	std::condition_variable job_queued;
+	std::vector<JoinableThread*> workers;
+};
+
+#endif
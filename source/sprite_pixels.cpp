@@ -0,0 +1,182 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+
+#include "main.h"
+
+#include "sprite_pixels.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define SPRITE_PIXELS_SSE2
+	#include <emmintrin.h>
+#endif
+#if defined(__SSSE3__) || defined(__AVX2__)
+	#define SPRITE_PIXELS_SSSE3
+	#include <tmmintrin.h>
+#endif
+
+namespace {
+	void fillMagenta(uint8_t* rgb, int pixels) {
+		int i = 0;
+#ifdef SPRITE_PIXELS_SSE2
+		// 16 pixels are 48 bytes, three vectors of the repeating pattern
+		const __m128i pattern0 = _mm_setr_epi8(-1, 0, -1, -1, 0, -1, -1, 0, -1, -1, 0, -1, -1, 0, -1, -1);
+		const __m128i pattern1 = _mm_setr_epi8(0, -1, -1, 0, -1, -1, 0, -1, -1, 0, -1, -1, 0, -1, -1, 0);
+		const __m128i pattern2 = _mm_setr_epi8(-1, -1, 0, -1, -1, 0, -1, -1, 0, -1, -1, 0, -1, -1, 0, -1);
+		for (; i + 16 <= pixels; i += 16) {
+			uint8_t* out = rgb + i * 3;
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out), pattern0);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), pattern1);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + 32), pattern2);
+		}
+#endif
+		for (; i < pixels; ++i) {
+			rgb[i * 3 + 0] = 0xFF;
+			rgb[i * 3 + 1] = 0x00;
+			rgb[i * 3 + 2] = 0xFF;
+		}
+	}
+
+	void expandRGBToRGBA(const uint8_t* in, uint8_t* out, int pixels) {
+		int i = 0;
+#ifdef SPRITE_PIXELS_SSSE3
+		// Loads 16 bytes for 4 pixels, so stop while 2 more pixels are left
+		const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+		const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+		for (; i + 6 <= pixels; i += 4) {
+			__m128i source = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 3));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 4), _mm_or_si128(_mm_shuffle_epi8(source, shuffle), alpha));
+		}
+#endif
+		for (; i < pixels; ++i) {
+			out[i * 4 + 0] = in[i * 3 + 0];
+			out[i * 4 + 1] = in[i * 3 + 1];
+			out[i * 4 + 2] = in[i * 3 + 2];
+			out[i * 4 + 3] = 0xFF;
+		}
+	}
+
+	void dropAlpha(const uint8_t* in, uint8_t* out, int pixels) {
+		int i = 0;
+#ifdef SPRITE_PIXELS_SSSE3
+		// Stores 16 bytes for 4 pixels, the rest is overwritten by the next ones
+		const __m128i shuffle = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+		for (; i + 6 <= pixels; i += 4) {
+			__m128i source = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 4));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 3), _mm_shuffle_epi8(source, shuffle));
+		}
+#endif
+		for (; i < pixels; ++i) {
+			out[i * 3 + 0] = in[i * 4 + 0];
+			out[i * 3 + 1] = in[i * 4 + 1];
+			out[i * 3 + 2] = in[i * 4 + 2];
+		}
+	}
+
+	// Walks the runs of the dump, calling copy(pixel, data, count) for every
+	// coloured run. Pixels outside of the runs are left as they are.
+	template <typename CopyRun>
+	void decodeRuns(const uint8_t* dump, uint16_t size, bool use_alpha, CopyRun copy) {
+		const int bpp = use_alpha ? 4 : 3;
+		int pixel = 0;
+		int read = 0;
+		while (read + 4 <= size && pixel < SPRITE_PIXELS_SIZE) {
+			int transparent = dump[read] | dump[read + 1] << 8;
+			if (use_alpha && transparent >= SPRITE_PIXELS_SIZE) { // Corrupted sprite?
+				break;
+			}
+			pixel += transparent;
+
+			int colored = dump[read + 2] | dump[read + 3] << 8;
+			read += 4;
+			colored = std::min(colored, std::max(SPRITE_PIXELS_SIZE - pixel, 0));
+			colored = std::min(colored, (size - read) / bpp);
+			copy(pixel, dump + read, colored);
+			pixel += colored;
+			read += colored * bpp;
+		}
+	}
+}
+
+void decodeSpriteRGBA(const uint8_t* dump, uint16_t size, bool use_alpha, uint8_t* rgba) {
+	memset(rgba, 0, SPRITE_PIXELS_SIZE * 4);
+	decodeRuns(dump, size, use_alpha, [rgba, use_alpha](int pixel, const uint8_t* data, int count) {
+		if (use_alpha) {
+			memcpy(rgba + pixel * 4, data, count * 4);
+		} else {
+			expandRGBToRGBA(data, rgba + pixel * 4, count);
+		}
+	});
+}
+
+void decodeSpriteRGB(const uint8_t* dump, uint16_t size, bool use_alpha, uint8_t* rgb) {
+	fillMagenta(rgb, SPRITE_PIXELS_SIZE);
+	decodeRuns(dump, size, use_alpha, [rgb, use_alpha](int pixel, const uint8_t* data, int count) {
+		if (use_alpha) {
+			dropAlpha(data, rgb + pixel * 3, count);
+		} else {
+			memcpy(rgb + pixel * 3, data, count * 3);
+		}
+	});
+}
+
+void colorizeTemplate(uint8_t* pixels, int bytes_per_pixel, const uint8_t* template_rgb, uint32_t head, uint32_t body, uint32_t legs, uint32_t feet) {
+	// What every byte is multiplied with, 255 keeps it as it is
+	uint8_t factors[SPRITE_PIXELS_SIZE * 4];
+	const int byte_count = SPRITE_PIXELS_SIZE * bytes_per_pixel;
+	memset(factors, 0xFF, byte_count);
+
+	for (int i = 0; i < SPRITE_PIXELS_SIZE; ++i) {
+		const uint8_t* mask = template_rgb + i * 3;
+		uint32_t color;
+		if (mask[0] && mask[1] && !mask[2]) { // yellow => head
+			color = head;
+		} else if (mask[0] && !mask[1] && !mask[2]) { // red => body
+			color = body;
+		} else if (!mask[0] && mask[1] && !mask[2]) { // green => legs
+			color = legs;
+		} else if (!mask[0] && !mask[1] && mask[2]) { // blue => feet
+			color = feet;
+		} else {
+			continue;
+		}
+
+		uint8_t* factor = factors + i * bytes_per_pixel;
+		factor[0] = (color >> 16) & 0xFF;
+		factor[1] = (color >> 8) & 0xFF;
+		factor[2] = color & 0xFF;
+	}
+
+	// x * f / 255 is (x * f * 0x8081) >> 23 for every x * f up to 255 * 255
+	int i = 0;
+#ifdef SPRITE_PIXELS_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i divide = _mm_set1_epi16(static_cast<short>(0x8081));
+	for (; i + 16 <= byte_count; i += 16) {
+		__m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + i));
+		__m128i factor = _mm_loadu_si128(reinterpret_cast<const __m128i*>(factors + i));
+		__m128i low = _mm_mullo_epi16(_mm_unpacklo_epi8(value, zero), _mm_unpacklo_epi8(factor, zero));
+		__m128i high = _mm_mullo_epi16(_mm_unpackhi_epi8(value, zero), _mm_unpackhi_epi8(factor, zero));
+		low = _mm_srli_epi16(_mm_mulhi_epu16(low, divide), 7);
+		high = _mm_srli_epi16(_mm_mulhi_epu16(high, divide), 7);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + i), _mm_packus_epi16(low, high));
+	}
+#endif
+	for (; i < byte_count; ++i) {
+		pixels[i] = static_cast<uint8_t>(pixels[i] * factors[i] / 255);
+	}
+}
@@ -0,0 +1,33 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+
+#ifndef RME_SPRITE_PIXELS_H_
+#define RME_SPRITE_PIXELS_H_
+
+// Decode the run length encoded pixels of a sprite dump into SPRITE_PIXELS_SIZE
+// pixels. Transparent pixels are all zero in RGBA and magenta in RGB. use_alpha
+// tells whether the coloured pixels in the dump carry an alpha byte.
+void decodeSpriteRGBA(const uint8_t* dump, uint16_t size, bool use_alpha, uint8_t* rgba);
+void decodeSpriteRGB(const uint8_t* dump, uint16_t size, bool use_alpha, uint8_t* rgb);
+
+// Multiplies the colour of each pixel by the outfit colour picked by its
+// template pixel, yellow for head, red for body, green for legs and blue for
+// feet. pixels is RGB or RGBA, the template is RGB and the colours 0xRRGGBB.
+void colorizeTemplate(uint8_t* pixels, int bytes_per_pixel, const uint8_t* template_rgb, uint32_t head, uint32_t body, uint32_t legs, uint32_t feet);
+
+#endif
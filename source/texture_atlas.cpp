@@ -0,0 +1,171 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+
+#include "main.h"
+
+#include "texture_atlas.h"
+
+TextureAtlas::TextureAtlas() :
+	page_size(0),
+	slots_per_row(0),
+	generation(0) {
+	////
+}
+
+TextureAtlas::~TextureAtlas() {
+	clear();
+}
+
+bool TextureAtlas::add(const uint8_t* rgba, AtlasRegion& region) {
+	// Uploads happen in the middle of drawing, leave the drawer's texture bound
+	GLint previous = 0;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+
+	size_t index = 0;
+	Page* page = nullptr;
+	for (; index < pages.size(); ++index) {
+		if (pages[index] && !pages[index]->free_slots.empty()) {
+			page = pages[index];
+			break;
+		}
+	}
+
+	if (!page) {
+		page = createPage();
+		if (!page) {
+			glBindTexture(GL_TEXTURE_2D, GLuint(previous));
+			return false;
+		}
+		// Fill a gap left by a deleted page first
+		index = std::find(pages.begin(), pages.end(), nullptr) - pages.begin();
+		if (index == pages.size()) {
+			pages.push_back(page);
+		} else {
+			pages[index] = page;
+		}
+	}
+
+	const uint32_t slot = page->free_slots.back();
+	page->free_slots.pop_back();
+	page->owners[slot] = region.owner;
+	++page->used;
+
+	const int x = (slot % slots_per_row) * SPRITE_PIXELS;
+	const int y = (slot / slots_per_row) * SPRITE_PIXELS;
+	glBindTexture(GL_TEXTURE_2D, page->texture);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, SPRITE_PIXELS, SPRITE_PIXELS, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+	glBindTexture(GL_TEXTURE_2D, GLuint(previous));
+
+	const float scale = 1.f / page_size;
+	region.texture = page->texture;
+	region.page = uint32_t(index);
+	region.slot = slot;
+	region.u0 = x * scale;
+	region.v0 = y * scale;
+	region.u1 = (x + SPRITE_PIXELS) * scale;
+	region.v1 = (y + SPRITE_PIXELS) * scale;
+	return true;
+}
+
+void TextureAtlas::remove(AtlasRegion& region) {
+	if (region.texture == 0 || region.page >= pages.size()) {
+		return;
+	}
+
+	Page*& page = pages[region.page];
+	if (page && page->texture == region.texture) {
+		page->free_slots.push_back(region.slot);
+		page->owners[region.slot] = nullptr;
+		if (--page->used == 0) {
+			glDeleteTextures(1, &page->texture);
+			delete page;
+			page = nullptr;
+		}
+	}
+	AtlasRegionOwner* owner = region.owner;
+	region = AtlasRegion();
+	region.owner = owner;
+}
+
+void TextureAtlas::clear() {
+	++generation;
+	for (Page* page : pages) {
+		if (page) {
+			glDeleteTextures(1, &page->texture);
+			delete page;
+		}
+	}
+	pages.clear();
+}
+
+size_t TextureAtlas::getPageCount() const {
+	return pages.size() - std::count(pages.begin(), pages.end(), nullptr);
+}
+
+size_t TextureAtlas::getPageBytes() const {
+	return getPageCount() * size_t(page_size) * size_t(page_size) * 4;
+}
+
+std::vector<std::vector<AtlasRegionOwner*>> TextureAtlas::getPageOwners() const {
+	std::vector<std::vector<AtlasRegionOwner*>> owners(pages.size());
+	for (size_t index = 0; index < pages.size(); ++index) {
+		if (const Page* page = pages[index]) {
+			for (AtlasRegionOwner* owner : page->owners) {
+				if (owner) {
+					owners[index].push_back(owner);
+				}
+			}
+		}
+	}
+	return owners;
+}
+
+TextureAtlas::Page* TextureAtlas::createPage() {
+	if (page_size == 0) {
+		// Every implementation supports at least 1024, larger pages mean fewer binds
+		GLint max_size = 0;
+		glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+		page_size = std::max(1024, std::min(2048, int(max_size)));
+		slots_per_row = page_size / SPRITE_PIXELS;
+	}
+
+	GLuint texture = 0;
+	glGenTextures(1, &texture);
+	if (texture == 0) {
+		return nullptr;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST); // Nearest-neighbor
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST); // Nearest-neighbor
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, 0x812F); // GL_CLAMP_TO_EDGE
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, 0x812F); // GL_CLAMP_TO_EDGE
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, page_size, page_size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+	Page* page = newd Page();
+	page->texture = texture;
+	page->used = 0;
+	// Handed out from the back, so the page fills up from the top left
+	const uint32_t slot_count = uint32_t(slots_per_row * slots_per_row);
+	page->owners.resize(slot_count, nullptr);
+	page->free_slots.reserve(slot_count);
+	for (uint32_t slot = slot_count; slot != 0; --slot) {
+		page->free_slots.push_back(slot - 1);
+	}
+	return page;
+}
@@ -0,0 +1,101 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+
+#ifndef RME_TEXTURE_ATLAS_H_
+#define RME_TEXTURE_ATLAS_H_
+
+// Whatever keeps a region, told when the region is drawn from a copy
+// without being looked up again
+class AtlasRegionOwner {
+public:
+	virtual void visit() = 0;
+
+protected:
+	~AtlasRegionOwner() { }
+};
+
+// Where a sprite has been placed in the atlas
+struct AtlasRegion {
+	AtlasRegion() :
+		texture(0),
+		page(0),
+		slot(0),
+		u0(0.f),
+		v0(0.f),
+		u1(0.f),
+		v1(0.f),
+		owner(nullptr) {
+		////
+	}
+
+	GLuint texture;
+	uint32_t page;
+	uint32_t slot;
+	// Texture coordinates of the corners
+	float u0, v0, u1, v1;
+	// Stays set when the region is removed
+	AtlasRegionOwner* owner;
+};
+
+// Game sprites are packed into a few large textures as they are first drawn,
+// so consecutive sprites can be drawn without binding another texture. Every
+// page is split into sprite sized slots, freed slots are reused and pages
+// that become empty are deleted.
+class TextureAtlas : boost::noncopyable {
+public:
+	TextureAtlas();
+	~TextureAtlas();
+
+	// Uploads SPRITE_PIXELS x SPRITE_PIXELS RGBA pixels into a free slot
+	bool add(const uint8_t* rgba, AtlasRegion& region);
+	void remove(AtlasRegion& region);
+	// Deletes all pages, only call this once all regions have been removed
+	void clear();
+
+	size_t getPageCount() const;
+	// Video memory held by the pages, which is only freed once all slots of a
+	// page are removed
+	size_t getPageBytes() const;
+	// The owners of the used slots of each page, by page index
+	std::vector<std::vector<AtlasRegionOwner*>> getPageOwners() const;
+	// Changes whenever all pages are deleted, regions kept elsewhere must be
+	// looked up again once it does. Single removals only clear the region,
+	// so copies can tell by comparing it with their own.
+	uint32_t getGeneration() const noexcept {
+		return generation;
+	}
+
+protected:
+	struct Page {
+		GLuint texture;
+		std::vector<uint32_t> free_slots;
+		// By slot, null for free slots
+		std::vector<AtlasRegionOwner*> owners;
+		uint32_t used;
+	};
+
+	Page* createPage();
+
+	// Deleted pages leave a gap, so the indices of the others stay valid
+	std::vector<Page*> pages;
+	int page_size;
+	int slots_per_row;
+	uint32_t generation;
+};
+
+#endif
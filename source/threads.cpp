@@ -0,0 +1,209 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+#include "threads.h"
+
+namespace {
+	struct OrderedJobQueue {
+		OrderedJobQueue(size_t count, const std::function<void(size_t)>& process) :
+			count(count),
+			process(process),
+			next(0),
+			done(count, false) {
+			////
+		}
+
+		size_t count;
+		const std::function<void(size_t)>& process;
+		std::atomic<size_t> next;
+		std::vector<bool> done;
+		std::mutex mutex;
+		std::condition_variable job_done;
+	};
+
+	class OrderedJobThread : public JoinableThread {
+	public:
+		explicit OrderedJobThread(OrderedJobQueue& queue) :
+			queue(queue) { }
+
+	protected:
+		virtual ExitCode Entry() {
+			size_t index;
+			while ((index = queue.next++) < queue.count) {
+				queue.process(index);
+
+				std::lock_guard<std::mutex> lock(queue.mutex);
+				queue.done[index] = true;
+				queue.job_done.notify_all();
+			}
+			return nullptr;
+		}
+
+		OrderedJobQueue& queue;
+	};
+}
+
+void runOrderedJobs(size_t count, int thread_count, const std::function<void(size_t)>& process, const std::function<void(size_t)>& finish) {
+	thread_count = static_cast<int>(std::min<size_t>(std::max(thread_count, 1), count));
+	if (thread_count <= 1) {
+		for (size_t index = 0; index < count; ++index) {
+			process(index);
+			finish(index);
+		}
+		return;
+	}
+
+	OrderedJobQueue queue(count, process);
+
+	std::vector<OrderedJobThread*> threads;
+	for (int i = 0; i < thread_count; ++i) {
+		OrderedJobThread* thread = newd OrderedJobThread(queue);
+		thread->Execute();
+		threads.push_back(thread);
+	}
+
+	for (size_t index = 0; index < count; ++index) {
+		{
+			std::unique_lock<std::mutex> lock(queue.mutex);
+			queue.job_done.wait(lock, [&queue, index]() { return queue.done[index]; });
+		}
+		finish(index);
+	}
+
+	for (OrderedJobThread* thread : threads) {
+		thread->Wait();
+		delete thread;
+	}
+}
+
+class OrderedJobPipeline::Worker : public JoinableThread {
+public:
+	explicit Worker(OrderedJobPipeline& pipeline) :
+		pipeline(pipeline) { }
+
+protected:
+	virtual ExitCode Entry() {
+		std::unique_lock<std::mutex> lock(pipeline.mutex);
+		while (true) {
+			pipeline.job_queued.wait(lock, [this]() { return pipeline.stopping || pipeline.started < pipeline.submitted; });
+			if (pipeline.started == pipeline.submitted) {
+				return nullptr;
+			}
+
+			const size_t slot = pipeline.started++ % pipeline.depth;
+			lock.unlock();
+			pipeline.process(slot);
+			lock.lock();
+
+			pipeline.done[slot] = true;
+			pipeline.job_done.notify_all();
+		}
+	}
+
+	OrderedJobPipeline& pipeline;
+};
+
+OrderedJobPipeline::OrderedJobPipeline(int thread_count, size_t depth, const std::function<void(size_t)>& process, const std::function<void(size_t)>& finish) :
+	process(process),
+	finish(finish),
+	depth(std::max<size_t>(depth, 1)),
+	finished(0),
+	submitted(0),
+	started(0),
+	done(this->depth, false),
+	stopping(false) {
+	if (thread_count > 1) {
+		for (int i = 0; i < thread_count; ++i) {
+			Worker* worker = newd Worker(*this);
+			worker->Execute();
+			workers.push_back(worker);
+		}
+	}
+}
+
+OrderedJobPipeline::~OrderedJobPipeline() {
+	flush();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		job_queued.notify_all();
+	}
+	for (JoinableThread* worker : workers) {
+		worker->Wait();
+		delete worker;
+	}
+}
+
+size_t OrderedJobPipeline::acquire() {
+	if (submitted - finished == depth) {
+		finishOldest();
+	}
+	return submitted % depth;
+}
+
+void OrderedJobPipeline::submit() {
+	if (workers.empty()) {
+		// No workers, the job is done right away
+		const size_t slot = submitted++ % depth;
+		process(slot);
+		finish(slot);
+		++finished;
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	++submitted;
+	job_queued.notify_one();
+}
+
+void OrderedJobPipeline::flush() {
+	while (finished < submitted) {
+		finishOldest();
+	}
+}
+
+void OrderedJobPipeline::finishOldest() {
+	const size_t slot = finished % depth;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		job_done.wait(lock, [this, slot]() { return done[slot]; });
+		done[slot] = false;
+	}
+	finish(slot);
+	++finished;
+}
+
+void runBoundedOrderedJobs(size_t count, int thread_count, size_t depth, const std::function<void(size_t)>& process, const std::function<void(size_t)>& finish) {
+	// Which job each slot holds
+	std::vector<size_t> jobs(std::max<size_t>(depth, 1));
+	OrderedJobPipeline pipeline(
+		thread_count, jobs.size(),
+		[&jobs, &process](size_t slot) { process(jobs[slot]); },
+		[&jobs, &finish](size_t slot) { finish(jobs[slot]); }
+	);
+	for (size_t index = 0; index < count; ++index) {
+		jobs[pipeline.acquire()] = index;
+		pipeline.submit();
+	}
+	pipeline.flush();
+}
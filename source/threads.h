@@ -20,6 +20,10 @@
 
 #include "main.h"
 
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
 class Thread : public wxThread {
 public:
 	Thread(wxThreadKind);
@@ -47,4 +51,50 @@ inline void Thread::Execute() {
 	Run();
 }
 
+// Calls process(index) for every index in [0, count) on up to thread_count
+// worker threads. finish(index) is called on the calling thread in index
+// order as soon as that job is done, so results can be consumed while the
+// remaining jobs are still being processed.
+void runOrderedJobs(size_t count, int thread_count, const std::function<void(size_t)>& process, const std::function<void(size_t)>& finish);
+
+// Like runOrderedJobs, for jobs that are only known one at a time. Each job
+// lives in one of depth slots: acquire() returns the slot to fill in, submit()
+// hands it to the workers. process(slot) runs on a worker thread and
+// finish(slot) on the calling thread in submission order, at the latest when
+// the slot is needed again, so at most depth jobs are held at once.
+class OrderedJobPipeline : boost::noncopyable {
+public:
+	OrderedJobPipeline(int thread_count, size_t depth, const std::function<void(size_t)>& process, const std::function<void(size_t)>& finish);
+	~OrderedJobPipeline();
+
+	size_t acquire();
+	void submit();
+	// Finishes all submitted jobs
+	void flush();
+
+protected:
+	void finishOldest();
+
+	class Worker;
+
+	std::function<void(size_t)> process;
+	std::function<void(size_t)> finish;
+	size_t depth;
+	// Jobs are numbered in submission order, job n uses slot n % depth
+	size_t finished;
+	size_t submitted;
+	size_t started;
+	std::vector<bool> done;
+	bool stopping;
+	std::mutex mutex;
+	std::condition_variable job_queued;
+	std::condition_variable job_done;
+	std::vector<JoinableThread*> workers;
+};
+
+// runOrderedJobs through an OrderedJobPipeline: at most depth jobs are done or
+// in progress ahead of the one being finished, so their results can't pile up
+// when finish is slower than process.
+void runBoundedOrderedJobs(size_t count, int thread_count, size_t depth, const std::function<void(size_t)>& process, const std::function<void(size_t)>& finish);
+
 #endif
@@ -83,6 +83,7 @@ Tile* Tile::deepCopy(BaseMap& map) {
 
 	ItemVector::iterator it;
 
+	copy->items.reserve(items.size());
 	it = items.begin();
 	while (it != items.end()) {
 		copy->items.push_back((*it)->deepCopy());
@@ -715,6 +716,7 @@ void Tile::addHouseExit(House* h) {
 	}
 	HouseExitList* house_exits = location->createHouseExits();
 	house_exits->push_back(h->getID());
+	location->touch();
 }
 
 void Tile::removeHouseExit(House* h) {
@@ -730,6 +732,7 @@ void Tile::removeHouseExit(House* h) {
 	for (std::vector<uint32_t>::iterator it = house_exits->begin(); it != house_exits->end(); ++it) {
 		if (*it == h->getID()) {
 			house_exits->erase(it);
+			location->touch();
 			return;
 		}
 	}
@@ -62,6 +62,10 @@ public:
 
 	~Tile();
 
+	// Tiles are drawn from the pool shared by all maps (see MapAllocator)
+	static void* operator new(size_t size);
+	static void operator delete(void* ptr, size_t size);
+
 	// Argument is a the map to allocate the tile from
 	Tile* deepCopy(BaseMap& map);
 
@@ -0,0 +1,125 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+
+// Checks the chunk lists behind ItemIndex against a plain set per key, with
+// chunks added out of order and several times, and searches that stop early
+// and drop the chunks where a key was no longer found.
+
+#include "main.h"
+
+#include "item_chunk_index.h"
+
+#include <random>
+#include <set>
+
+namespace {
+	int failures = 0;
+
+	void check(bool ok, const std::string& what) {
+		if (!ok) {
+			std::cerr << "FAILED: " << what << std::endl;
+			++failures;
+		}
+	}
+
+	std::vector<uint64_t> expectedCandidates(std::map<uint32_t, std::set<uint64_t>>& model, const std::vector<uint32_t>& keys) {
+		std::set<uint64_t> candidates;
+		for (uint32_t key : keys) {
+			candidates.insert(model[key].begin(), model[key].end());
+		}
+		return std::vector<uint64_t>(candidates.begin(), candidates.end());
+	}
+}
+
+int main(int argc, char** argv) {
+	// Chunk keys sort by floor, then x, then y and give back the corner tile
+	check(ItemChunkIndex::getChunkKey(35, 8, 7) == ItemChunkIndex::getChunkKey(32, 11, 7), "tiles of a chunk share its key");
+	check(ItemChunkIndex::getChunkKey(4, 0, 6) < ItemChunkIndex::getChunkKey(0, 0, 7), "floors sort first");
+	check(ItemChunkIndex::getChunkKey(0, 4000, 7) < ItemChunkIndex::getChunkKey(4, 0, 7), "x sorts before y");
+	int x, y, z;
+	ItemChunkIndex::getChunkOrigin(ItemChunkIndex::getChunkKey(65535, 32001, 15), x, y, z);
+	check(x == 65532 && y == 32000 && z == 15, "chunk origin");
+
+	// Added out of order and twice, the candidates are sorted and unique
+	ItemChunkIndex index;
+	for (uint64_t chunk : { 5, 3, 3, 9, 5, 1 }) {
+		index.add(1, chunk);
+	}
+	index.add(2, 4);
+	index.add(2, 9);
+	check(index.getCandidates({ 1 }) == std::vector<uint64_t>({ 1, 3, 5, 9 }), "candidates of one key");
+	check(index.getCandidates({ 1, 2 }) == std::vector<uint64_t>({ 1, 3, 4, 5, 9 }), "candidates of two keys");
+	check(index.getCandidates({ 3 }).empty(), "candidates of a missing key");
+
+	// A search of the first three candidates that found key 1 only in 3 and
+	// key 2 in 4 drops chunk 1 from key 1, the unsearched chunks stay
+	std::vector<uint64_t> candidates = index.getCandidates({ 1, 2 });
+	index.prune({ 1, 2 }, candidates, 3, { 0, 1, 2, 0, 0 });
+	check(index.getCandidates({ 1 }) == std::vector<uint64_t>({ 3, 5, 9 }), "pruned key 1");
+	check(index.getCandidates({ 2 }) == std::vector<uint64_t>({ 4, 9 }), "pruned key 2");
+
+	// A key without chunks left is gone
+	candidates = index.getCandidates({ 2 });
+	index.prune({ 2 }, candidates, candidates.size(), { 0, 0 });
+	check(index.getCandidates({ 2 }).empty(), "emptied key");
+
+	// Random adds and searches against a set per key
+	std::mt19937 random(1234);
+	std::map<uint32_t, std::set<uint64_t>> model;
+	index.clear();
+	for (int round = 0; round < 2000 && failures == 0; ++round) {
+		for (int i = random() % 40; i > 0; --i) {
+			const uint32_t key = random() % 8;
+			const uint64_t chunk = ItemChunkIndex::getChunkKey(random() % 256, random() % 256, random() % 16);
+			index.add(key, chunk);
+			model[key].insert(chunk);
+		}
+
+		std::vector<uint32_t> keys;
+		for (int i = 1 + random() % 3; i > 0; --i) {
+			keys.push_back(random() % 8);
+		}
+		candidates = index.getCandidates(keys);
+		check(candidates == expectedCandidates(model, keys), "random candidates in round " + std::to_string(round));
+
+		// Search part of the candidates, each key is still found in some of them
+		const size_t searched = candidates.empty() ? 0 : random() % (candidates.size() + 1);
+		std::vector<uint32_t> found(candidates.size(), 0);
+		for (size_t c = 0; c < searched; ++c) {
+			for (size_t k = 0; k < keys.size(); ++k) {
+				if (model[keys[k]].count(candidates[c]) && random() % 2) {
+					found[c] |= 1u << k;
+				}
+			}
+		}
+		index.prune(keys, candidates, searched, found);
+		for (size_t c = 0; c < searched; ++c) {
+			for (size_t k = 0; k < keys.size(); ++k) {
+				if ((found[c] & (1u << k)) == 0) {
+					model[keys[k]].erase(candidates[c]);
+				}
+			}
+		}
+		for (uint32_t key = 0; key < 8; ++key) {
+			check(index.getCandidates({ key }) == expectedCandidates(model, { key }), "random lists in round " + std::to_string(round));
+		}
+	}
+
+	std::cout << (failures == 0 ? "All checks passed" : "Some checks failed") << std::endl;
+	return failures == 0 ? 0 : 1;
+}
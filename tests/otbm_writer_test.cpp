@@ -0,0 +1,211 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+
+// Checks that writing the tile areas in per-block groups on worker threads,
+// as IOMapOTBM::saveMap does, gives the same bytes as writing all of them in
+// one go. Blocks reused from an earlier save are spliced in the same way.
+
+#include "main.h"
+
+#include "iomap_otbm.h"
+
+#include <wx/init.h>
+
+#include <random>
+
+namespace {
+	struct TestTile {
+		Position pos;
+		std::vector<uint8_t> data;
+		bool has_item;
+
+		const Position& getPosition() const {
+			return pos;
+		}
+	};
+
+	// Tiles in the order the map iterator visits them, 4x4 leaves of all
+	// floors inside each 256x256 block, with data full of bytes that need
+	// escaping
+	std::vector<TestTile*> makeTiles(std::mt19937& random) {
+		std::vector<TestTile*> tiles;
+		const int blocks[][2] = { { 0, 0 }, { 0, 1 }, { 1, 0 }, { 3, 7 }, { 255, 255 } };
+		for (const auto& block : blocks) {
+			for (int leaf = 0; leaf < 64; ++leaf) {
+				const int leaf_x = block[0] * 256 + (random() % 64) * 4;
+				const int leaf_y = block[1] * 256 + (random() % 64) * 4;
+				for (int z = 0; z < 16; ++z) {
+					if (random() % 3 != 0) {
+						continue;
+					}
+					for (int i = 0; i < 16; ++i) {
+						if (random() % 2 == 0) {
+							continue;
+						}
+						TestTile* tile = newd TestTile();
+						tile->pos = Position(leaf_x + i % 4, leaf_y + i / 4, z);
+						tile->data.resize(random() % 24);
+						for (uint8_t& byte : tile->data) {
+							byte = uint8_t(0xFA + random() % 6);
+						}
+						tile->has_item = random() % 2 == 0;
+						tiles.push_back(tile);
+					}
+				}
+			}
+		}
+		return tiles;
+	}
+
+	void writeTiles(const std::vector<TestTile*>& tiles, size_t begin, size_t end, NodeFileWriteHandle& f) {
+		writeTileAreas(f, tiles, begin, end, [&f](TestTile* tile) {
+			f.addNode(OTBM_TILE);
+			f.addU8(tile->pos.x & 0xFF);
+			f.addU8(tile->pos.y & 0xFF);
+			f.addRAW(tile->data.data(), tile->data.size());
+			if (tile->has_item) {
+				f.addNode(OTBM_ITEM);
+				f.addU16(uint16_t(tile->pos.x ^ tile->pos.y));
+				f.endNode();
+			}
+			f.endNode();
+		});
+	}
+
+	void writeSerial(const std::string& name, const std::vector<TestTile*>& tiles) {
+		DiskNodeFileWriteHandle f(name, "OTBM");
+		f.addNode(0);
+		writeTiles(tiles, 0, tiles.size(), f);
+		f.endNode();
+		f.close();
+	}
+
+	// Same as SavedAreaCache::getBlockKey
+	uint32_t getBlockKey(const Position& pos) {
+		return ((uint32_t(pos.x) >> 8) & 0xFF) << 8 | ((uint32_t(pos.y) >> 8) & 0xFF);
+	}
+
+	// Splits the tiles at block changes and writes the blocks the way saveMap
+	// does, blocks found in the cache are copied from there instead
+	void writeGrouped(const std::string& name, const std::vector<TestTile*>& tiles, int thread_count, std::map<uint32_t, std::string>& cache) {
+		std::vector<size_t> block_starts;
+		for (size_t index = 0; index < tiles.size(); ++index) {
+			if (index == 0 || getBlockKey(tiles[index]->pos) != getBlockKey(tiles[index - 1]->pos)) {
+				block_starts.push_back(index);
+			}
+		}
+		const size_t block_count = block_starts.size();
+		block_starts.push_back(tiles.size());
+
+		auto getKey = [&tiles, &block_starts](size_t index) {
+			return getBlockKey(tiles[block_starts[index]]->pos);
+		};
+
+		// Looked up before the workers start, as the writer adds to the cache
+		std::vector<const std::string*> cached(block_count, nullptr);
+		for (size_t index = 0; index < block_count; ++index) {
+			auto it = cache.find(getKey(index));
+			if (it != cache.end()) {
+				cached[index] = &it->second;
+			}
+		}
+
+		DiskNodeFileWriteHandle f(name, "OTBM");
+		f.addNode(0);
+		std::vector<MemoryNodeFileWriteHandle*> blocks(block_count, nullptr);
+		auto serialize = [&](size_t index) {
+			if (!cached[index]) {
+				MemoryNodeFileWriteHandle* block = newd MemoryNodeFileWriteHandle();
+				writeTiles(tiles, block_starts[index], block_starts[index + 1], *block);
+				blocks[index] = block;
+			}
+		};
+		auto write = [&](size_t index) {
+			if (const std::string* blob = cached[index]) {
+				f.addEncodedRAW(reinterpret_cast<const uint8_t*>(blob->data()), blob->size());
+			} else {
+				MemoryNodeFileWriteHandle* block = blocks[index];
+				f.addEncodedRAW(block->getMemory(), block->getSize());
+				cache[getKey(index)] = std::string(reinterpret_cast<const char*>(block->getMemory()), block->getSize());
+				delete block;
+			}
+		};
+		// Fewer slots than blocks, so that slots are reused
+		runBoundedOrderedJobs(block_count, thread_count, 2, serialize, write);
+		f.endNode();
+		f.close();
+	}
+
+	std::string readFile(const std::string& name) {
+		std::ifstream file(name, std::ios::binary);
+		return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	bool compare(const std::string& expected, const std::string& actual, const std::string& what) {
+		if (expected == actual) {
+			return true;
+		}
+
+		size_t offset = 0;
+		while (offset < expected.size() && offset < actual.size() && expected[offset] == actual[offset]) {
+			++offset;
+		}
+		std::cerr << what << ": " << actual.size() << " bytes instead of " << expected.size() << ", first difference at " << offset << std::endl;
+		return false;
+	}
+}
+
+int main(int argc, char** argv) {
+	wxInitializer initializer;
+	if (!initializer) {
+		std::cerr << "Could not initialize wxWidgets" << std::endl;
+		return 1;
+	}
+
+	std::mt19937 random(1234);
+	std::vector<TestTile*> tiles = makeTiles(random);
+
+	const std::string serial_name = "otbm_writer_serial.otbm";
+	const std::string grouped_name = "otbm_writer_grouped.otbm";
+	writeSerial(serial_name, tiles);
+	const std::string expected = readFile(serial_name);
+
+	bool ok = !expected.empty();
+	for (int thread_count : { 1, 2, 8 }) {
+		std::map<uint32_t, std::string> cache;
+		writeGrouped(grouped_name, tiles, thread_count, cache);
+		ok = compare(expected, readFile(grouped_name), i2s(thread_count) + " threads") && ok;
+
+		// Every block comes from the cache the second time, drop some of them
+		// so that cached and freshly written blocks are mixed
+		for (auto it = cache.begin(); it != cache.end();) {
+			it = random() % 2 == 0 ? cache.erase(it) : std::next(it);
+		}
+		writeGrouped(grouped_name, tiles, thread_count, cache);
+		ok = compare(expected, readFile(grouped_name), i2s(thread_count) + " threads with cached blocks") && ok;
+	}
+
+	for (TestTile* tile : tiles) {
+		delete tile;
+	}
+	wxRemoveFile(serial_name);
+	wxRemoveFile(grouped_name);
+
+	std::cout << tiles.size() << " tiles, " << expected.size() << " bytes: " << (ok ? "identical" : "DIFFERENT") << std::endl;
+	return ok ? 0 : 1;
+}
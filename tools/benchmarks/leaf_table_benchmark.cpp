@@ -0,0 +1,129 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+
+// Times BaseMap leaf lookups through QTreeLeafTable against the descent of
+// the hex tree that QTreeNode::getLeaf does, on a map sized area.
+
+#include "main.h"
+
+#include "map_leaf_table.h"
+#include "position.h"
+
+#include <chrono>
+#include <random>
+
+namespace {
+	// Same shape as QTreeNode: 16 children per node, two bits of x and y
+	// per level and leaves covering 4x4 tiles
+	struct TreeNode {
+		TreeNode() :
+			isLeaf(false), child() { }
+		~TreeNode() {
+			for (TreeNode* node : child) {
+				delete node;
+			}
+		}
+
+		bool isLeaf;
+		TreeNode* child[16];
+	};
+
+	TreeNode* getLeafForce(TreeNode* node, int x, int y) {
+		uint32_t cx = x, cy = y;
+		for (int level = 6; level >= 0; --level) {
+			TreeNode*& next = node->child[((cx & 0xC000) >> 14) | ((cy & 0xC000) >> 12)];
+			if (!next) {
+				next = newd TreeNode();
+				next->isLeaf = level == 0;
+			}
+			node = next;
+			cx <<= 2;
+			cy <<= 2;
+		}
+		return node;
+	}
+
+	TreeNode* getLeaf(TreeNode* node, int x, int y) {
+		uint32_t cx = x, cy = y;
+		while (node) {
+			if (node->isLeaf) {
+				return node;
+			}
+			node = node->child[((cx & 0xC000) >> 14) | ((cy & 0xC000) >> 12)];
+			cx <<= 2;
+			cy <<= 2;
+		}
+		return nullptr;
+	}
+
+	template <class Lookup>
+	double measure(const std::vector<Position>& positions, int rounds, uintptr_t& checksum, Lookup lookup) {
+		const auto start = std::chrono::steady_clock::now();
+		for (int round = 0; round < rounds; ++round) {
+			for (const Position& pos : positions) {
+				checksum += reinterpret_cast<uintptr_t>(lookup(pos.x, pos.y));
+			}
+		}
+		const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count() / (double(positions.size()) * rounds);
+	}
+}
+
+int main(int argc, char** argv) {
+	// A 2048x2048 area where real maps are, with every other leaf present
+	const int origin = 31744;
+	const int size = argc > 1 ? std::max(atoi(argv[1]), 64) : 2048;
+	const int rounds = argc > 2 ? std::max(atoi(argv[2]), 1) : 20;
+
+	TreeNode root;
+	QTreeLeafTable table;
+	for (int x = origin; x < origin + size; x += 4) {
+		for (int y = origin; y < origin + size; y += 4) {
+			if (((x ^ y) >> 2) & 1) {
+				table.set(x, y, reinterpret_cast<QTreeNode*>(getLeafForce(&root, x, y)));
+			}
+		}
+	}
+
+	// Row by row as the drawer and the iterators walk, and scattered as
+	// searches and brushes do
+	std::vector<Position> rows;
+	for (int y = origin; y < origin + size; ++y) {
+		for (int x = origin; x < origin + size; ++x) {
+			rows.emplace_back(x, y, 7);
+		}
+	}
+	std::vector<Position> scattered = rows;
+	std::shuffle(scattered.begin(), scattered.end(), std::mt19937(1234));
+
+	for (const Position& pos : scattered) {
+		if (reinterpret_cast<QTreeNode*>(getLeaf(&root, pos.x, pos.y)) != table.get(pos.x, pos.y)) {
+			std::cerr << "The table and the tree disagree at " << pos.x << ", " << pos.y << std::endl;
+			return 1;
+		}
+	}
+
+	uintptr_t checksum = 0;
+	auto tree = [&root](int x, int y) { return getLeaf(&root, x, y); };
+	auto flat = [&table](int x, int y) { return table.get(x, y); };
+	std::cout << size << "x" << size << " tiles, " << rounds << " rounds, ns per lookup" << std::endl;
+	std::cout << "rows       tree " << measure(rows, rounds, checksum, tree) << "  table " << measure(rows, rounds, checksum, flat) << std::endl;
+	std::cout << "scattered  tree " << measure(scattered, rounds, checksum, tree) << "  table " << measure(scattered, rounds, checksum, flat) << std::endl;
+	std::cout << "(checksum " << checksum << ")" << std::endl;
+	return 0;
+}
@@ -0,0 +1,358 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+
+// Times the sprite pixel routines of sprite_pixels.cpp against the loops
+// graphics.cpp used before them, either on random dumps shaped like client
+// sprites or on every sprite of a .spr file. Which vector paths are used
+// depends on the target flags of the build, the program prints what it was
+// built with.
+
+#include "main.h"
+
+#include "sprite_pixels.h"
+
+#include <chrono>
+#include <fstream>
+#include <random>
+
+namespace {
+	// A sprite dump of alternating transparent and coloured runs
+	std::vector<uint8_t> makeDump(std::mt19937& random, bool use_alpha) {
+		const int bpp = use_alpha ? 4 : 3;
+		std::vector<uint8_t> dump;
+		int pixel = 0;
+		while (pixel < SPRITE_PIXELS_SIZE) {
+			const int transparent = std::min<int>(random() % 24, SPRITE_PIXELS_SIZE - pixel);
+			const int colored = std::min<int>(random() % 40, SPRITE_PIXELS_SIZE - pixel - transparent);
+			dump.push_back(transparent & 0xFF);
+			dump.push_back(transparent >> 8);
+			dump.push_back(colored & 0xFF);
+			dump.push_back(colored >> 8);
+			for (int i = 0; i < colored * bpp; ++i) {
+				dump.push_back(uint8_t(random()));
+			}
+			pixel += transparent + colored;
+			if (random() % 16 == 0) { // Sprites usually end on a coloured run
+				break;
+			}
+		}
+		return dump;
+	}
+
+	// The loops of the old decompressRGBA and getRGBData, writing into rgba
+	// and rgb instead of newd buffers
+	void oldDecodeRGBA(const uint8_t* dump, uint16_t size, bool use_alpha, uint8_t* data) {
+		const int pixels_data_size = SPRITE_PIXELS_SIZE * 4;
+		uint8_t bpp = use_alpha ? 4 : 3;
+		int write = 0;
+		int read = 0;
+		while (read < size && write < pixels_data_size) {
+			int transparent = dump[read] | dump[read + 1] << 8;
+			if (use_alpha && transparent >= SPRITE_PIXELS_SIZE) {
+				break;
+			}
+			read += 2;
+			for (int i = 0; i < transparent && write < pixels_data_size; i++) {
+				data[write + 0] = 0x00;
+				data[write + 1] = 0x00;
+				data[write + 2] = 0x00;
+				data[write + 3] = 0x00;
+				write += 4;
+			}
+
+			int colored = dump[read] | dump[read + 1] << 8;
+			read += 2;
+			for (int i = 0; i < colored && write < pixels_data_size; i++) {
+				data[write + 0] = dump[read + 0];
+				data[write + 1] = dump[read + 1];
+				data[write + 2] = dump[read + 2];
+				data[write + 3] = use_alpha ? dump[read + 3] : 0xFF;
+				write += 4;
+				read += bpp;
+			}
+		}
+		while (write < pixels_data_size) {
+			data[write + 0] = 0x00;
+			data[write + 1] = 0x00;
+			data[write + 2] = 0x00;
+			data[write + 3] = 0x00;
+			write += 4;
+		}
+	}
+
+	void oldDecodeRGB(const uint8_t* dump, uint16_t size, bool use_alpha, uint8_t* data) {
+		const int pixels_data_size = SPRITE_PIXELS_SIZE * 3;
+		uint8_t bpp = use_alpha ? 4 : 3;
+		int write = 0;
+		int read = 0;
+		while (read < size && write < pixels_data_size) {
+			int transparent = dump[read] | dump[read + 1] << 8;
+			read += 2;
+			for (int i = 0; i < transparent && write < pixels_data_size; i++) {
+				data[write + 0] = 0xFF;
+				data[write + 1] = 0x00;
+				data[write + 2] = 0xFF;
+				write += 3;
+			}
+
+			int colored = dump[read] | dump[read + 1] << 8;
+			read += 2;
+			for (int i = 0; i < colored && write < pixels_data_size; i++) {
+				data[write + 0] = dump[read + 0];
+				data[write + 1] = dump[read + 1];
+				data[write + 2] = dump[read + 2];
+				write += 3;
+				read += bpp;
+			}
+		}
+		while (write < pixels_data_size) {
+			data[write + 0] = 0xFF;
+			data[write + 1] = 0x00;
+			data[write + 2] = 0xFF;
+			write += 3;
+		}
+	}
+
+	void oldColorizePixel(uint32_t color, uint8_t& red, uint8_t& green, uint8_t& blue) {
+		uint8_t ro = (color & 0xFF0000) >> 16;
+		uint8_t go = (color & 0xFF00) >> 8;
+		uint8_t bo = (color & 0xFF);
+		red = (uint8_t)(red * (ro / 255.f));
+		green = (uint8_t)(green * (go / 255.f));
+		blue = (uint8_t)(blue * (bo / 255.f));
+	}
+
+	void oldColorize(uint8_t* pixels, int bytes_per_pixel, const uint8_t* template_rgb, uint32_t head, uint32_t body, uint32_t legs, uint32_t feet) {
+		for (int i = 0; i < SPRITE_PIXELS_SIZE; ++i) {
+			uint8_t& red = pixels[i * bytes_per_pixel + 0];
+			uint8_t& green = pixels[i * bytes_per_pixel + 1];
+			uint8_t& blue = pixels[i * bytes_per_pixel + 2];
+
+			const uint8_t tred = template_rgb[i * 3 + 0];
+			const uint8_t tgreen = template_rgb[i * 3 + 1];
+			const uint8_t tblue = template_rgb[i * 3 + 2];
+
+			if (tred && tgreen && !tblue) {
+				oldColorizePixel(head, red, green, blue);
+			} else if (tred && !tgreen && !tblue) {
+				oldColorizePixel(body, red, green, blue);
+			} else if (!tred && tgreen && !tblue) {
+				oldColorizePixel(legs, red, green, blue);
+			} else if (!tred && !tgreen && tblue) {
+				oldColorizePixel(feet, red, green, blue);
+			}
+		}
+	}
+
+	// A template of head, body, legs and feet areas with some unmasked pixels
+	std::vector<uint8_t> makeTemplate(std::mt19937& random) {
+		static const uint8_t masks[5][3] = { { 0xFF, 0xFF, 0 }, { 0xFF, 0, 0 }, { 0, 0xFF, 0 }, { 0, 0, 0xFF }, { 0, 0, 0 } };
+		std::vector<uint8_t> template_rgb(SPRITE_PIXELS_SIZE * 3);
+		for (int i = 0; i < SPRITE_PIXELS_SIZE; ++i) {
+			memcpy(&template_rgb[i * 3], masks[random() % 5], 3);
+		}
+		return template_rgb;
+	}
+
+	struct Outfit {
+		uint32_t head, body, legs, feet;
+	};
+
+	// The dumps of all sprites of a .spr file, laid out as
+	// GraphicManager::loadSpriteDump reads them
+	bool readSprFile(const char* path, bool extended, std::vector<std::vector<uint8_t>>& dumps) {
+		std::ifstream file(path, std::ios::binary);
+		const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		const size_t header = extended ? 8 : 6;
+		if (data.size() < header) {
+			return false;
+		}
+
+		uint32_t count = 0;
+		memcpy(&count, data.data() + 4, extended ? 4 : 2);
+		for (uint32_t id = 1; id <= count; ++id) {
+			uint32_t offset;
+			const size_t index = header + (id - 1) * sizeof(uint32_t);
+			if (index + sizeof(offset) > data.size()) {
+				return false;
+			}
+			memcpy(&offset, data.data() + index, sizeof(offset));
+			if (offset == 0) {
+				continue;
+			}
+
+			// Skip the color key
+			const size_t position = size_t(offset) + 3;
+			uint16_t size;
+			if (position + sizeof(size) > data.size()) {
+				return false;
+			}
+			memcpy(&size, data.data() + position, sizeof(size));
+			if (size == 0 || position + sizeof(size) + size > data.size()) {
+				continue;
+			}
+			const uint8_t* dump = reinterpret_cast<const uint8_t*>(data.data()) + position + sizeof(size);
+			dumps.emplace_back(dump, dump + size);
+		}
+		return true;
+	}
+
+	bool sameDecoding(const std::vector<uint8_t>& dump, bool use_alpha, uint8_t* expected, uint8_t* actual) {
+		const uint16_t size = uint16_t(dump.size());
+		oldDecodeRGBA(dump.data(), size, use_alpha, expected);
+		decodeSpriteRGBA(dump.data(), size, use_alpha, actual);
+		if (memcmp(expected, actual, SPRITE_PIXELS_SIZE * 4) != 0) {
+			return false;
+		}
+		oldDecodeRGB(dump.data(), size, use_alpha, expected);
+		decodeSpriteRGB(dump.data(), size, use_alpha, actual);
+		return memcmp(expected, actual, SPRITE_PIXELS_SIZE * 3) == 0;
+	}
+
+	void printBuild() {
+		std::cout << "Built with SSE2 " <<
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+			"yes"
+#else
+			"no"
+#endif
+			<< ", SSSE3 " <<
+#if defined(__SSSE3__) || defined(__AVX2__)
+			"yes"
+#else
+			"no"
+#endif
+			<< std::endl;
+	}
+
+	template <class Function>
+	double microseconds(int rounds, size_t count, Function function) {
+		const auto start = std::chrono::steady_clock::now();
+		for (int round = 0; round < rounds; ++round) {
+			for (size_t i = 0; i < count; ++i) {
+				function(i);
+			}
+		}
+		const std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count() / (double(count) * rounds);
+	}
+}
+
+// Decodes every sprite of the file with the old and new routines
+int runSprFile(int argc, char** argv) {
+	const char* path = argv[2];
+	bool extended = false;
+	bool use_alpha = false;
+	int rounds = 10;
+	for (int i = 3; i < argc; ++i) {
+		if (strcmp(argv[i], "--extended") == 0) {
+			extended = true;
+		} else if (strcmp(argv[i], "--alpha") == 0) {
+			use_alpha = true;
+		} else {
+			rounds = std::max(atoi(argv[i]), 1);
+		}
+	}
+
+	std::vector<std::vector<uint8_t>> dumps;
+	if (!readSprFile(path, extended, dumps) || dumps.empty()) {
+		std::cerr << "Could not read the sprites of " << path << std::endl;
+		return 1;
+	}
+
+	uint8_t expected[SPRITE_PIXELS_SIZE * 4];
+	uint8_t actual[SPRITE_PIXELS_SIZE * 4];
+	for (size_t i = 0; i < dumps.size(); ++i) {
+		if (!sameDecoding(dumps[i], use_alpha, expected, actual)) {
+			std::cerr << "The old and new routines disagree on sprite " << i << " of the file" << std::endl;
+			return 1;
+		}
+	}
+
+	printBuild();
+	std::cout << dumps.size() << " sprites, " << rounds << " rounds, us per sprite (ms per file)" << std::endl;
+
+	uint8_t* out = actual;
+	auto row = [&](const char* name, auto old_function, auto new_function) {
+		const double old_time = microseconds(rounds, dumps.size(), old_function);
+		const double new_time = microseconds(rounds, dumps.size(), new_function);
+		std::cout << name << "  old " << old_time << " (" << old_time * dumps.size() / 1000 << ")  new " << new_time << " (" << new_time * dumps.size() / 1000 << ")" << std::endl;
+	};
+	row("RGBA", [&](size_t i) { oldDecodeRGBA(dumps[i].data(), uint16_t(dumps[i].size()), use_alpha, out); }, [&](size_t i) { decodeSpriteRGBA(dumps[i].data(), uint16_t(dumps[i].size()), use_alpha, out); });
+	row("RGB ", [&](size_t i) { oldDecodeRGB(dumps[i].data(), uint16_t(dumps[i].size()), use_alpha, out); }, [&](size_t i) { decodeSpriteRGB(dumps[i].data(), uint16_t(dumps[i].size()), use_alpha, out); });
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	if (argc > 2 && strcmp(argv[1], "--spr") == 0) {
+		return runSprFile(argc, argv);
+	}
+
+	const int sprite_count = argc > 1 ? std::max(atoi(argv[1]), 1) : 4096;
+	const int rounds = argc > 2 ? std::max(atoi(argv[2]), 1) : 10;
+
+	std::mt19937 random(1234);
+	std::vector<std::vector<uint8_t>> rgb_dumps, rgba_dumps, templates;
+	std::vector<Outfit> outfits;
+	for (int i = 0; i < sprite_count; ++i) {
+		rgb_dumps.push_back(makeDump(random, false));
+		rgba_dumps.push_back(makeDump(random, true));
+		templates.push_back(makeTemplate(random));
+		outfits.push_back({ uint32_t(random() & 0xFFFFFF), uint32_t(random() & 0xFFFFFF), uint32_t(random() & 0xFFFFFF), uint32_t(random() & 0xFFFFFF) });
+	}
+
+	uint8_t expected[SPRITE_PIXELS_SIZE * 4];
+	uint8_t actual[SPRITE_PIXELS_SIZE * 4];
+	for (int i = 0; i < sprite_count; ++i) {
+		for (bool use_alpha : { false, true }) {
+			bool same = sameDecoding(use_alpha ? rgba_dumps[i] : rgb_dumps[i], use_alpha, expected, actual);
+			for (int bytes_per_pixel : { 3, 4 }) {
+				const Outfit& outfit = outfits[i];
+				memcpy(actual, expected, sizeof(expected));
+				oldColorize(expected, bytes_per_pixel, templates[i].data(), outfit.head, outfit.body, outfit.legs, outfit.feet);
+				colorizeTemplate(actual, bytes_per_pixel, templates[i].data(), outfit.head, outfit.body, outfit.legs, outfit.feet);
+				same = same && memcmp(expected, actual, SPRITE_PIXELS_SIZE * bytes_per_pixel) == 0;
+			}
+			if (!same) {
+				std::cerr << "The old and new routines disagree on sprite " << i << (use_alpha ? " with alpha" : "") << std::endl;
+				return 1;
+			}
+		}
+	}
+
+	printBuild();
+	std::cout << sprite_count << " sprites, " << rounds << " rounds, us per sprite" << std::endl;
+
+	uint8_t* out = actual;
+	auto row = [&](const char* name, auto old_function, auto new_function) {
+		const double old_time = microseconds(rounds, size_t(sprite_count), old_function);
+		const double new_time = microseconds(rounds, size_t(sprite_count), new_function);
+		std::cout << name << "  old " << old_time << "  new " << new_time << std::endl;
+	};
+	row("RGBA from RGB dumps  ", [&](size_t i) { oldDecodeRGBA(rgb_dumps[i].data(), uint16_t(rgb_dumps[i].size()), false, out); }, [&](size_t i) { decodeSpriteRGBA(rgb_dumps[i].data(), uint16_t(rgb_dumps[i].size()), false, out); });
+	row("RGBA from RGBA dumps ", [&](size_t i) { oldDecodeRGBA(rgba_dumps[i].data(), uint16_t(rgba_dumps[i].size()), true, out); }, [&](size_t i) { decodeSpriteRGBA(rgba_dumps[i].data(), uint16_t(rgba_dumps[i].size()), true, out); });
+	row("RGB from RGB dumps   ", [&](size_t i) { oldDecodeRGB(rgb_dumps[i].data(), uint16_t(rgb_dumps[i].size()), false, out); }, [&](size_t i) { decodeSpriteRGB(rgb_dumps[i].data(), uint16_t(rgb_dumps[i].size()), false, out); });
+	row("RGB from RGBA dumps  ", [&](size_t i) { oldDecodeRGB(rgba_dumps[i].data(), uint16_t(rgba_dumps[i].size()), true, out); }, [&](size_t i) { decodeSpriteRGB(rgba_dumps[i].data(), uint16_t(rgba_dumps[i].size()), true, out); });
+	row("colorize RGBA        ", [&](size_t i) { oldColorize(out, 4, templates[i].data(), outfits[i].head, outfits[i].body, outfits[i].legs, outfits[i].feet); }, [&](size_t i) { colorizeTemplate(out, 4, templates[i].data(), outfits[i].head, outfits[i].body, outfits[i].legs, outfits[i].feet); });
+	uint32_t checksum = 0;
+	for (int i = 0; i < SPRITE_PIXELS_SIZE * 4; ++i) {
+		checksum += out[i];
+	}
+	std::cout << "(checksum " << checksum << ")" << std::endl;
+	return 0;
+}
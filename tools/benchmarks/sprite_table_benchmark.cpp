@@ -0,0 +1,206 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+
+// A synthetic comparison of the two containers behind the sprite and image
+// tables of GraphicManager: an id indexed vector as it uses now against the
+// std::map it used before. No editor code is linked and no .dat file is
+// read, both tables are local copies filled from generated ids the size of
+// a 10.98 client, about 41000 item and creature types referencing 190000
+// images. It shows the cost of the containers alone, not of loading sprites.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace {
+	struct Image {
+		uint32_t id;
+		uint32_t last_use;
+	};
+
+	struct Sprite {
+		uint16_t id;
+		std::vector<Image*> images;
+	};
+
+	// The image ids every sprite reads from the metadata, in file order
+	struct Metadata {
+		uint32_t min_id;
+		uint32_t max_id;
+		std::vector<std::vector<uint32_t>> image_ids;
+	};
+
+	Metadata makeMetadata(std::mt19937& random) {
+		Metadata metadata;
+		metadata.min_id = 100;
+		metadata.max_id = 41000;
+		metadata.image_ids.resize(metadata.max_id + 1);
+		uint32_t next_image = 2;
+		for (uint32_t id = metadata.min_id; id <= metadata.max_id; ++id) {
+			// Mostly new images, some shared with earlier sprites
+			const uint32_t count = 1 + random() % 8;
+			for (uint32_t i = 0; i < count; ++i) {
+				if (random() % 8 == 0) {
+					metadata.image_ids[id].push_back(2 + random() % next_image);
+				} else {
+					metadata.image_ids[id].push_back(next_image++);
+				}
+			}
+		}
+		return metadata;
+	}
+
+	class MapTables {
+	public:
+		~MapTables() {
+			for (auto& entry : sprites) {
+				delete entry.second;
+			}
+			for (auto& entry : images) {
+				delete entry.second;
+			}
+		}
+
+		void load(const Metadata& metadata) {
+			for (uint32_t id = metadata.min_id; id <= metadata.max_id; ++id) {
+				Sprite* sprite = new Sprite();
+				sprite->id = uint16_t(id);
+				sprites[id] = sprite;
+				for (uint32_t image_id : metadata.image_ids[id]) {
+					auto it = images.find(image_id);
+					if (it == images.end()) {
+						it = images.emplace(image_id, new Image { image_id, 0 }).first;
+					}
+					sprite->images.push_back(it->second);
+				}
+			}
+		}
+
+		Sprite* get(uint32_t id) const {
+			auto it = sprites.find(id);
+			return it == sprites.end() ? nullptr : it->second;
+		}
+
+	private:
+		std::map<uint32_t, Sprite*> sprites;
+		std::map<uint32_t, Image*> images;
+	};
+
+	class VectorTables {
+	public:
+		~VectorTables() {
+			for (Sprite* sprite : sprites) {
+				delete sprite;
+			}
+			for (Image* image : images) {
+				delete image;
+			}
+		}
+
+		void load(const Metadata& metadata) {
+			sprites.resize(metadata.max_id + 1, nullptr);
+			for (uint32_t id = metadata.min_id; id <= metadata.max_id; ++id) {
+				Sprite* sprite = new Sprite();
+				sprite->id = uint16_t(id);
+				sprites[id] = sprite;
+				for (uint32_t image_id : metadata.image_ids[id]) {
+					if (image_id >= images.size()) {
+						images.resize(image_id + 1, nullptr);
+					}
+					Image*& image = images[image_id];
+					if (!image) {
+						image = new Image { image_id, 0 };
+					}
+					sprite->images.push_back(image);
+				}
+			}
+		}
+
+		Sprite* get(uint32_t id) const {
+			return id < sprites.size() ? sprites[id] : nullptr;
+		}
+
+	private:
+		std::vector<Sprite*> sprites;
+		std::vector<Image*> images;
+	};
+
+	template <class Function>
+	double milliseconds(Function function) {
+		const auto start = std::chrono::steady_clock::now();
+		function();
+		const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count();
+	}
+
+	template <class Tables>
+	uint64_t drawLookups(const Tables& tables, const std::vector<uint32_t>& ids) {
+		uint64_t sum = 0;
+		for (uint32_t id : ids) {
+			if (Sprite* sprite = tables.get(id)) {
+				sum += sprite->images.front()->id;
+			}
+		}
+		return sum;
+	}
+}
+
+int main(int argc, char** argv) {
+	const size_t lookup_count = argc > 1 ? std::max(atoi(argv[1]), 1) : 20000000;
+
+	std::mt19937 random(1234);
+	const Metadata metadata = makeMetadata(random);
+
+	// Drawing asks for the same few thousand grounds, borders and walls most
+	// of the time
+	std::vector<uint32_t> ids(lookup_count);
+	for (uint32_t& id : ids) {
+		id = random() % 10 != 0 ? metadata.min_id + random() % 3000 : metadata.min_id + random() % (metadata.max_id - metadata.min_id + 1);
+	}
+
+	MapTables map_tables;
+	VectorTables vector_tables;
+	const double map_load = milliseconds([&]() { map_tables.load(metadata); });
+	const double vector_load = milliseconds([&]() { vector_tables.load(metadata); });
+
+	for (uint32_t id = 0; id <= metadata.max_id + 1; ++id) {
+		const Sprite* a = map_tables.get(id);
+		const Sprite* b = vector_tables.get(id);
+		if (!a != !b || (a && (a->images.size() != b->images.size() || a->images.front()->id != b->images.front()->id))) {
+			std::cerr << "The tables disagree about sprite " << id << std::endl;
+			return 1;
+		}
+	}
+
+	uint64_t map_sum = 0, vector_sum = 0;
+	const double map_draw = milliseconds([&]() { map_sum = drawLookups(map_tables, ids); });
+	const double vector_draw = milliseconds([&]() { vector_sum = drawLookups(vector_tables, ids); });
+	if (map_sum != vector_sum) {
+		std::cerr << "The lookups disagree" << std::endl;
+		return 1;
+	}
+
+	std::cout << "metadata load  map " << map_load << " ms  vector " << vector_load << " ms" << std::endl;
+	std::cout << lookup_count << " sprite lookups  map " << map_draw << " ms  vector " << vector_draw << " ms" << std::endl;
+	return 0;
+}